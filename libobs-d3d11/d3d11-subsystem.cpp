@@ -587,6 +587,19 @@ stagesurf_t device_create_stagesurface(device_t device, uint32_t width,
 	return surf;
 }
 
+gputimer_t device_create_gputimer(device_t device)
+{
+	gs_gpu_timer *timer = NULL;
+	try {
+		timer = new gs_gpu_timer(device);
+	} catch (HRError error) {
+		blog(LOG_ERROR, "device_create_gputimer (D3D11): %s (%08lX)",
+				error.str, error.hr);
+	}
+
+	return timer;
+}
+
 samplerstate_t device_create_samplerstate(device_t device,
 		struct gs_sampler_info *info)
 {
@@ -1645,6 +1658,61 @@ void stagesurface_unmap(stagesurf_t stagesurf)
 }
 
 
+void gputimer_destroy(gputimer_t timer)
+{
+	delete timer;
+}
+
+void gputimer_begin(gputimer_t timer)
+{
+	ID3D11DeviceContext *context = timer->device->context;
+
+	context->Begin(timer->disjoint);
+	context->End(timer->start);
+}
+
+void gputimer_end(gputimer_t timer)
+{
+	ID3D11DeviceContext *context = timer->device->context;
+
+	context->End(timer->end);
+	context->End(timer->disjoint);
+	timer->pending = true;
+}
+
+bool gputimer_get_data(gputimer_t timer, uint64_t *time_ns)
+{
+	ID3D11DeviceContext                 *context = timer->device->context;
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	UINT64                              start, end;
+	UINT                                flags;
+
+	/* presenting flushes the commands, so there's no need to here */
+	flags = D3D11_ASYNC_GETDATA_DONOTFLUSH;
+
+	if (!timer->pending)
+		return false;
+
+	if (context->GetData(timer->disjoint, &disjoint, sizeof(disjoint),
+				flags) != S_OK)
+		return false;
+	if (context->GetData(timer->start, &start, sizeof(start), flags) != S_OK)
+		return false;
+	if (context->GetData(timer->end, &end, sizeof(end), flags) != S_OK)
+		return false;
+
+	timer->pending = false;
+
+	/* the GPU clock changed in the middle, so the timestamps are useless */
+	if (disjoint.Disjoint || !disjoint.Frequency)
+		return false;
+
+	*time_ns = (uint64_t)((double)(end - start) * 1000000000.0 /
+			(double)disjoint.Frequency);
+	return true;
+}
+
+
 void zstencil_destroy(zstencil_t zstencil)
 {
 	delete zstencil;
@@ -1701,6 +1769,52 @@ void vertexbuffer_flush(vertbuffer_t vertbuffer, bool rebuild)
 	}
 }
 
+void vertexbuffer_flush_range(vertbuffer_t vertbuffer, size_t start,
+		size_t num)
+{
+	if (!vertbuffer->dynamic) {
+		blog(LOG_ERROR, "vertexbuffer_flush_range: vertex buffer is "
+		                "not dynamic");
+		return;
+	}
+
+	if (!num || start + num > vertbuffer->vbd.data->num)
+		return;
+
+	try {
+		vertbuffer->FlushBufferRange(vertbuffer->vertexBuffer,
+				vertbuffer->vbd.data->points, sizeof(vec3),
+				start, num);
+
+		if (vertbuffer->normalBuffer)
+			vertbuffer->FlushBufferRange(vertbuffer->normalBuffer,
+					vertbuffer->vbd.data->normals,
+					sizeof(vec3), start, num);
+
+		if (vertbuffer->tangentBuffer)
+			vertbuffer->FlushBufferRange(vertbuffer->tangentBuffer,
+					vertbuffer->vbd.data->tangents,
+					sizeof(vec3), start, num);
+
+		if (vertbuffer->colorBuffer)
+			vertbuffer->FlushBufferRange(vertbuffer->colorBuffer,
+					vertbuffer->vbd.data->colors,
+					sizeof(uint32_t), start, num);
+
+		for (size_t i = 0; i < vertbuffer->uvBuffers.size(); i++) {
+			tvertarray &tv = vertbuffer->vbd.data->tvarray[i];
+			vertbuffer->FlushBufferRange(vertbuffer->uvBuffers[i],
+					tv.array, tv.width*sizeof(float),
+					start, num);
+		}
+
+	} catch (HRError error) {
+		blog(LOG_ERROR, "vertexbuffer_flush_range (D3D11): %s "
+		                "(%08lX)",
+				error.str, error.hr);
+	}
+}
+
 struct vb_data *vertexbuffer_getdata(vertbuffer_t vertbuffer)
 {
 	return vertbuffer->vbd.data;
@@ -188,6 +188,8 @@ struct gs_vertex_buffer {
 
 	void FlushBuffer(ID3D11Buffer *buffer, void *array,
 			size_t elementSize);
+	void FlushBufferRange(ID3D11Buffer *buffer, void *array,
+			size_t elementSize, size_t start, size_t num);
 
 	void MakeBufferList(gs_vertex_shader *shader,
 			vector<ID3D11Buffer*> &buffers,
@@ -317,6 +319,19 @@ struct gs_stage_surface {
 			gs_color_format colorFormat);
 };
 
+/* timestamps are only meaningful inside a disjoint query, which also gives
+ * their frequency */
+struct gs_gpu_timer {
+	ComPtr<ID3D11Query> disjoint;
+	ComPtr<ID3D11Query> start;
+	ComPtr<ID3D11Query> end;
+
+	gs_device           *device;
+	bool                pending;
+
+	gs_gpu_timer(device_t device);
+};
+
 struct gs_sampler_state {
 	ComPtr<ID3D11SamplerState> state;
 	device_t                   device;
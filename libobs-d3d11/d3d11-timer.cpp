@@ -0,0 +1,43 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "d3d11-subsystem.hpp"
+
+gs_gpu_timer::gs_gpu_timer(device_t device)
+	: device  (device),
+	  pending (false)
+{
+	D3D11_QUERY_DESC qd;
+	HRESULT hr;
+
+	memset(&qd, 0, sizeof(qd));
+	qd.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+
+	hr = device->device->CreateQuery(&qd, disjoint.Assign());
+	if (FAILED(hr))
+		throw HRError("Failed to create disjoint query", hr);
+
+	qd.Query = D3D11_QUERY_TIMESTAMP;
+
+	hr = device->device->CreateQuery(&qd, start.Assign());
+	if (FAILED(hr))
+		throw HRError("Failed to create start timestamp query", hr);
+
+	hr = device->device->CreateQuery(&qd, end.Assign());
+	if (FAILED(hr))
+		throw HRError("Failed to create end timestamp query", hr);
+}
@@ -46,6 +46,27 @@ void gs_vertex_buffer::FlushBuffer(ID3D11Buffer *buffer, void *array,
 	device->context->Unmap(buffer, 0);
 }
 
+/* a range at the start of the buffer discards the old contents, any other
+ * range is written without waiting on the GPU, so it must not overwrite
+ * vertices that are still in use */
+void gs_vertex_buffer::FlushBufferRange(ID3D11Buffer *buffer, void *array,
+		size_t elementSize, size_t start, size_t num)
+{
+	D3D11_MAPPED_SUBRESOURCE msr;
+	D3D11_MAP type;
+	size_t offset = elementSize * start;
+	HRESULT hr;
+
+	type = start ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+
+	if (FAILED(hr = device->context->Map(buffer, 0, type, 0, &msr)))
+		throw HRError("Failed to map buffer", hr);
+
+	memcpy((uint8_t*)msr.pData + offset, (uint8_t*)array + offset,
+			elementSize * num);
+	device->context->Unmap(buffer, 0);
+}
+
 void gs_vertex_buffer::MakeBufferList(gs_vertex_shader *shader,
 		vector<ID3D11Buffer*> &buffers, vector<uint32_t> &strides)
 {
@@ -148,6 +148,36 @@ bool gl_create_buffer(GLenum target, GLuint *buffer, GLsizeiptr size,
 	return success;
 }
 
+/* ranges after the first are written without waiting on the GPU, the
+ * caller guarantees they are not in use.  a range at the start of the
+ * buffer orphans the old storage instead */
+bool update_buffer_range(GLenum target, GLuint buffer, const void *data,
+		size_t offset, size_t size)
+{
+	GLbitfield access = GL_MAP_WRITE_BIT;
+	void *ptr;
+	bool success = true;
+
+	if (offset == 0)
+		access |= GL_MAP_INVALIDATE_BUFFER_BIT;
+	else
+		access |= GL_MAP_INVALIDATE_RANGE_BIT |
+		          GL_MAP_UNSYNCHRONIZED_BIT;
+
+	if (!gl_bind_buffer(target, buffer))
+		return false;
+
+	ptr = glMapBufferRange(target, offset, size, access);
+	success = gl_success("glMapBufferRange");
+	if (success && ptr) {
+		memcpy(ptr, (const uint8_t*)data + offset, size);
+		glUnmapBuffer(target);
+	}
+
+	gl_bind_buffer(target, 0);
+	return success;
+}
+
 bool update_buffer(GLenum target, GLuint buffer, void *data, size_t size)
 {
 	void *ptr;
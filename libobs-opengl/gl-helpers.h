@@ -143,6 +143,64 @@ static inline bool gl_get_integer_v(GLenum pname, GLint *params)
 	return gl_success("glGetIntegerv");
 }
 
+static inline bool gl_has_sync(void)
+{
+	return GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_sync;
+}
+
+static inline bool gl_has_buffer_storage(void)
+{
+	return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+static inline void gl_delete_sync(GLsync *sync)
+{
+	if (*sync) {
+		glDeleteSync(*sync);
+		*sync = NULL;
+	}
+}
+
+/* replaces any previous fence with one after the commands issued so far */
+static inline void gl_insert_sync(GLsync *sync)
+{
+	if (!gl_has_sync())
+		return;
+
+	gl_delete_sync(sync);
+	*sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_success("glFenceSync");
+}
+
+static inline bool gl_sync_signaled(GLsync sync)
+{
+	GLenum result;
+
+	if (!sync)
+		return true;
+
+	result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	return result == GL_ALREADY_SIGNALED ||
+	       result == GL_CONDITION_SATISFIED;
+}
+
+/* blocks until the fence has signaled, then releases it */
+static inline bool gl_wait_sync(GLsync *sync)
+{
+	GLenum result;
+
+	if (!*sync)
+		return true;
+
+	do {
+		result = glClientWaitSync(*sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+				1000000000ULL);
+	} while (result == GL_TIMEOUT_EXPIRED);
+
+	gl_delete_sync(sync);
+	return result != GL_WAIT_FAILED;
+}
+
 extern bool gl_init_face(GLenum target, GLenum type, uint32_t num_levels,
 		GLenum format, GLint internal_format, bool compressed,
 		uint32_t width, uint32_t height, uint32_t size,
@@ -159,3 +217,5 @@ extern bool gl_create_buffer(GLenum target, GLuint *buffer, GLsizeiptr size,
 
 extern bool update_buffer(GLenum target, GLuint buffer, void *data,
 		size_t size);
+extern bool update_buffer_range(GLenum target, GLuint buffer,
+		const void *data, size_t offset, size_t size);
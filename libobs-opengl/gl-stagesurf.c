@@ -17,6 +17,27 @@
 
 #include "gl-subsystem.h"
 
+#define PERSISTENT_MAP_FLAGS \
+	(GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+/* maps the buffer once for the lifetime of the surface.  copies are only
+ * read after their fence has signaled, so the mapping never needs to be
+ * released while the GPU writes to it */
+static bool create_persistent_buffer(struct gs_stage_surface *surf,
+		GLsizeiptr size)
+{
+	glBufferStorage(GL_PIXEL_PACK_BUFFER, size, 0, PERSISTENT_MAP_FLAGS);
+	if (!gl_success("glBufferStorage"))
+		return false;
+
+	surf->persistent_data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size,
+			PERSISTENT_MAP_FLAGS);
+	if (!gl_success("glMapBufferRange"))
+		return false;
+
+	return surf->persistent_data != NULL;
+}
+
 static bool create_pixel_pack_buffer(struct gs_stage_surface *surf)
 {
 	GLsizeiptr size;
@@ -32,9 +53,13 @@ static bool create_pixel_pack_buffer(struct gs_stage_surface *surf)
 	size  = (size+3) & 0xFFFFFFFC; /* align width to 4-byte boundry */
 	size *= surf->height;
 
-	glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_DYNAMIC_READ);
-	if (!gl_success("glBufferData"))
-		success = false;
+	if (gl_has_sync() && gl_has_buffer_storage()) {
+		success = create_persistent_buffer(surf, size);
+	} else {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_DYNAMIC_READ);
+		if (!gl_success("glBufferData"))
+			success = false;
+	}
 
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0))
 		success = false;
@@ -68,6 +93,8 @@ stagesurf_t device_create_stagesurface(device_t device, uint32_t width,
 void stagesurface_destroy(stagesurf_t stagesurf)
 {
 	if (stagesurf) {
+		gl_delete_sync(&stagesurf->fence);
+
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
 
@@ -140,6 +167,7 @@ void device_stage_texture(device_t device, stagesurf_t dst, texture_t src)
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	gl_insert_sync(&dst->fence);
 	success = true;
 
 failed_unbind_all:
@@ -170,6 +198,8 @@ void device_stage_texture(device_t device, stagesurf_t dst, texture_t src)
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	gl_insert_sync(&dst->fence);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -199,8 +229,22 @@ enum gs_color_format stagesurface_getcolorformat(stagesurf_t stagesurf)
 	return stagesurf->format;
 }
 
+bool stagesurface_isready(stagesurf_t stagesurf)
+{
+	return gl_sync_signaled(stagesurf->fence);
+}
+
 bool stagesurface_map(stagesurf_t stagesurf, uint8_t **data, uint32_t *linesize)
 {
+	if (!gl_wait_sync(&stagesurf->fence))
+		goto fail;
+
+	if (stagesurf->persistent_data) {
+		*data = stagesurf->persistent_data;
+		*linesize = stagesurf->bytes_per_pixel * stagesurf->width;
+		return true;
+	}
+
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
 		goto fail;
 
@@ -220,6 +264,9 @@ fail:
 
 void stagesurface_unmap(stagesurf_t stagesurf)
 {
+	if (stagesurf->persistent_data)
+		return;
+
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
 		return;
 
@@ -390,13 +390,25 @@ struct gs_texture {
 	samplerstate_t       cur_sampler;
 };
 
+/* uploads of dynamic textures in flight when persistent mapping is used */
+#define NUM_UNPACK_BUFFERS 3
+
 struct gs_texture_2d {
 	struct gs_texture    base;
 
 	uint32_t             width;
 	uint32_t             height;
 	bool                 gen_mipmaps;
-	GLuint               unpack_buffer;
+
+	/* dynamic textures are mapped through a ring of unpack buffers.
+	 * with ARB_buffer_storage each buffer stays mapped and is fenced
+	 * after its upload, otherwise a single buffer is orphaned per map */
+	GLuint               unpack_buffers[NUM_UNPACK_BUFFERS];
+	GLsync               unpack_fences[NUM_UNPACK_BUFFERS];
+	uint8_t              *unpack_data[NUM_UNPACK_BUFFERS];
+	size_t               num_unpack_buffers;
+	size_t               cur_unpack_buffer;
+	GLsizeiptr           unpack_size;
 };
 
 struct gs_texture_cube {
@@ -417,6 +429,12 @@ struct gs_stage_surface {
 	GLint                gl_internal_format;
 	GLenum               gl_type;
 	GLuint               pack_buffer;
+
+	/* signaled when the last staged copy has landed in pack_buffer */
+	GLsync               fence;
+
+	/* persistently mapped pack_buffer (ARB_buffer_storage), or NULL */
+	uint8_t              *persistent_data;
 };
 
 struct gs_zstencil_buffer {
@@ -426,6 +444,14 @@ struct gs_zstencil_buffer {
 	GLenum               format;
 };
 
+struct gs_gpu_timer {
+	device_t             device;
+	GLuint               query;
+
+	/* whether query has a result that hasn't been retrieved yet */
+	bool                 pending;
+};
+
 struct gs_swap_chain {
 	device_t             device;
 	struct gl_windowinfo *wi;
@@ -43,16 +43,12 @@ static bool upload_texture_2d(struct gs_texture_2d *tex, const void **data)
 	return success;
 }
 
-static bool create_pixel_unpack_buffer(struct gs_texture_2d *tex)
+#define PERSISTENT_UPLOAD_FLAGS \
+	(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+static GLsizeiptr get_unpack_size(struct gs_texture_2d *tex)
 {
 	GLsizeiptr size;
-	bool success = true;
-
-	if (!gl_gen_buffers(1, &tex->unpack_buffer))
-		return false;
-
-	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, tex->unpack_buffer))
-		return false;
 
 	size = tex->width * gs_get_format_bpp(tex->base.format);
 	if (!gs_is_compressed_format(tex->base.format)) {
@@ -64,9 +60,53 @@ static bool create_pixel_unpack_buffer(struct gs_texture_2d *tex)
 		size /= 8;
 	}
 
-	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_DYNAMIC_DRAW);
-	if (!gl_success("glBufferData"))
-		success = false;
+	return size;
+}
+
+static bool create_persistent_unpack_buffer(struct gs_texture_2d *tex,
+		size_t idx)
+{
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, tex->unpack_size, 0,
+			PERSISTENT_UPLOAD_FLAGS);
+	if (!gl_success("glBufferStorage"))
+		return false;
+
+	tex->unpack_data[idx] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+			tex->unpack_size, PERSISTENT_UPLOAD_FLAGS);
+	if (!gl_success("glMapBufferRange"))
+		return false;
+
+	return tex->unpack_data[idx] != NULL;
+}
+
+static bool create_pixel_unpack_buffers(struct gs_texture_2d *tex)
+{
+	bool   persistent = gl_has_sync() && gl_has_buffer_storage();
+	bool   success    = true;
+	size_t i;
+
+	tex->unpack_size        = get_unpack_size(tex);
+	tex->num_unpack_buffers = persistent ? NUM_UNPACK_BUFFERS : 1;
+
+	if (!gl_gen_buffers((GLsizei)tex->num_unpack_buffers,
+				tex->unpack_buffers))
+		return false;
+
+	for (i = 0; i < tex->num_unpack_buffers; i++) {
+		if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER,
+					tex->unpack_buffers[i]))
+			return false;
+
+		if (persistent) {
+			if (!create_persistent_unpack_buffer(tex, i))
+				success = false;
+		} else {
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, tex->unpack_size,
+					0, GL_STREAM_DRAW);
+			if (!gl_success("glBufferData"))
+				success = false;
+		}
+	}
 
 	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0))
 		success = false;
@@ -98,7 +138,7 @@ texture_t device_create_texture(device_t device, uint32_t width,
 		goto fail;
 
 	if (!tex->base.is_dummy) {
-		if (tex->base.is_dynamic && !create_pixel_unpack_buffer(tex))
+		if (tex->base.is_dynamic && !create_pixel_unpack_buffers(tex))
 			goto fail;
 		if (!upload_texture_2d(tex, data))
 			goto fail;
@@ -132,8 +172,14 @@ void texture_destroy(texture_t tex)
 	if (tex->cur_sampler)
 		samplerstate_destroy(tex->cur_sampler);
 
-	if (!tex->is_dummy && tex->is_dynamic && tex2d->unpack_buffer)
-		gl_delete_buffers(1, &tex2d->unpack_buffer);
+	if (!tex->is_dummy && tex->is_dynamic) {
+		for (size_t i = 0; i < tex2d->num_unpack_buffers; i++)
+			gl_delete_sync(&tex2d->unpack_fences[i]);
+
+		if (tex2d->num_unpack_buffers)
+			gl_delete_buffers((GLsizei)tex2d->num_unpack_buffers,
+					tex2d->unpack_buffers);
+	}
 
 	if (tex->texture)
 		gl_delete_textures(1, &tex->texture);
@@ -167,6 +213,7 @@ enum gs_color_format texture_getcolorformat(texture_t tex)
 bool texture_map(texture_t tex, void **ptr, uint32_t *linesize)
 {
 	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
+	size_t idx;
 
 	if (!is_texture_2d(tex, "texture_map"))
 		goto fail;
@@ -176,20 +223,41 @@ bool texture_map(texture_t tex, void **ptr, uint32_t *linesize)
 		goto fail;
 	}
 
-	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, tex2d->unpack_buffer))
-		goto fail;
+	idx = tex2d->cur_unpack_buffer;
 
-	*ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
-	if (!gl_success("glMapBuffer"))
-		goto fail;
+	if (tex2d->unpack_data[idx]) {
+		/* only waits if the upload from NUM_UNPACK_BUFFERS maps ago
+		 * still hasn't been consumed by the GPU */
+		if (!gl_wait_sync(&tex2d->unpack_fences[idx]))
+			goto fail;
 
-	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		*ptr = tex2d->unpack_data[idx];
+
+	} else {
+		if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER,
+					tex2d->unpack_buffers[idx]))
+			goto fail;
+
+		/* orphan the previous storage so mapping never waits on a
+		 * pending upload */
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, tex2d->unpack_size, 0,
+				GL_STREAM_DRAW);
+		if (!gl_success("glBufferData"))
+			goto fail;
+
+		*ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+		if (!gl_success("glMapBuffer"))
+			goto fail;
+
+		gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
 
 	*linesize = tex2d->width * gs_get_format_bpp(tex->format) / 8;
 	*linesize = (*linesize + 3) & 0xFFFFFFFC;
 	return true;
 
 fail:
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	blog(LOG_ERROR, "texture_map (GL) failed");
 	return false;
 }
@@ -197,25 +265,38 @@ fail:
 void texture_unmap(texture_t tex)
 {
 	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
+	size_t idx;
+
 	if (!is_texture_2d(tex, "texture_unmap"))
 		goto failed;
 
-	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, tex2d->unpack_buffer))
-		goto failed;
+	idx = tex2d->cur_unpack_buffer;
 
-	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-	if (!gl_success("glUnmapBuffer"))
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, tex2d->unpack_buffers[idx]))
 		goto failed;
 
+	if (!tex2d->unpack_data[idx]) {
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		if (!gl_success("glUnmapBuffer"))
+			goto failed;
+	}
+
 	if (!gl_bind_texture(GL_TEXTURE_2D, tex2d->base.texture))
 		goto failed;
 
-	glTexImage2D(GL_TEXTURE_2D, 0, tex->gl_internal_format,
-			tex2d->width, tex2d->height, 0,
+	/* the copy from the buffer to the texture is queued rather than
+	 * performed here, so the texture storage is updated in place */
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex2d->width, tex2d->height,
 			tex->gl_format, tex->gl_type, 0);
-	if (!gl_success("glTexImage2D"))
+	if (!gl_success("glTexSubImage2D"))
 		goto failed;
 
+	if (tex2d->unpack_data[idx])
+		gl_insert_sync(&tex2d->unpack_fences[idx]);
+
+	if (++tex2d->cur_unpack_buffer == tex2d->num_unpack_buffers)
+		tex2d->cur_unpack_buffer = 0;
+
 	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	return;
@@ -226,6 +307,42 @@ failed:
 	blog(LOG_ERROR, "texture_unmap (GL) failed");
 }
 
+bool texture_setimage_rect(texture_t tex, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height, const void *data,
+		uint32_t linesize)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
+	uint32_t pixel_size;
+
+	if (!is_texture_2d(tex, "texture_setimage_rect"))
+		goto failed;
+
+	pixel_size = gs_get_format_bpp(tex->format) / 8;
+	if (!pixel_size || linesize % pixel_size != 0 ||
+	    x + width > tex2d->width || y + height > tex2d->height)
+		goto failed;
+
+	if (!gl_bind_texture(GL_TEXTURE_2D, tex2d->base.texture))
+		goto failed;
+
+	/* uploaded straight from client memory, only the rectangle is
+	 * copied and the rest of the texture keeps its contents */
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, linesize / pixel_size);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height,
+			tex->gl_format, tex->gl_type, data);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	if (!gl_success("glTexSubImage2D"))
+		goto failed;
+
+	gl_bind_texture(GL_TEXTURE_2D, 0);
+	return true;
+
+failed:
+	gl_bind_texture(GL_TEXTURE_2D, 0);
+	blog(LOG_ERROR, "texture_setimage_rect (GL) failed");
+	return false;
+}
+
 bool texture_isrect(texture_t tex)
 {
 	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
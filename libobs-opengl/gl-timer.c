@@ -0,0 +1,85 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "gl-subsystem.h"
+
+static inline bool gl_has_timer_query(void)
+{
+	return GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query;
+}
+
+gputimer_t device_create_gputimer(device_t device)
+{
+	struct gs_gpu_timer *timer;
+
+	if (!gl_has_timer_query())
+		return NULL;
+
+	timer = bzalloc(sizeof(struct gs_gpu_timer));
+	timer->device = device;
+
+	glGenQueries(1, &timer->query);
+	if (!gl_success("glGenQueries")) {
+		bfree(timer);
+		return NULL;
+	}
+
+	return timer;
+}
+
+void gputimer_destroy(gputimer_t timer)
+{
+	if (timer) {
+		glDeleteQueries(1, &timer->query);
+		gl_success("glDeleteQueries");
+		bfree(timer);
+	}
+}
+
+void gputimer_begin(gputimer_t timer)
+{
+	glBeginQuery(GL_TIME_ELAPSED, timer->query);
+	gl_success("glBeginQuery");
+}
+
+void gputimer_end(gputimer_t timer)
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	timer->pending = gl_success("glEndQuery");
+}
+
+bool gputimer_get_data(gputimer_t timer, uint64_t *time_ns)
+{
+	GLint    available = 0;
+	GLuint64 result;
+
+	if (!timer->pending)
+		return false;
+
+	glGetQueryObjectiv(timer->query, GL_QUERY_RESULT_AVAILABLE,
+			&available);
+	if (!gl_success("glGetQueryObjectiv") || !available)
+		return false;
+
+	glGetQueryObjectui64v(timer->query, GL_QUERY_RESULT, &result);
+	if (!gl_success("glGetQueryObjectui64v"))
+		return false;
+
+	timer->pending = false;
+	*time_ns = (uint64_t)result;
+	return true;
+}
@@ -171,6 +171,64 @@ failed:
 	blog(LOG_ERROR, "vertexbuffer_flush (GL) failed");
 }
 
+void vertexbuffer_flush_range(vertbuffer_t vb, size_t start, size_t num)
+{
+	size_t i;
+
+	if (!vb->dynamic) {
+		blog(LOG_ERROR, "vertex buffer is not dynamic");
+		goto failed;
+	}
+
+	if (!num || start + num > vb->data->num)
+		return;
+
+	if (!update_buffer_range(GL_ARRAY_BUFFER, vb->vertex_buffer,
+				vb->data->points,
+				start * sizeof(struct vec3),
+				num * sizeof(struct vec3)))
+		goto failed;
+
+	if (vb->normal_buffer) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->normal_buffer,
+					vb->data->normals,
+					start * sizeof(struct vec3),
+					num * sizeof(struct vec3)))
+			goto failed;
+	}
+
+	if (vb->tangent_buffer) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->tangent_buffer,
+					vb->data->tangents,
+					start * sizeof(struct vec3),
+					num * sizeof(struct vec3)))
+			goto failed;
+	}
+
+	if (vb->color_buffer) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->color_buffer,
+					vb->data->colors,
+					start * sizeof(uint32_t),
+					num * sizeof(uint32_t)))
+			goto failed;
+	}
+
+	for (i = 0; i < vb->data->num_tex; i++) {
+		GLuint buffer = vb->uv_buffers.array[i];
+		struct tvertarray *tv = vb->data->tvarray+i;
+		size_t vert_size = tv->width * sizeof(float);
+
+		if (!update_buffer_range(GL_ARRAY_BUFFER, buffer, tv->array,
+					start * vert_size, num * vert_size))
+			goto failed;
+	}
+
+	return;
+
+failed:
+	blog(LOG_ERROR, "vertexbuffer_flush_range (GL) failed");
+}
+
 struct vb_data *vertexbuffer_getdata(vertbuffer_t vb)
 {
 	return vb->data;
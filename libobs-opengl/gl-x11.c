@@ -420,3 +420,19 @@ void device_present(device_t device)
 
 	glXSwapBuffers(display, window);
 }
+
+/* GLX lets a drawable be swapped from a thread its context isn't current on,
+ * so this can be called outside of the graphics context.  (leaving the
+ * context already flushed the rendering)
+ *
+ * the X connection is the application's, and the video thread keeps making
+ * contexts current on it at the same time, so the swap holds the display
+ * lock.  that requires the application to have called XInitThreads */
+void swapchain_present(swapchain_t swap)
+{
+	Display *display = swap->wi->display;
+
+	XLockDisplay(display);
+	glXSwapBuffers(display, swap->wi->glxid);
+	XUnlockDisplay(display);
+}
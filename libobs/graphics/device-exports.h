@@ -48,6 +48,7 @@ EXPORT zstencil_t device_create_zstencil(device_t device, uint32_t width,
 		uint32_t height, enum gs_zstencil_format format);
 EXPORT stagesurf_t device_create_stagesurface(device_t device, uint32_t width,
 		uint32_t height, enum gs_color_format color_format);
+EXPORT gputimer_t device_create_gputimer(device_t device);
 EXPORT samplerstate_t device_create_samplerstate(device_t device,
 		struct gs_sampler_info *info);
 EXPORT shader_t device_create_vertexshader(device_t device,
@@ -93,6 +94,7 @@ EXPORT void device_load_swapchain(device_t device, swapchain_t swapchain);
 EXPORT void device_clear(device_t device, uint32_t clear_flags,
 		struct vec4 *color, float depth, uint8_t stencil);
 EXPORT void device_present(device_t device);
+EXPORT void swapchain_present(swapchain_t swapchain);
 EXPORT void device_setcullmode(device_t device, enum gs_cull_mode mode);
 EXPORT enum gs_cull_mode device_getcullmode(device_t device);
 EXPORT void device_enable_blending(device_t device, bool enable);
@@ -46,6 +46,8 @@ size_t technique_begin(technique_t tech)
 {
 	if (!tech) return 0;
 
+	gs_sprite_batch_flush();
+
 	tech->effect->cur_technique = tech;
 	tech->effect->graphics->cur_effect = tech->effect;
 
@@ -60,6 +62,7 @@ void technique_end(technique_t tech)
 	struct effect_param *params = effect->params.array;
 	size_t i;
 
+	gs_sprite_batch_flush();
 	gs_load_vertexshader(NULL);
 	gs_load_pixelshader(NULL);
 
@@ -145,6 +148,8 @@ bool technique_beginpass(technique_t tech, size_t idx)
 	passes = tech->passes.array;
 	cur_pass = passes+idx;
 
+	gs_sprite_batch_flush();
+
 	tech->effect->cur_pass = cur_pass;
 	gs_load_vertexshader(cur_pass->vertshader);
 	gs_load_pixelshader(cur_pass->pixelshader);
@@ -192,6 +197,8 @@ void technique_endpass(technique_t tech)
 	if (!pass)
 		return;
 
+	gs_sprite_batch_flush();
+
 	clear_tex_params(pass->vertshader, &pass->vertshader_params.da);
 	clear_tex_params(pass->pixelshader, &pass->pixelshader_params.da);
 	tech->effect->cur_pass = NULL;
@@ -262,6 +269,38 @@ eparam_t effect_getworldmatrix(effect_t effect)
 	return effect ? effect->world : NULL;
 }
 
+static inline bool params_contain(const struct darray *pass_params,
+		eparam_t param)
+{
+	const struct pass_shaderparam *params = pass_params->array;
+
+	for (size_t i = 0; i < pass_params->num; i++) {
+		if (params[i].eparam == param)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * queued sprites only need to be drawn first if they would see the new value.
+ * parameters the current pass doesn't use don't affect them, and ViewProj is
+ * set by the device from the matrix stack on each draw (queued sprites are
+ * already transformed, see queue_sprite)
+ */
+static bool param_affects_sprites(effect_t effect, eparam_t param)
+{
+	struct effect_pass *pass = effect->cur_pass;
+
+	if (effect->graphics->cur_effect != effect || !pass)
+		return false;
+	if (param == effect->view_proj)
+		return false;
+
+	return params_contain(&pass->vertshader_params.da, param) ||
+	       params_contain(&pass->pixelshader_params.da, param);
+}
+
 static inline void effect_setval_inline(effect_t effect, eparam_t param,
 		const void *data, size_t size)
 {
@@ -290,6 +329,10 @@ static inline void effect_setval_inline(effect_t effect, eparam_t param,
 		da_resize(param->cur_val, size);
 
 	if (size_changed || memcmp(param->cur_val.array, data, size) != 0) {
+		/* queued sprites were meant to use the old value */
+		if (param_affects_sprites(effect, param))
+			gs_sprite_batch_flush();
+
 		memcpy(param->cur_val.array, data, size);
 		param->changed = true;
 	}
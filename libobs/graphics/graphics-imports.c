@@ -55,6 +55,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_create_volumetexture);
 	GRAPHICS_IMPORT(device_create_zstencil);
 	GRAPHICS_IMPORT(device_create_stagesurface);
+	GRAPHICS_IMPORT_OPTIONAL(device_create_gputimer);
 	GRAPHICS_IMPORT(device_create_samplerstate);
 	GRAPHICS_IMPORT(device_create_vertexshader);
 	GRAPHICS_IMPORT(device_create_pixelshader);
@@ -83,6 +84,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_endscene);
 	GRAPHICS_IMPORT(device_clear);
 	GRAPHICS_IMPORT(device_present);
+	GRAPHICS_IMPORT_OPTIONAL(swapchain_present);
 	GRAPHICS_IMPORT(device_setcullmode);
 	GRAPHICS_IMPORT(device_getcullmode);
 	GRAPHICS_IMPORT(device_enable_blending);
@@ -115,6 +117,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(texture_getcolorformat);
 	GRAPHICS_IMPORT(texture_map);
 	GRAPHICS_IMPORT(texture_unmap);
+	GRAPHICS_IMPORT_OPTIONAL(texture_setimage_rect);
 	GRAPHICS_IMPORT_OPTIONAL(texture_isrect);
 	GRAPHICS_IMPORT(texture_getobj);
 
@@ -134,6 +137,12 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(stagesurface_getcolorformat);
 	GRAPHICS_IMPORT(stagesurface_map);
 	GRAPHICS_IMPORT(stagesurface_unmap);
+	GRAPHICS_IMPORT_OPTIONAL(stagesurface_isready);
+
+	GRAPHICS_IMPORT_OPTIONAL(gputimer_destroy);
+	GRAPHICS_IMPORT_OPTIONAL(gputimer_begin);
+	GRAPHICS_IMPORT_OPTIONAL(gputimer_end);
+	GRAPHICS_IMPORT_OPTIONAL(gputimer_get_data);
 
 	GRAPHICS_IMPORT(zstencil_destroy);
 
@@ -141,6 +150,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 
 	GRAPHICS_IMPORT(vertexbuffer_destroy);
 	GRAPHICS_IMPORT(vertexbuffer_flush);
+	GRAPHICS_IMPORT_OPTIONAL(vertexbuffer_flush_range);
 	GRAPHICS_IMPORT(vertexbuffer_getdata);
 
 	GRAPHICS_IMPORT(indexbuffer_destroy);
@@ -51,6 +51,7 @@ struct gs_exports {
 	stagesurf_t (*device_create_stagesurface)(device_t device,
 			uint32_t width, uint32_t height,
 			enum gs_color_format color_format);
+	gputimer_t (*device_create_gputimer)(device_t device);
 	samplerstate_t (*device_create_samplerstate)(device_t device,
 			struct gs_sampler_info *info);
 	shader_t (*device_create_vertexshader)(device_t device,
@@ -136,6 +137,7 @@ struct gs_exports {
 	void (*device_projection_pop)(device_t device);
 
 	void     (*swapchain_destroy)(swapchain_t swapchain);
+	void     (*swapchain_present)(swapchain_t swapchain);
 
 	void     (*texture_destroy)(texture_t tex);
 	uint32_t (*texture_getwidth)(texture_t tex);
@@ -144,6 +146,9 @@ struct gs_exports {
 	bool     (*texture_map)(texture_t tex, void **ptr,
 			uint32_t *linesize);
 	void     (*texture_unmap)(texture_t tex);
+	bool     (*texture_setimage_rect)(texture_t tex, uint32_t x,
+			uint32_t y, uint32_t width, uint32_t height,
+			const void *data, uint32_t linesize);
 	bool     (*texture_isrect)(texture_t tex);
 	void    *(*texture_getobj)(texture_t tex);
 
@@ -165,6 +170,12 @@ struct gs_exports {
 	bool     (*stagesurface_map)(stagesurf_t stagesurf,
 			uint8_t **data, uint32_t *linesize);
 	void     (*stagesurface_unmap)(stagesurf_t stagesurf);
+	bool     (*stagesurface_isready)(stagesurf_t stagesurf);
+
+	void     (*gputimer_destroy)(gputimer_t timer);
+	void     (*gputimer_begin)(gputimer_t timer);
+	void     (*gputimer_end)(gputimer_t timer);
+	bool     (*gputimer_get_data)(gputimer_t timer, uint64_t *time_ns);
 
 	void (*zstencil_destroy)(zstencil_t zstencil);
 
@@ -172,6 +183,8 @@ struct gs_exports {
 
 	void (*vertexbuffer_destroy)(vertbuffer_t vertbuffer);
 	void (*vertexbuffer_flush)(vertbuffer_t vertbuffer, bool rebuild);
+	void (*vertexbuffer_flush_range)(vertbuffer_t vertbuffer,
+			size_t start, size_t num);
 	struct vb_data *(*vertexbuffer_getdata)(vertbuffer_t vertbuffer);
 
 	void   (*indexbuffer_destroy)(indexbuffer_t indexbuffer);
@@ -222,6 +235,21 @@ struct gs_exports {
 #endif
 };
 
+struct pooled_texture {
+	texture_t              tex;
+	uint32_t               width;
+	uint32_t               height;
+	enum gs_color_format   format;
+	uint32_t               flags;
+	bool                   in_use;
+	uint64_t               last_used;
+};
+
+struct ortho_state {
+	bool                   valid;
+	float                  left, right, top, bottom;
+};
+
 struct graphics_subsystem {
 	void                   *module;
 	device_t               device;
@@ -233,10 +261,25 @@ struct graphics_subsystem {
 	size_t                 cur_matrix;
 
 	struct matrix4         projection;
+
+	/* area covered by the current projection if it's orthographic, see
+	 * gs_get_ortho */
+	struct ortho_state     ortho;
+	DARRAY(struct ortho_state) ortho_stack;
 	struct gs_effect       *cur_effect;
 
 	vertbuffer_t           sprite_buffer;
 
+	/* queued sprites are vertices [sprite_batch_start, sprite_ring_pos)
+	 * of sprite_ring, see gs_sprite_batch_begin */
+	vertbuffer_t           sprite_ring;
+	size_t                 sprite_ring_pos;
+	size_t                 sprite_batch_start;
+	long                   sprite_batch_depth;
+
+	uint64_t               draw_calls;
+	uint64_t               sprites;
+
 	bool                   using_immediate;
 	struct vb_data         *vbd;
 	vertbuffer_t           immediate_vertbuffer;
@@ -245,6 +288,12 @@ struct graphics_subsystem {
 	DARRAY(uint32_t)       colors;
 	DARRAY(struct vec2)    texverts[16];
 
+	/* recycled textures, see gs_texture_pool_acquire */
+	DARRAY(struct pooled_texture) texture_pool;
+	uint64_t               pool_hits;
+	uint64_t               pool_misses;
+	uint64_t               last_pool_trim;
+
 	pthread_mutex_t        mutex;
 	volatile long          ref;
 };
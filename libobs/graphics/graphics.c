@@ -36,9 +36,26 @@ static __thread graphics_t thread_graphics = NULL;
 
 #define IMMEDIATE_COUNT 512
 
+/* vertices in the sprite batch ring buffer, six per sprite */
+#define SPRITE_RING_VERTS (6 * 1024)
+
+/* unused pooled textures are destroyed after this long */
+#define POOL_EXPIRE_NS    10000000000ULL
+#define POOL_TRIM_NS      1000000000ULL
+
 bool load_graphics_imports(struct gs_exports *exports, void *module,
 		const char *module_name);
 
+static void draw_sprite_batch(struct graphics_subsystem *graphics);
+static void trim_texture_pool(struct graphics_subsystem *graphics);
+
+/* draws any queued sprites before state they depend on changes */
+static inline void flush_sprites(struct graphics_subsystem *graphics)
+{
+	if (graphics->sprite_batch_start != graphics->sprite_ring_pos)
+		draw_sprite_batch(graphics);
+}
+
 static bool graphics_init_immediate_vb(struct graphics_subsystem *graphics)
 {
 	struct vb_data *vbd;
@@ -62,26 +79,36 @@ static bool graphics_init_immediate_vb(struct graphics_subsystem *graphics)
 	return true;
 }
 
-static bool graphics_init_sprite_vb(struct graphics_subsystem *graphics)
+static vertbuffer_t create_sprite_vb(struct graphics_subsystem *graphics,
+		size_t num)
 {
 	struct vb_data *vbd;
 
 	vbd = vbdata_create();
-	vbd->num     = 4;
-	vbd->points  = bmalloc(sizeof(struct vec3) * 4);
+	vbd->num     = num;
+	vbd->points  = bmalloc(sizeof(struct vec3) * num);
 	vbd->num_tex = 1;
 	vbd->tvarray = bmalloc(sizeof(struct tvertarray));
 	vbd->tvarray[0].width = 2;
-	vbd->tvarray[0].array = bmalloc(sizeof(struct vec2) * 4);
+	vbd->tvarray[0].array = bmalloc(sizeof(struct vec2) * num);
 
-	memset(vbd->points,           0, sizeof(struct vec3) * 4);
-	memset(vbd->tvarray[0].array, 0, sizeof(struct vec2) * 4);
+	memset(vbd->points,           0, sizeof(struct vec3) * num);
+	memset(vbd->tvarray[0].array, 0, sizeof(struct vec2) * num);
 
-	graphics->sprite_buffer = graphics->exports.
-		device_create_vertexbuffer(graphics->device, vbd, GS_DYNAMIC);
+	return graphics->exports.device_create_vertexbuffer(graphics->device,
+			vbd, GS_DYNAMIC);
+}
+
+static bool graphics_init_sprite_vb(struct graphics_subsystem *graphics)
+{
+	graphics->sprite_buffer = create_sprite_vb(graphics, 4);
 	if (!graphics->sprite_buffer)
 		return false;
 
+	graphics->sprite_ring = create_sprite_vb(graphics, SPRITE_RING_VERTS);
+	if (!graphics->sprite_ring)
+		return false;
+
 	return true;
 }
 
@@ -152,15 +179,23 @@ void gs_destroy(graphics_t graphics)
 
 	if (graphics->device) {
 		graphics->exports.device_entercontext(graphics->device);
+
+		for (size_t i = 0; i < graphics->texture_pool.num; i++)
+			graphics->exports.texture_destroy(
+					graphics->texture_pool.array[i].tex);
+
 		graphics->exports.vertexbuffer_destroy(graphics->sprite_buffer);
+		graphics->exports.vertexbuffer_destroy(graphics->sprite_ring);
 		graphics->exports.vertexbuffer_destroy(
 				graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
 	}
 
 	pthread_mutex_destroy(&graphics->mutex);
+	da_free(graphics->texture_pool);
 	da_free(graphics->matrix_stack);
 	da_free(graphics->viewport_stack);
+	da_free(graphics->ortho_stack);
 	if (graphics->module)
 		os_dlclose(graphics->module);
 	bfree(graphics);
@@ -191,6 +226,9 @@ void gs_leavecontext(void)
 		if (!os_atomic_dec_long(&thread_graphics->ref)) {
 			graphics_t graphics = thread_graphics;
 
+			flush_sprites(graphics);
+			graphics->sprite_batch_depth = 0;
+
 			graphics->exports.device_leavecontext(graphics->device);
 			pthread_mutex_unlock(&graphics->mutex);
 			thread_graphics = NULL;
@@ -761,6 +799,132 @@ static inline void build_sprite_rect(struct vb_data *data, texture_t tex,
 	build_sprite(data, fcx, fcy, start_u, end_u, start_v, end_v);
 }
 
+/* uploads and draws the queued sprites with a single draw call.  their
+ * vertices are already transformed, so they are drawn without a matrix */
+static void draw_sprite_batch(struct graphics_subsystem *graphics)
+{
+	size_t start = graphics->sprite_batch_start;
+	size_t num   = graphics->sprite_ring_pos - start;
+
+	/* marked empty first, the state calls below flush as well */
+	graphics->sprite_batch_start = graphics->sprite_ring_pos;
+
+	vertexbuffer_flush_range(graphics->sprite_ring, start, num);
+
+	gs_matrix_push();
+	gs_matrix_identity();
+
+	gs_load_vertexbuffer(graphics->sprite_ring);
+	gs_load_indexbuffer(NULL);
+	graphics->exports.device_draw(graphics->device, GS_TRIS,
+			(uint32_t)start, (uint32_t)num);
+	graphics->draw_calls++;
+
+	gs_matrix_pop();
+}
+
+static inline void set_sprite_vert(struct vb_data *data, size_t idx,
+		const struct matrix3 *transform, float x, float y,
+		float u, float v)
+{
+	struct vec3 *pos = data->points + idx;
+	struct vec3 temp;
+
+	vec3_mulf(pos, &transform->x, x);
+	vec3_mulf(&temp, &transform->y, y);
+	vec3_add(pos, pos, &temp);
+	vec3_add(pos, pos, &transform->t);
+	vec2_set(data->tvarray[0].array + idx, u, v);
+}
+
+/*
+ * the quad is transformed by the current matrix here, and the batch is drawn
+ * with an identity matrix.  so unlike everything else a sprite depends on,
+ * matrix changes (gs_matrix_*, usually one per scene item) don't need to
+ * flush the batch, and sprites with different transforms can share a draw
+ */
+static void queue_sprite(struct graphics_subsystem *graphics, texture_t tex,
+		float fcx, float fcy, uint32_t flip)
+{
+	struct vb_data *data = vertexbuffer_getdata(graphics->sprite_ring);
+	struct matrix3 transform;
+	float          start_u, end_u;
+	float          start_v, end_v;
+	size_t         idx;
+
+	if (texture_isrect(tex)) {
+		assign_sprite_rect(&start_u, &end_u,
+				(float)texture_getwidth(tex),
+				(flip & GS_FLIP_U) != 0);
+		assign_sprite_rect(&start_v, &end_v,
+				(float)texture_getheight(tex),
+				(flip & GS_FLIP_V) != 0);
+	} else {
+		assign_sprite_uv(&start_u, &end_u, (flip & GS_FLIP_U) != 0);
+		assign_sprite_uv(&start_v, &end_v, (flip & GS_FLIP_V) != 0);
+	}
+
+	/* wrap around, the next upload discards the old contents */
+	if (graphics->sprite_ring_pos + 6 > SPRITE_RING_VERTS) {
+		flush_sprites(graphics);
+		graphics->sprite_ring_pos    = 0;
+		graphics->sprite_batch_start = 0;
+	}
+
+	gs_matrix_get(&transform);
+	idx = graphics->sprite_ring_pos;
+
+	set_sprite_vert(data, idx,   &transform, 0.0f, 0.0f, start_u, start_v);
+	set_sprite_vert(data, idx+1, &transform,  fcx, 0.0f, end_u,   start_v);
+	set_sprite_vert(data, idx+2, &transform, 0.0f,  fcy, start_u, end_v);
+	set_sprite_vert(data, idx+3, &transform, 0.0f,  fcy, start_u, end_v);
+	set_sprite_vert(data, idx+4, &transform,  fcx, 0.0f, end_u,   start_v);
+	set_sprite_vert(data, idx+5, &transform,  fcx,  fcy, end_u,   end_v);
+
+	graphics->sprite_ring_pos += 6;
+}
+
+void gs_sprite_batch_begin(void)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics) return;
+
+	/* without range flushes, every batch would upload the whole ring,
+	 * which costs more than drawing the sprites one at a time */
+	if (!graphics->exports.vertexbuffer_flush_range)
+		return;
+
+	graphics->sprite_batch_depth++;
+}
+
+void gs_sprite_batch_flush(void)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics) return;
+
+	flush_sprites(graphics);
+}
+
+void gs_sprite_batch_end(void)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics || !graphics->sprite_batch_depth) return;
+
+	if (--graphics->sprite_batch_depth == 0)
+		flush_sprites(graphics);
+}
+
+void gs_get_draw_stats(struct gs_draw_stats *stats)
+{
+	graphics_t graphics = thread_graphics;
+
+	memset(stats, 0, sizeof(struct gs_draw_stats));
+	if (!graphics) return;
+
+	stats->draw_calls = graphics->draw_calls;
+	stats->sprites    = graphics->sprites;
+}
+
 void gs_draw_sprite(texture_t tex, uint32_t flip, uint32_t width,
 		uint32_t height)
 {
@@ -780,6 +944,13 @@ void gs_draw_sprite(texture_t tex, uint32_t flip, uint32_t width,
 	fcx = width  ? (float)width  : (float)texture_getwidth(tex);
 	fcy = height ? (float)height : (float)texture_getheight(tex);
 
+	graphics->sprites++;
+
+	if (graphics->sprite_batch_depth) {
+		queue_sprite(graphics, tex, fcx, fcy, flip);
+		return;
+	}
+
 	data = vertexbuffer_getdata(graphics->sprite_buffer);
 	if (texture_isrect(tex))
 		build_sprite_rect(data, tex, fcx, fcy, flip);
@@ -972,6 +1143,115 @@ static inline bool is_pow2(uint32_t size)
 	return size >= 2 && (size & (size-1)) == 0;
 }
 
+texture_t gs_texture_pool_acquire(uint32_t width, uint32_t height,
+		enum gs_color_format color_format, uint32_t flags)
+{
+	graphics_t            graphics = thread_graphics;
+	struct pooled_texture *entry;
+	texture_t             tex;
+	size_t                i;
+
+	if (!graphics)
+		return NULL;
+
+	for (i = 0; i < graphics->texture_pool.num; i++) {
+		entry = graphics->texture_pool.array+i;
+
+		if (!entry->in_use         &&
+		    entry->width  == width  &&
+		    entry->height == height &&
+		    entry->format == color_format &&
+		    entry->flags  == flags) {
+			entry->in_use = true;
+			graphics->pool_hits++;
+			return entry->tex;
+		}
+	}
+
+	tex = gs_create_texture(width, height, color_format, 1, NULL, flags);
+	if (!tex)
+		return NULL;
+
+	entry = da_push_back_new(graphics->texture_pool);
+	entry->tex    = tex;
+	entry->width  = width;
+	entry->height = height;
+	entry->format = color_format;
+	entry->flags  = flags;
+	entry->in_use = true;
+
+	graphics->pool_misses++;
+	return tex;
+}
+
+void gs_texture_pool_release(texture_t tex)
+{
+	graphics_t graphics = thread_graphics;
+	size_t     i;
+
+	if (!graphics || !tex)
+		return;
+
+	for (i = 0; i < graphics->texture_pool.num; i++) {
+		struct pooled_texture *entry = graphics->texture_pool.array+i;
+
+		if (entry->tex == tex) {
+			entry->in_use    = false;
+			entry->last_used = os_gettime_ns();
+			return;
+		}
+	}
+
+	/* not from the pool */
+	texture_destroy(tex);
+}
+
+static void trim_texture_pool(struct graphics_subsystem *graphics)
+{
+	uint64_t t = os_gettime_ns();
+	size_t   i = 0;
+
+	if (t - graphics->last_pool_trim < POOL_TRIM_NS)
+		return;
+
+	graphics->last_pool_trim = t;
+
+	while (i < graphics->texture_pool.num) {
+		struct pooled_texture *entry = graphics->texture_pool.array+i;
+
+		if (!entry->in_use && t - entry->last_used > POOL_EXPIRE_NS) {
+			graphics->exports.texture_destroy(entry->tex);
+			da_erase(graphics->texture_pool, i);
+		} else {
+			i++;
+		}
+	}
+}
+
+void gs_texture_pool_getstats(struct gs_texture_pool_stats *stats)
+{
+	graphics_t graphics = thread_graphics;
+	size_t     i;
+
+	memset(stats, 0, sizeof(struct gs_texture_pool_stats));
+	if (!graphics)
+		return;
+
+	for (i = 0; i < graphics->texture_pool.num; i++) {
+		struct pooled_texture *entry = graphics->texture_pool.array+i;
+
+		stats->textures++;
+		if (entry->in_use)
+			stats->textures_in_use++;
+
+		stats->bytes += (uint64_t)entry->width * entry->height *
+			gs_get_format_bpp(entry->format) / 8;
+	}
+
+	stats->hits   = graphics->pool_hits;
+	stats->misses = graphics->pool_misses;
+}
+
 texture_t gs_create_texture(uint32_t width, uint32_t height,
 		enum gs_color_format color_format, uint32_t levels,
 		const void **data, uint32_t flags)
@@ -1069,6 +1349,23 @@ stagesurf_t gs_create_stagesurface(uint32_t width, uint32_t height,
 			width, height, color_format);
 }
 
+gputimer_t gs_create_gputimer(void)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics) return NULL;
+
+	/* every timer function is optional, so they're only used once the
+	 * device has been able to create a timer */
+	if (!graphics->exports.device_create_gputimer ||
+	    !graphics->exports.gputimer_destroy ||
+	    !graphics->exports.gputimer_begin ||
+	    !graphics->exports.gputimer_end ||
+	    !graphics->exports.gputimer_get_data)
+		return NULL;
+
+	return graphics->exports.device_create_gputimer(graphics->device);
+}
+
 samplerstate_t gs_create_samplerstate(struct gs_sampler_info *info)
 {
 	graphics_t graphics = thread_graphics;
@@ -1131,6 +1428,7 @@ void gs_load_vertexbuffer(vertbuffer_t vertbuffer)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_load_vertexbuffer(graphics->device,
 			vertbuffer);
 }
@@ -1140,6 +1438,7 @@ void gs_load_indexbuffer(indexbuffer_t indexbuffer)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_load_indexbuffer(graphics->device,
 			indexbuffer);
 }
@@ -1149,6 +1448,7 @@ void gs_load_texture(texture_t tex, int unit)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_load_texture(graphics->device, tex, unit);
 }
 
@@ -1157,6 +1457,7 @@ void gs_load_samplerstate(samplerstate_t samplerstate, int unit)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_load_samplerstate(graphics->device,
 			samplerstate, unit);
 }
@@ -1166,6 +1467,7 @@ void gs_load_vertexshader(shader_t vertshader)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_load_vertexshader(graphics->device,
 			vertshader);
 }
@@ -1175,6 +1477,7 @@ void gs_load_pixelshader(shader_t pixelshader)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_load_pixelshader(graphics->device,
 			pixelshader);
 }
@@ -1225,6 +1528,7 @@ void gs_setrendertarget(texture_t tex, zstencil_t zstencil)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_setrendertarget(graphics->device, tex,
 			zstencil);
 }
@@ -1234,6 +1538,7 @@ void gs_setcuberendertarget(texture_t cubetex, int side, zstencil_t zstencil)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_setcuberendertarget(graphics->device, cubetex,
 			side, zstencil);
 }
@@ -1243,6 +1548,7 @@ void gs_copy_texture(texture_t dst, texture_t src)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_copy_texture(graphics->device, dst, src);
 }
 
@@ -1253,6 +1559,7 @@ void gs_copy_texture_region(texture_t dst, uint32_t dst_x, uint32_t dst_y,
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_copy_texture_region(graphics->device,
 			dst, dst_x, dst_y,
 			src, src_x, src_y, src_w, src_h);
@@ -1263,6 +1570,7 @@ void gs_stage_texture(stagesurf_t dst, texture_t src)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_stage_texture(graphics->device, dst, src);
 }
 
@@ -1280,8 +1588,10 @@ void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_draw(graphics->device, draw_mode,
 			start_vert, num_verts);
+	graphics->draw_calls++;
 }
 
 void gs_endscene(void)
@@ -1289,7 +1599,10 @@ void gs_endscene(void)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_endscene(graphics->device);
+
+	trim_texture_pool(graphics);
 }
 
 void gs_load_swapchain(swapchain_t swapchain)
@@ -1304,6 +1617,9 @@ void gs_clear(uint32_t clear_flags, struct vec4 *color, float depth,
 		uint8_t stencil)
 {
 	graphics_t graphics = thread_graphics;
+	if (!graphics) return;
+
+	flush_sprites(graphics);
 	graphics->exports.device_clear(graphics->device, clear_flags, color,
 			depth, stencil);
 }
@@ -1313,14 +1629,25 @@ void gs_present(void)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_present(graphics->device);
 }
 
+bool gs_present_swapchain(graphics_t graphics, swapchain_t swapchain)
+{
+	if (!graphics || !swapchain) return false;
+	if (!graphics->exports.swapchain_present) return false;
+
+	graphics->exports.swapchain_present(swapchain);
+	return true;
+}
+
 void gs_setcullmode(enum gs_cull_mode mode)
 {
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_setcullmode(graphics->device, mode);
 }
 
@@ -1337,6 +1664,7 @@ void gs_enable_blending(bool enable)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_enable_blending(graphics->device, enable);
 }
 
@@ -1345,6 +1673,7 @@ void gs_enable_depthtest(bool enable)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_enable_depthtest(graphics->device, enable);
 }
 
@@ -1353,6 +1682,7 @@ void gs_enable_stenciltest(bool enable)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_enable_stenciltest(graphics->device, enable);
 }
 
@@ -1361,6 +1691,7 @@ void gs_enable_stencilwrite(bool enable)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_enable_stencilwrite(graphics->device, enable);
 }
 
@@ -1369,6 +1700,7 @@ void gs_enable_color(bool red, bool green, bool blue, bool alpha)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_enable_color(graphics->device, red, green,
 			blue, alpha);
 }
@@ -1378,6 +1710,7 @@ void gs_blendfunction(enum gs_blend_type src, enum gs_blend_type dest)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_blendfunction(graphics->device, src, dest);
 }
 
@@ -1386,6 +1719,7 @@ void gs_depthfunction(enum gs_depth_test test)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_depthfunction(graphics->device, test);
 }
 
@@ -1394,6 +1728,7 @@ void gs_stencilfunction(enum gs_stencil_side side, enum gs_depth_test test)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_stencilfunction(graphics->device, side, test);
 }
 
@@ -1403,6 +1738,7 @@ void gs_stencilop(enum gs_stencil_side side, enum gs_stencil_op fail,
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_stencilop(graphics->device, side, fail, zfail,
 			zpass);
 }
@@ -1453,6 +1789,7 @@ void gs_setviewport(int x, int y, int width, int height)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_setviewport(graphics->device, x, y, width,
 			height);
 }
@@ -1470,6 +1807,7 @@ void gs_setscissorrect(struct gs_rect *rect)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_setscissorrect(graphics->device, rect);
 }
 
@@ -1479,8 +1817,15 @@ void gs_ortho(float left, float right, float top, float bottom, float znear,
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_ortho(graphics->device, left, right, top,
 			bottom, znear, zfar);
+
+	graphics->ortho.valid  = true;
+	graphics->ortho.left   = left;
+	graphics->ortho.right  = right;
+	graphics->ortho.top    = top;
+	graphics->ortho.bottom = bottom;
 }
 
 void gs_frustum(float left, float right, float top, float bottom, float znear,
@@ -1489,8 +1834,23 @@ void gs_frustum(float left, float right, float top, float bottom, float znear,
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_frustum(graphics->device, left, right, top,
 			bottom, znear, zfar);
+
+	graphics->ortho.valid = false;
+}
+
+bool gs_get_ortho(float *left, float *right, float *top, float *bottom)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics || !graphics->ortho.valid) return false;
+
+	*left   = graphics->ortho.left;
+	*right  = graphics->ortho.right;
+	*top    = graphics->ortho.top;
+	*bottom = graphics->ortho.bottom;
+	return true;
 }
 
 void gs_projection_push(void)
@@ -1499,6 +1859,7 @@ void gs_projection_push(void)
 	if (!graphics) return;
 
 	graphics->exports.device_projection_push(graphics->device);
+	da_push_back(graphics->ortho_stack, &graphics->ortho);
 }
 
 void gs_projection_pop(void)
@@ -1506,7 +1867,14 @@ void gs_projection_pop(void)
 	graphics_t graphics = thread_graphics;
 	if (!graphics) return;
 
+	flush_sprites(graphics);
 	graphics->exports.device_projection_pop(graphics->device);
+
+	if (graphics->ortho_stack.num) {
+		struct ortho_state *end = da_end(graphics->ortho_stack);
+		graphics->ortho = *end;
+		da_pop_back(graphics->ortho_stack);
+	}
 }
 
 void swapchain_destroy(swapchain_t swapchain)
@@ -1705,6 +2073,8 @@ bool texture_map(texture_t tex, void **ptr, uint32_t *linesize)
 	graphics_t graphics = thread_graphics;
 	if (!graphics || !tex) return false;
 
+	flush_sprites(graphics);
+
 	return graphics->exports.texture_map(tex, ptr, linesize);
 }
 
@@ -1716,6 +2086,22 @@ void texture_unmap(texture_t tex)
 	graphics->exports.texture_unmap(tex);
 }
 
+bool texture_setimage_rect(texture_t tex, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height, const void *data,
+		uint32_t linesize)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics || !tex || !data) return false;
+
+	if (!graphics->exports.texture_setimage_rect)
+		return false;
+
+	flush_sprites(graphics);
+
+	return graphics->exports.texture_setimage_rect(tex, x, y,
+			width, height, data, linesize);
+}
+
 bool texture_isrect(texture_t tex)
 {
 	graphics_t graphics = thread_graphics;
@@ -1847,6 +2233,45 @@ void stagesurface_unmap(stagesurf_t stagesurf)
 	graphics->exports.stagesurface_unmap(stagesurf);
 }
 
+bool stagesurface_isready(stagesurf_t stagesurf)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics || !stagesurf) return false;
+
+	if (graphics->exports.stagesurface_isready)
+		return graphics->exports.stagesurface_isready(stagesurf);
+	else
+		return true;
+}
+
+void gputimer_destroy(gputimer_t timer)
+{
+	if (!thread_graphics || !timer) return;
+
+	thread_graphics->exports.gputimer_destroy(timer);
+}
+
+void gputimer_begin(gputimer_t timer)
+{
+	if (!thread_graphics || !timer) return;
+
+	thread_graphics->exports.gputimer_begin(timer);
+}
+
+void gputimer_end(gputimer_t timer)
+{
+	if (!thread_graphics || !timer) return;
+
+	thread_graphics->exports.gputimer_end(timer);
+}
+
+bool gputimer_get_data(gputimer_t timer, uint64_t *time_ns)
+{
+	if (!thread_graphics || !timer) return false;
+
+	return thread_graphics->exports.gputimer_get_data(timer, time_ns);
+}
+
 void zstencil_destroy(zstencil_t zstencil)
 {
 	if (!thread_graphics || !zstencil) return;
@@ -1876,6 +2301,19 @@ void vertexbuffer_flush(vertbuffer_t vertbuffer, bool rebuild)
 	thread_graphics->exports.vertexbuffer_flush(vertbuffer, rebuild);
 }
 
+void vertexbuffer_flush_range(vertbuffer_t vertbuffer, size_t start,
+		size_t num)
+{
+	graphics_t graphics = thread_graphics;
+	if (!graphics || !vertbuffer) return;
+
+	if (graphics->exports.vertexbuffer_flush_range)
+		graphics->exports.vertexbuffer_flush_range(vertbuffer,
+				start, num);
+	else
+		graphics->exports.vertexbuffer_flush(vertbuffer, false);
+}
+
 struct vb_data *vertexbuffer_getdata(vertbuffer_t vertbuffer)
 {
 	if (!thread_graphics || !vertbuffer) return NULL;
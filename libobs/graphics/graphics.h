@@ -255,6 +255,7 @@ typedef struct gs_index_buffer    *indexbuffer_t;
 typedef struct gs_sampler_state   *samplerstate_t;
 typedef struct gs_swap_chain      *swapchain_t;
 typedef struct gs_texture_render  *texrender_t;
+typedef struct gs_gpu_timer       *gputimer_t;
 typedef struct gs_shader          *shader_t;
 typedef struct shader_param       *sparam_t;
 typedef struct gs_effect          *effect_t;
@@ -392,6 +393,13 @@ EXPORT void texrender_end(texrender_t texrender);
 EXPORT void texrender_reset(texrender_t texrender);
 EXPORT texture_t texrender_gettexture(texrender_t texrender);
 
+/**
+ * Returns the render target to the texture pool.  Use when the texture is
+ * only needed briefly, so other texture renders can share it.  The next
+ * texrender_begin acquires a target again.
+ */
+EXPORT void texrender_release(texrender_t texrender);
+
 /* ---------------------------------------------------
  * graphics subsystem
  * --------------------------------------------------- */
@@ -499,6 +507,36 @@ EXPORT texture_t gs_create_volumetexture_from_file(const char *flie,
 EXPORT void gs_draw_sprite(texture_t tex, uint32_t flip, uint32_t width,
 		uint32_t height);
 
+/**
+ * Sprite batching
+ *
+ *   Between gs_sprite_batch_begin and gs_sprite_batch_end, gs_draw_sprite
+ * queues its quad (transformed by the current matrix) in a dynamic ring
+ * buffer instead of drawing it.  Queued sprites are drawn together with a
+ * single draw call as soon as anything they depend on changes:  the value
+ * of an effect parameter used by the current pass, the technique pass,
+ * render target, render states, viewport or projection, or any other draw.
+ * Changing the matrix does not split a batch.
+ *
+ *   Only sprites drawn with the same effect state share a draw, so sprites
+ * that each use their own texture still take a draw each.  The draw call
+ * savings come from repeats of the same texture (the same source shown
+ * several times, tiled sprites), see gs_get_draw_stats.  Batches can be
+ * nested.  Devices that can't upload part of a vertex buffer draw each sprite
+ * straight away instead.
+ */
+EXPORT void gs_sprite_batch_begin(void);
+EXPORT void gs_sprite_batch_flush(void);
+EXPORT void gs_sprite_batch_end(void);
+
+struct gs_draw_stats {
+	uint64_t draw_calls;      /**< Draw calls sent to the device */
+	uint64_t sprites;         /**< Sprites drawn, batched or not */
+};
+
+/** counts since the graphics subsystem was created */
+EXPORT void gs_get_draw_stats(struct gs_draw_stats *stats);
+
 EXPORT void gs_draw_cube_backdrop(texture_t cubetex, const struct quat *rot,
 		float left, float right, float top, float bottom, float znear);
 
@@ -515,6 +553,15 @@ EXPORT void gs_viewport_pop(void);
 
 EXPORT void texture_setimage(texture_t tex, const void *data,
 		uint32_t linesize, bool invert);
+
+/**
+ * Updates a rectangle of a texture directly from memory, leaving the rest of
+ * the texture as it was.  Returns false if the graphics module can't update
+ * part of a texture, in which case texture_setimage must be used instead.
+ */
+EXPORT bool texture_setimage_rect(texture_t tex, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height, const void *data,
+		uint32_t linesize);
 EXPORT void cubetexture_setimage(texture_t cubetex, uint32_t side,
 		const void *data, uint32_t linesize, bool invert);
 
@@ -533,6 +580,27 @@ EXPORT uint32_t gs_getheight(void);
 EXPORT texture_t gs_create_texture(uint32_t width, uint32_t height,
 		enum gs_color_format color_format, uint32_t levels,
 		const void **data, uint32_t flags);
+
+struct gs_texture_pool_stats {
+	uint32_t textures;        /**< Textures owned by the pool */
+	uint32_t textures_in_use; /**< Textures currently acquired */
+	uint64_t bytes;           /**< Approximate memory of those textures */
+	uint64_t hits;            /**< Acquires served by a recycled texture */
+	uint64_t misses;          /**< Acquires that created a new texture */
+};
+
+/**
+ * Texture pool
+ *
+ *   Recycles single-level 2D textures by size, format and flags.  Released
+ * textures are kept for reuse by any caller and destroyed once they've been
+ * unused for several seconds, so textures that get resized, or are only
+ * needed for part of a frame, don't cause a new allocation each time.
+ */
+EXPORT texture_t gs_texture_pool_acquire(uint32_t width, uint32_t height,
+		enum gs_color_format color_format, uint32_t flags);
+EXPORT void gs_texture_pool_release(texture_t tex);
+EXPORT void gs_texture_pool_getstats(struct gs_texture_pool_stats *stats);
 EXPORT texture_t gs_create_cubetexture(uint32_t size,
 		enum gs_color_format color_format, uint32_t levels,
 		const void **data, uint32_t flags);
@@ -546,6 +614,9 @@ EXPORT zstencil_t gs_create_zstencil(uint32_t width, uint32_t height,
 EXPORT stagesurf_t gs_create_stagesurface(uint32_t width, uint32_t height,
 		enum gs_color_format color_format);
 
+/** returns NULL if the device can't time GPU work */
+EXPORT gputimer_t gs_create_gputimer(void);
+
 EXPORT samplerstate_t gs_create_samplerstate(struct gs_sampler_info *info);
 
 EXPORT shader_t gs_create_vertexshader(const char *shader,
@@ -600,6 +671,18 @@ EXPORT void gs_clear(uint32_t clear_flags, struct vec4 *color,
 		float depth, uint8_t stencil);
 EXPORT void gs_present(void);
 
+/**
+ * presents a swap chain without having to be in the graphics context, so a
+ * present that waits for vertical sync doesn't hold up other threads.
+ * returns false if the subsystem can't, in which case gs_present has to be
+ * used from within the context.
+ *
+ *   On X11 this is called from a thread other than the one using the
+ * graphics context, so the application must call XInitThreads before it
+ * opens its display connection.
+ */
+EXPORT bool gs_present_swapchain(graphics_t graphics, swapchain_t swapchain);
+
 EXPORT void gs_setcullmode(enum gs_cull_mode mode);
 EXPORT enum gs_cull_mode gs_getcullmode(void);
 
@@ -634,6 +717,13 @@ EXPORT void gs_ortho(float left, float right, float top, float bottom,
 EXPORT void gs_frustum(float left, float right, float top, float bottom,
 		float znear, float zfar);
 
+/**
+ * gets the area the current projection covers if it was set with gs_ortho,
+ * returns false if it's a perspective projection or hasn't been set
+ */
+EXPORT bool gs_get_ortho(float *left, float *right, float *top,
+		float *bottom);
+
 EXPORT void gs_projection_push(void);
 EXPORT void gs_projection_pop(void);
 
@@ -673,12 +763,40 @@ EXPORT bool     stagesurface_map(stagesurf_t stagesurf, uint8_t **data,
 		uint32_t *linesize);
 EXPORT void     stagesurface_unmap(stagesurf_t stagesurf);
 
+/** returns false if mapping the surface would wait on the GPU */
+EXPORT bool     stagesurface_isready(stagesurf_t stagesurf);
+
+EXPORT void     gputimer_destroy(gputimer_t timer);
+
+/**
+ * Measures the time the GPU spends on the commands issued between begin and
+ * end.  Timers can't be nested, and only one can be running at a time.
+ */
+EXPORT void     gputimer_begin(gputimer_t timer);
+EXPORT void     gputimer_end(gputimer_t timer);
+
+/**
+ * Gets the time measured by the last begin/end, in nanoseconds.  Returns
+ * false without waiting if the GPU hasn't finished those commands yet, or if
+ * the result has already been retrieved.
+ */
+EXPORT bool     gputimer_get_data(gputimer_t timer, uint64_t *time_ns);
+
 EXPORT void     zstencil_destroy(zstencil_t zstencil);
 
 EXPORT void     samplerstate_destroy(samplerstate_t samplerstate);
 
 EXPORT void     vertexbuffer_destroy(vertbuffer_t vertbuffer);
 EXPORT void     vertexbuffer_flush(vertbuffer_t vertbuffer, bool rebuild);
+
+/**
+ * Uploads only vertices [start, start+num) of a dynamic vertex buffer.  A
+ * range starting at 0 discards the previous contents; other ranges must not
+ * overwrite vertices drawn since then, so they can be uploaded without
+ * waiting on the GPU.
+ */
+EXPORT void     vertexbuffer_flush_range(vertbuffer_t vertbuffer,
+		size_t start, size_t num);
 EXPORT struct vb_data *vertexbuffer_getdata(vertbuffer_t vertbuffer);
 
 EXPORT void     indexbuffer_destroy(indexbuffer_t indexbuffer);
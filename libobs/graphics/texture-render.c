@@ -49,7 +49,7 @@ texrender_t texrender_create(enum gs_color_format format,
 void texrender_destroy(texrender_t texrender)
 {
 	if (texrender) {
-		texture_destroy(texrender->target);
+		gs_texture_pool_release(texrender->target);
 		zstencil_destroy(texrender->zs);
 		bfree(texrender);
 	}
@@ -61,7 +61,7 @@ static bool texrender_resetbuffer(texrender_t texrender, uint32_t cx,
 	if (!texrender)
 		return false;
 
-	texture_destroy(texrender->target);
+	gs_texture_pool_release(texrender->target);
 	zstencil_destroy(texrender->zs);
 
 	texrender->target = NULL;
@@ -69,15 +69,15 @@ static bool texrender_resetbuffer(texrender_t texrender, uint32_t cx,
 	texrender->cx     = cx;
 	texrender->cy     = cy;
 
-	texrender->target = gs_create_texture(cx, cy, texrender->format,
-			1, NULL, GS_RENDERTARGET);
+	texrender->target = gs_texture_pool_acquire(cx, cy, texrender->format,
+			GS_RENDERTARGET);
 	if (!texrender->target)
 		return false;
 
 	if (texrender->zsformat != GS_ZS_NONE) {
 		texrender->zs = gs_create_zstencil(cx, cy, texrender->zsformat);
 		if (!texrender->zs) {
-			texture_destroy(texrender->target);
+			gs_texture_pool_release(texrender->target);
 			texrender->target = NULL;
 
 			return false;
@@ -101,7 +101,7 @@ bool texrender_begin(texrender_t texrender, uint32_t cx, uint32_t cy)
 	if (!cx || !cy)
 		return false;
 
-	if (texrender->cx != cx || texrender->cy != cy)
+	if (!texrender->target || texrender->cx != cx || texrender->cy != cy)
 		if (!texrender_resetbuffer(texrender, cx, cy))
 			return false;
 
@@ -143,3 +143,18 @@ texture_t texrender_gettexture(texrender_t texrender)
 {
 	return texrender ? texrender->target : NULL;
 }
+
+void texrender_release(texrender_t texrender)
+{
+	if (!texrender)
+		return;
+
+	gs_texture_pool_release(texrender->target);
+	zstencil_destroy(texrender->zs);
+
+	texrender->target   = NULL;
+	texrender->zs       = NULL;
+	texrender->cx       = 0;
+	texrender->cy       = 0;
+	texrender->rendered = false;
+}
@@ -22,6 +22,7 @@
 #include "../util/darray.h"
 #include "../util/circlebuf.h"
 #include "../util/platform.h"
+#include "../util/profiler.h"
 
 #include "audio-io.h"
 #include "audio-resampler.h"
@@ -431,20 +432,34 @@ static uint64_t mix_and_output(struct audio_output *audio, uint64_t audio_time,
 /* sample audio 40 times a second */
 #define AUDIO_WAIT_TIME (1000/40)
 
+/* minimum timer slack to keep wakeups as close to the deadline as possible */
+#define TIMING_TIMER_SLACK_NS 1
+
 static void *audio_thread(void *param)
 {
 	struct audio_output *audio = param;
 	uint64_t buffer_time = audio->info.buffer_ms * 1000000;
-	uint64_t prev_time = os_gettime_ns() - buffer_time;
+	uint64_t prev_time;
 	uint64_t audio_time;
 
+	os_set_thread_timer_slack(TIMING_TIMER_SLACK_NS);
+
+	if (audio->info.thread_sched != OS_THREAD_SCHED_NORMAL &&
+	    !os_set_thread_sched(audio->info.thread_sched))
+		blog(LOG_WARNING, "%s: Failed to set realtime scheduling for "
+		                  "the timing thread", audio->info.name);
+
+	prev_time = os_gettime_ns() - buffer_time;
+
 	while (os_event_try(audio->stop_event) == EAGAIN) {
 		os_sleep_ms(AUDIO_WAIT_TIME);
 
 		pthread_mutex_lock(&audio->line_mutex);
 
 		audio_time = os_gettime_ns() - buffer_time;
+		profile_start("mix_and_output");
 		audio_time = mix_and_output(audio, audio_time, prev_time);
+		profile_end("mix_and_output");
 		prev_time  = audio_time;
 
 		pthread_mutex_unlock(&audio->line_mutex);
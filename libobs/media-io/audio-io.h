@@ -19,6 +19,7 @@
 
 #include "media-io-defs.h"
 #include "../util/c99defs.h"
+#include "../util/platform.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -76,6 +77,9 @@ struct audio_output_info {
 	enum audio_format   format;
 	enum speaker_layout speakers;
 	uint64_t            buffer_ms;
+
+	/* timing thread scheduling, see os_set_thread_sched */
+	enum os_thread_sched thread_sched;
 };
 
 struct audio_convert_info {
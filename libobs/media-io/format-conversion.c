@@ -152,37 +152,81 @@ void compress_uyvx_to_nv12(
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* unpacking to packed 444 (Y, U, V, 0xFF bytes per pixel)                   */
+
+#define YUVX_ALPHA 0xFF000000
+
+/* writes 16 unpacked pixels from 16 luma bytes and 16 per-pixel chroma
+ * bytes (each chroma value duplicated for both pixels of a pair) */
+static FORCE_INLINE void store_yuvx16(uint8_t *output, __m128i lum,
+		__m128i u_dup, __m128i v_dup)
+{
+	__m128i alpha = _mm_set1_epi8((char)0xFF);
+	__m128i yu_lo = _mm_unpacklo_epi8(lum, u_dup);
+	__m128i yu_hi = _mm_unpackhi_epi8(lum, u_dup);
+	__m128i v_lo  = _mm_unpacklo_epi8(v_dup, alpha);
+	__m128i v_hi  = _mm_unpackhi_epi8(v_dup, alpha);
+
+	_mm_storeu_si128((__m128i*)output,      _mm_unpacklo_epi16(yu_lo, v_lo));
+	_mm_storeu_si128((__m128i*)output + 1,  _mm_unpackhi_epi16(yu_lo, v_lo));
+	_mm_storeu_si128((__m128i*)output + 2,  _mm_unpacklo_epi16(yu_hi, v_hi));
+	_mm_storeu_si128((__m128i*)output + 3,  _mm_unpackhi_epi16(yu_hi, v_hi));
+}
+
+static FORCE_INLINE void store_yuvx_pair(uint32_t *output0, uint32_t *output1,
+		const uint8_t *lum0, const uint8_t *lum1, uint32_t chroma)
+{
+	chroma |= YUVX_ALPHA;
+
+	output0[0] = lum0[0] | chroma;
+	output0[1] = lum0[1] | chroma;
+	output1[0] = lum1[0] | chroma;
+	output1[1] = lum1[1] | chroma;
+}
+
 void decompress_420(
 		const uint8_t *const input[], const uint32_t in_linesize[],
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize)
 {
 	uint32_t start_y_d2 = start_y/2;
-	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t width      = min_uint32(in_linesize[0], out_linesize/4);
+	uint32_t width_d2   = width/2;
 	uint32_t height_d2  = end_y/2;
 	uint32_t y;
 
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
 		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
-		register const uint8_t *lum0, *lum1;
-		register uint32_t *output0, *output1;
-		uint32_t x;
+		const uint8_t *lum0, *lum1;
+		uint8_t       *output0, *output1;
+		uint32_t      x = 0;
 
 		lum0 = input[0] + y * 2 * in_linesize[0];
 		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t*)(output + y * 2 * in_linesize[0]);
-		output1 = (uint32_t*)((uint8_t*)output0 + in_linesize[0]);
-
-		for (x = 0; x < width_d2; x++) {
-			uint32_t out;
-			out = (*(chroma0++) << 8) | (*(chroma1++) << 16);
-
-			*(output0++) = *(lum0++) | out;
-			*(output0++) = *(lum0++) | out;
+		output0 = output + y * 2 * out_linesize;
+		output1 = output0 + out_linesize;
+
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i u = _mm_loadl_epi64((const __m128i*)(chroma0+x));
+			__m128i v = _mm_loadl_epi64((const __m128i*)(chroma1+x));
+			__m128i u_dup = _mm_unpacklo_epi8(u, u);
+			__m128i v_dup = _mm_unpacklo_epi8(v, v);
+
+			store_yuvx16(output0 + x*8, _mm_loadu_si128(
+					(const __m128i*)(lum0 + x*2)),
+					u_dup, v_dup);
+			store_yuvx16(output1 + x*8, _mm_loadu_si128(
+					(const __m128i*)(lum1 + x*2)),
+					u_dup, v_dup);
+		}
 
-			*(output1++) = *(lum1++) | out;
-			*(output1++) = *(lum1++) | out;
+		for (; x < width_d2; x++) {
+			uint32_t out = (chroma0[x] << 8) | (chroma1[x] << 16);
+			store_yuvx_pair((uint32_t*)(output0 + x*8),
+					(uint32_t*)(output1 + x*8),
+					lum0 + x*2, lum1 + x*2, out);
 		}
 	}
 }
@@ -193,82 +237,136 @@ void decompress_nv12(
 		uint8_t *output, uint32_t out_linesize)
 {
 	uint32_t start_y_d2 = start_y/2;
-	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t width      = min_uint32(in_linesize[0], out_linesize/4);
+	uint32_t width_d2   = width/2;
 	uint32_t height_d2  = end_y/2;
+	__m128i  lo_mask    = _mm_set1_epi16(0x00FF);
 	uint32_t y;
 
 	for (y = start_y_d2; y < height_d2; y++) {
-		const uint16_t *chroma;
-		register const uint8_t *lum0, *lum1;
-		register uint32_t *output0, *output1;
-		uint32_t x;
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0, *lum1;
+		uint8_t       *output0, *output1;
+		uint32_t      x = 0;
 
-		chroma = (const uint16_t*)(input[1] + y * in_linesize[1]);
 		lum0 = input[0] + y * 2 * in_linesize[0];
 		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t*)(output + y * 2 * out_linesize);
-		output1 = (uint32_t*)((uint8_t*)output0 + out_linesize);
-
-		for (x = 0; x < width_d2; x++) {
-			uint32_t out = *(chroma++) << 8;
-
-			*(output0++) = *(lum0++) | out;
-			*(output0++) = *(lum0++) | out;
+		output0 = output + y * 2 * out_linesize;
+		output1 = output0 + out_linesize;
+
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i uv = _mm_loadu_si128(
+					(const __m128i*)(chroma + x*2));
+			__m128i u  = _mm_and_si128(uv, lo_mask);
+			__m128i v  = _mm_srli_epi16(uv, 8);
+			__m128i u_dup = _mm_or_si128(u, _mm_slli_epi16(u, 8));
+			__m128i v_dup = _mm_or_si128(v, _mm_slli_epi16(v, 8));
+
+			store_yuvx16(output0 + x*8, _mm_loadu_si128(
+					(const __m128i*)(lum0 + x*2)),
+					u_dup, v_dup);
+			store_yuvx16(output1 + x*8, _mm_loadu_si128(
+					(const __m128i*)(lum1 + x*2)),
+					u_dup, v_dup);
+		}
 
-			*(output1++) = *(lum1++) | out;
-			*(output1++) = *(lum1++) | out;
+		for (; x < width_d2; x++) {
+			uint32_t out = (chroma[x*2] << 8) |
+				(chroma[x*2 + 1] << 16);
+			store_yuvx_pair((uint32_t*)(output0 + x*8),
+					(uint32_t*)(output1 + x*8),
+					lum0 + x*2, lum1 + x*2, out);
 		}
 	}
 }
 
+/*
+ * each input dword holds two pixels sharing chroma:
+ *   leading luma:  Y0 U Y1 V
+ *   leading chroma: U Y0 V Y1
+ */
+static FORCE_INLINE void unpack_422_lum(uint32_t dw, uint32_t *out)
+{
+	uint32_t uv = (dw & 0xFF00) | ((dw >> 8) & 0xFF0000) | YUVX_ALPHA;
+	out[0] = (dw & 0xFF)         | uv;
+	out[1] = ((dw >> 16) & 0xFF) | uv;
+}
+
+static FORCE_INLINE void unpack_422_ch(uint32_t dw, uint32_t *out)
+{
+	uint32_t uv = ((dw & 0xFF) << 8) | (dw & 0xFF0000) | YUVX_ALPHA;
+	out[0] = ((dw >> 8) & 0xFF) | uv;
+	out[1] = (dw >> 24)         | uv;
+}
+
 void decompress_422(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize,
 		bool leading_lum)
 {
-	uint32_t width_d2 = min_uint32(in_linesize, out_linesize)/2;
+	uint32_t width_d2 = min_uint32(in_linesize/2, out_linesize/4)/2;
+	__m128i  lum_mask = _mm_set1_epi32(0xFF);
+	__m128i  u_mask   = _mm_set1_epi32(leading_lum ? 0xFF00 : 0xFF);
+	__m128i  v_mask   = _mm_set1_epi32(0xFF0000);
+	__m128i  alpha    = _mm_set1_epi32((int)YUVX_ALPHA);
 	uint32_t y;
 
-	register const uint32_t *input32;
-	register const uint32_t *input32_end;
-	register uint32_t       *output32;
-
-	if (leading_lum) {
-		for (y = start_y; y < end_y; y++) {
-			input32     = (const uint32_t*)(input + y*in_linesize);
-			input32_end = input32 + width_d2;
-			output32    = (uint32_t*)(output + y*out_linesize);
-
-			while(input32 < input32_end) {
-				register uint32_t dw = *input32;
+	for (y = start_y; y < end_y; y++) {
+		const uint32_t *input32  = (const uint32_t*)(input + y*in_linesize);
+		uint32_t       *output32 = (uint32_t*)(output + y*out_linesize);
+		uint32_t       x = 0;
+
+		for (; x + 4 <= width_d2; x += 4) {
+			__m128i dw = _mm_loadu_si128((const __m128i*)(input32+x));
+			__m128i uv, lum0, lum1, p0, p1;
+
+			if (leading_lum) {
+				uv   = _mm_or_si128(_mm_and_si128(dw, u_mask),
+						_mm_and_si128(_mm_srli_epi32(dw, 8),
+							v_mask));
+				lum0 = _mm_and_si128(dw, lum_mask);
+				lum1 = _mm_and_si128(_mm_srli_epi32(dw, 16),
+						lum_mask);
+			} else {
+				uv   = _mm_or_si128(_mm_slli_epi32(
+						_mm_and_si128(dw, u_mask), 8),
+						_mm_and_si128(dw, v_mask));
+				lum0 = _mm_and_si128(_mm_srli_epi32(dw, 8),
+						lum_mask);
+				lum1 = _mm_srli_epi32(dw, 24);
+			}
 
-				output32[0] = dw;
-				dw &= 0xFFFFFF00;
-				dw |= (uint8_t)(dw>>16);
-				output32[1] = dw;
+			uv = _mm_or_si128(uv, alpha);
+			p0 = _mm_or_si128(lum0, uv);
+			p1 = _mm_or_si128(lum1, uv);
 
-				output32 += 2;
-				input32++;
-			}
+			_mm_storeu_si128((__m128i*)(output32 + x*2),
+					_mm_unpacklo_epi32(p0, p1));
+			_mm_storeu_si128((__m128i*)(output32 + x*2 + 4),
+					_mm_unpackhi_epi32(p0, p1));
 		}
-	} else {
-		for (y = start_y; y < end_y; y++) {
-			input32     = (const uint32_t*)(input + y*in_linesize);
-			input32_end = input32 + width_d2;
-			output32    = (uint32_t*)(output + y*out_linesize);
-
-			while (input32 < input32_end) {
-				register uint32_t dw = *input32;
-
-				output32[0] = dw;
-				dw &= 0xFFFF00FF;
-				dw |= (dw>>16) & 0xFF00;
-				output32[1] = dw;
-
-				output32 += 2;
-				input32++;
-			}
+
+		for (; x < width_d2; x++) {
+			if (leading_lum)
+				unpack_422_lum(input32[x], output32 + x*2);
+			else
+				unpack_422_ch(input32[x], output32 + x*2);
 		}
 	}
 }
+
+void get_decompress_slice(uint32_t height, uint32_t num_slices,
+		uint32_t idx, uint32_t *start_y, uint32_t *end_y)
+{
+	uint32_t slice_height = ((height + num_slices - 1) / num_slices + 1) &
+		~1;
+
+	*start_y = idx * slice_height;
+	*end_y   = *start_y + slice_height;
+
+	if (*start_y > height)
+		*start_y = height;
+	if (*end_y > height)
+		*end_y = height;
+}
@@ -53,6 +53,15 @@ EXPORT void decompress_422(
 		uint8_t *output, uint32_t out_linesize,
 		bool leading_lum);
 
+/**
+ * Gets the rows of slice idx when rows 0 to height-1 are split in to
+ * num_slices even-height slices for decompressing on separate threads
+ * (4:2:0 formats decompress rows in pairs).  Together the slices always
+ * cover every row, and trailing slices may be empty.
+ */
+EXPORT void get_decompress_slice(uint32_t height, uint32_t num_slices,
+		uint32_t idx, uint32_t *start_y, uint32_t *end_y);
+
 #ifdef __cplusplus
 }
 #endif
@@ -60,6 +60,10 @@ struct video_output {
 	uint64_t                   frame_time;
 	volatile uint64_t          cur_video_time;
 
+	uint32_t                   total_frames;
+	uint32_t                   lagged_frames;
+	uint32_t                   duplicated_frames;
+
 	bool                       initialized;
 
 	pthread_mutex_t            input_mutex;
@@ -68,12 +72,15 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 
-static inline void video_swapframes(struct video_output *video)
+static inline bool video_swapframes(struct video_output *video)
 {
 	if (video->new_frame) {
 		video->cur_frame = video->next_frame;
 		video->new_frame = false;
+		return true;
 	}
+
+	return false;
 }
 
 static inline bool scale_video_output(struct video_input *input,
@@ -105,13 +112,17 @@ static inline bool scale_video_output(struct video_input *input,
 	return success;
 }
 
-static inline void video_output_cur_frame(struct video_output *video)
+static inline void video_output_cur_frame(struct video_output *video,
+		bool new_frame)
 {
 	if (!video->cur_frame.data[0])
 		return;
 
 	pthread_mutex_lock(&video->input_mutex);
 
+	if (!new_frame && video->inputs.num)
+		video->duplicated_frames++;
+
 	for (size_t i = 0; i < video->inputs.num; i++) {
 		struct video_input *input = video->inputs.array+i;
 		if (scale_video_output(input, &video->cur_frame))
@@ -121,27 +132,52 @@ static inline void video_output_cur_frame(struct video_output *video)
 	pthread_mutex_unlock(&video->input_mutex);
 }
 
+/* minimum timer slack to keep wakeups as close to the deadline as possible */
+#define TIMING_TIMER_SLACK_NS 1
+
+static inline void init_timing_thread(enum os_thread_sched sched,
+		const char *name)
+{
+	os_set_thread_timer_slack(TIMING_TIMER_SLACK_NS);
+
+	if (sched != OS_THREAD_SCHED_NORMAL && !os_set_thread_sched(sched))
+		blog(LOG_WARNING, "%s: Failed to set realtime scheduling for "
+		                  "the timing thread", name);
+}
+
 static void *video_thread(void *param)
 {
 	struct video_output *video = param;
-	uint64_t cur_time = os_gettime_ns();
+	uint64_t cur_time;
+
+	init_timing_thread(video->info.thread_sched, video->info.name);
+	os_set_thread_sleep_spin(video->info.sleep_spin_us);
+
+	cur_time = os_gettime_ns();
 
 	while (os_event_try(video->stop_event) == EAGAIN) {
+		bool on_time;
+		bool new_frame;
+
 		/* wait half a frame, update frame */
 		cur_time += (video->frame_time/2);
-		os_sleepto_ns(cur_time);
+		on_time = os_sleepto_ns(cur_time);
 
 		video->cur_video_time = cur_time;
 		os_event_signal(video->update_event);
 
 		/* wait another half a frame, swap and output frames */
 		cur_time += (video->frame_time/2);
-		os_sleepto_ns(cur_time);
+		on_time = os_sleepto_ns(cur_time) && on_time;
 
 		pthread_mutex_lock(&video->data_mutex);
 
-		video_swapframes(video);
-		video_output_cur_frame(video);
+		new_frame = video_swapframes(video);
+		video_output_cur_frame(video, new_frame);
+
+		video->total_frames++;
+		if (!on_time)
+			video->lagged_frames++;
 
 		pthread_mutex_unlock(&video->data_mutex);
 	}
@@ -227,13 +263,22 @@ static size_t video_get_input_idx(video_t video,
 static inline bool video_input_init(struct video_input *input,
 		struct video_output *video)
 {
-	if (input->conversion.width  != video->info.width ||
-	    input->conversion.height != video->info.height ||
-	    input->conversion.format != video->info.format) {
+	if (input->conversion.colorspace == VIDEO_CS_DEFAULT)
+		input->conversion.colorspace = video->info.colorspace;
+	if (input->conversion.range == VIDEO_RANGE_DEFAULT)
+		input->conversion.range = video->info.range;
+
+	if (input->conversion.width      != video->info.width      ||
+	    input->conversion.height     != video->info.height     ||
+	    input->conversion.format     != video->info.format     ||
+	    input->conversion.colorspace != video->info.colorspace ||
+	    input->conversion.range      != video->info.range) {
 		struct video_scale_info from = {
-			.format = video->info.format,
-			.width  = video->info.width,
-			.height = video->info.height,
+			.format     = video->info.format,
+			.width      = video->info.width,
+			.height     = video->info.height,
+			.colorspace = video->info.colorspace,
+			.range      = video->info.range,
 		};
 
 		int ret = video_scaler_create(&input->scaler,
@@ -391,3 +436,18 @@ double video_output_framerate(video_t video)
 
 	return (double)video->info.fps_num / (double)video->info.fps_den;
 }
+
+uint32_t video_output_total_frames(video_t video)
+{
+	return video ? video->total_frames : 0;
+}
+
+uint32_t video_output_lagged_frames(video_t video)
+{
+	return video ? video->lagged_frames : 0;
+}
+
+uint32_t video_output_duplicated_frames(video_t video)
+{
+	return video ? video->duplicated_frames : 0;
+}
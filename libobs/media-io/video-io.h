@@ -18,6 +18,7 @@
 #pragma once
 
 #include "media-io-defs.h"
+#include "../util/platform.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,6 +45,21 @@ enum video_format {
 	VIDEO_FORMAT_RGBA,
 	VIDEO_FORMAT_BGRA,
 	VIDEO_FORMAT_BGRX,
+
+	/* packed 444 format (Y, U, V, unused), used for unpacked async frames */
+	VIDEO_FORMAT_YUVX,
+};
+
+enum video_colorspace {
+	VIDEO_CS_DEFAULT,
+	VIDEO_CS_601,
+	VIDEO_CS_709,
+};
+
+enum video_range_type {
+	VIDEO_RANGE_DEFAULT,
+	VIDEO_RANGE_PARTIAL,
+	VIDEO_RANGE_FULL
 };
 
 struct video_data {
@@ -60,6 +76,15 @@ struct video_output_info {
 	uint32_t          fps_den;
 	uint32_t          width;
 	uint32_t          height;
+
+	/* timing thread scheduling, see os_set_thread_sched */
+	enum os_thread_sched thread_sched;
+
+	/* see os_set_thread_sleep_spin */
+	uint32_t          sleep_spin_us;
+
+	enum video_colorspace colorspace;
+	enum video_range_type range;
 };
 
 static inline bool format_is_yuv(enum video_format format)
@@ -70,6 +95,7 @@ static inline bool format_is_yuv(enum video_format format)
 	case VIDEO_FORMAT_YVYU:
 	case VIDEO_FORMAT_YUY2:
 	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_YUVX:
 		return true;
 	case VIDEO_FORMAT_NONE:
 	case VIDEO_FORMAT_RGBA:
@@ -89,18 +115,6 @@ enum video_scale_type {
 	VIDEO_SCALE_BICUBIC,
 };
 
-enum video_colorspace {
-	VIDEO_CS_DEFAULT,
-	VIDEO_CS_601,
-	VIDEO_CS_709,
-};
-
-enum video_range_type {
-	VIDEO_RANGE_DEFAULT,
-	VIDEO_RANGE_PARTIAL,
-	VIDEO_RANGE_FULL
-};
-
 struct video_scale_info {
 	enum video_format     format;
 	uint32_t              width;
@@ -115,6 +129,13 @@ EXPORT bool video_format_get_parameters(enum video_colorspace color_space,
 		enum video_range_type range, float matrix[16],
 		float min_range[3], float max_range[3]);
 
+/**
+ * Gets the RGB to YUV matrix for a color space and range.  Each row produces
+ * one component of a packed U, Y, V output texel.
+ */
+EXPORT bool video_format_get_output_matrix(enum video_colorspace color_space,
+		enum video_range_type range, float matrix[16]);
+
 #define VIDEO_OUTPUT_SUCCESS       0
 #define VIDEO_OUTPUT_INVALIDPARAM -1
 #define VIDEO_OUTPUT_FAIL         -2
@@ -143,6 +164,18 @@ EXPORT uint32_t video_output_width(video_t video);
 EXPORT uint32_t video_output_height(video_t video);
 EXPORT double video_output_framerate(video_t video);
 
+/** Number of frames the video thread has output so far */
+EXPORT uint32_t video_output_total_frames(video_t video);
+
+/** Number of frames where the video thread missed its deadline */
+EXPORT uint32_t video_output_lagged_frames(video_t video);
+
+/**
+ * Number of frames where no new frame was ready in time and the previous one
+ * was sent to the outputs again
+ */
+EXPORT uint32_t video_output_duplicated_frames(video_t video);
+
 
 #ifdef __cplusplus
 }
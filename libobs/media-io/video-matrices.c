@@ -208,3 +208,45 @@ bool video_format_get_parameters(enum video_colorspace color_space,
 	}
 	return false;
 }
+
+bool video_format_get_output_matrix(enum video_colorspace color_space,
+		enum video_range_type range, float matrix[16])
+{
+	bool  full_range = range == VIDEO_RANGE_FULL;
+	float y_scale    = full_range ? 1.0f : 219.0f/255.0f;
+	float c_scale    = full_range ? 1.0f : 224.0f/255.0f;
+	float y_offset   = full_range ? 0.0f : 16.0f/255.0f;
+	float c_offset   = 128.0f/255.0f;
+
+	for (size_t i = 0; i < NUM_FORMATS; i++) {
+		if (format_info[i].color_space != color_space)
+			continue;
+
+		float Kb = format_info[i].Kb;
+		float Kr = format_info[i].Kr;
+		float Kg = 1.0f - Kb - Kr;
+		float cb = c_scale * 0.5f / (1.0f - Kb);
+		float cr = c_scale * 0.5f / (1.0f - Kr);
+
+		matrix[ 0] = -Kr * cb;
+		matrix[ 1] = -Kg * cb;
+		matrix[ 2] = (1.0f - Kb) * cb;
+		matrix[ 3] = c_offset;
+
+		matrix[ 4] = Kr * y_scale;
+		matrix[ 5] = Kg * y_scale;
+		matrix[ 6] = Kb * y_scale;
+		matrix[ 7] = y_offset;
+
+		matrix[ 8] = (1.0f - Kr) * cr;
+		matrix[ 9] = -Kg * cr;
+		matrix[10] = -Kb * cr;
+		matrix[11] = c_offset;
+
+		matrix[12] = matrix[13] = matrix[14] = 0.0f;
+		matrix[15] = 1.0f;
+		return true;
+	}
+
+	return false;
+}
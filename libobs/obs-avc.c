@@ -33,57 +33,68 @@ enum {
 	NAL_FILLER    = 12,
 };
 
-enum {
-	NAL_PRIORITY_DISPOSABLE = 0,
-	NAL_PRIORITY_LOW        = 1,
-	NAL_PRIORITY_HIGH       = 2,
-	NAL_PRIORITY_HIGHEST    = 3,
-};
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <emmintrin.h>
 
-/* NOTE: I noticed that FFmpeg does some unusual special handling of certain
- * scenarios that I was unaware of, so instead of just searching for {0, 0, 1}
- * we'll just use the code from FFmpeg - http://www.ffmpeg.org/ */
-static const uint8_t *ff_avc_find_startcode_internal(const uint8_t *p,
+static inline int first_set_bit(int mask)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, (unsigned long)mask);
+	return (int)idx;
+#else
+	return __builtin_ctz((unsigned int)mask);
+#endif
+}
+
+/* finds the first {0, 0, 1} sequence, testing 16 positions at a time.  like
+ * the FFmpeg function it replaces, a start code ending on the very last byte
+ * of the buffer is not considered */
+static const uint8_t *find_startcode_internal(const uint8_t *p,
 		const uint8_t *end)
 {
-	const uint8_t *a = p + 4 - ((intptr_t)p & 3);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one  = _mm_set1_epi8(1);
+
+	while (end - p >= 19) {
+		__m128i b0 = _mm_loadu_si128((const __m128i*)p);
+		__m128i z0 = _mm_cmpeq_epi8(b0, zero);
+		__m128i b1, b2, match;
+		int     mask;
+
+		/* a start code can't begin at any of these positions if none
+		 * of them are zero, which is by far the most common case */
+		if (!_mm_movemask_epi8(z0)) {
+			p += 16;
+			continue;
+		}
 
-	for (end -= 3; p < a && p < end; p++) {
-		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
-			return p;
-	}
+		b1 = _mm_loadu_si128((const __m128i*)(p + 1));
+		b2 = _mm_loadu_si128((const __m128i*)(p + 2));
 
-	for (end -= 3; p < end; p += 4) {
-		uint32_t x = *(const uint32_t*)p;
-
-		if ((x - 0x01010101) & (~x) & 0x80808080) {
-			if (p[1] == 0) {
-				if (p[0] == 0 && p[2] == 1)
-					return p;
-				if (p[2] == 0 && p[3] == 1)
-					return p+1;
-			}
-
-			if (p[3] == 0) {
-				if (p[2] == 0 && p[4] == 1)
-					return p+2;
-				if (p[4] == 0 && p[5] == 1)
-					return p+3;
-			}
-		}
+		match = _mm_and_si128(z0, _mm_cmpeq_epi8(b1, zero));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(b2, one));
+
+		mask = _mm_movemask_epi8(match);
+		if (mask)
+			return p + first_set_bit(mask);
+
+		p += 16;
 	}
 
-	for (end += 3; p < end; p++) {
+	for (; end - p > 3; p++) {
 		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
 			return p;
 	}
 
-	return end + 3;
+	return end;
 }
 
 const uint8_t *obs_avc_find_startcode(const uint8_t *p, const uint8_t *end)
 {
-	const uint8_t *out= ff_avc_find_startcode_internal(p, end);
+	const uint8_t *out = find_startcode_internal(p, end);
 	if (p < out && out < end && !out[-1]) out--;
 	return out;
 }
@@ -91,19 +102,21 @@ const uint8_t *obs_avc_find_startcode(const uint8_t *p, const uint8_t *end)
 static inline int get_drop_priority(int priority)
 {
 	switch (priority) {
-	case NAL_PRIORITY_DISPOSABLE: return NAL_PRIORITY_DISPOSABLE;
-	case NAL_PRIORITY_LOW:        return NAL_PRIORITY_LOW;
+	case OBS_NAL_PRIORITY_DISPOSABLE: return OBS_NAL_PRIORITY_DISPOSABLE;
+	case OBS_NAL_PRIORITY_LOW:        return OBS_NAL_PRIORITY_LOW;
 	}
 
-	return NAL_PRIORITY_HIGHEST;
+	return OBS_NAL_PRIORITY_HIGHEST;
 }
 
-static void serialize_avc_data(struct serializer *s, const uint8_t *data,
-		size_t size, bool *is_keyframe, int *priority)
+/* calls the callback for each NAL unit (without start code) in an Annex-B
+ * bitstream.  the bitstream is only scanned once */
+static void parse_nal_units(const uint8_t *data, size_t size,
+		void (*callback)(void *param, const uint8_t *nal, size_t size),
+		void *param)
 {
 	const uint8_t *nal_start, *nal_end;
 	const uint8_t *end = data+size;
-	int type;
 
 	nal_start = obs_avc_find_startcode(data, end);
 	while (true) {
@@ -112,36 +125,68 @@ static void serialize_avc_data(struct serializer *s, const uint8_t *data,
 		if (nal_start == end)
 			break;
 
-		type = nal_start[0] & 0x1F;
-
-		if (type == NAL_SLICE_IDR || type == NAL_SLICE) {
-			if (is_keyframe)
-				*is_keyframe = (type == NAL_SLICE_IDR);
-			if (priority)
-				*priority = nal_start[0] >> 5;
-		}
-
 		nal_end = obs_avc_find_startcode(nal_start, end);
-		s_wb32(s, (uint32_t)(nal_end - nal_start));
-		s_write(s, nal_start, nal_end - nal_start);
+		callback(param, nal_start, nal_end - nal_start);
 		nal_start = nal_end;
 	}
 }
 
+struct avc_packet_parse {
+	uint8_t *out;
+	bool    has_slice;
+	bool    keyframe;
+	int     priority;
+};
+
+static inline uint8_t *write_be32(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)(val >> 24);
+	*(p++) = (uint8_t)(val >> 16);
+	*(p++) = (uint8_t)(val >> 8);
+	*(p++) = (uint8_t)val;
+	return p;
+}
+
+static void convert_nal(void *param, const uint8_t *nal, size_t size)
+{
+	struct avc_packet_parse *parse = param;
+	int type = nal[0] & 0x1F;
+
+	if (type == NAL_SLICE_IDR || type == NAL_SLICE) {
+		int priority = nal[0] >> 5;
+
+		parse->has_slice = true;
+		if (type == NAL_SLICE_IDR)
+			parse->keyframe = true;
+		if (parse->priority < priority)
+			parse->priority = priority;
+	}
+
+	parse->out = write_be32(parse->out, (uint32_t)size);
+	memcpy(parse->out, nal, size);
+	parse->out += size;
+}
+
 void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 		const struct encoder_packet *src)
 {
-	struct array_output_data output;
-	struct serializer s;
+	struct avc_packet_parse parse = {0};
 
-	array_output_serializer_init(&s, &output);
 	*avc_packet = *src;
 
-	serialize_avc_data(&s, src->data, src->size, &avc_packet->keyframe,
-			&avc_packet->priority);
+	/* every NAL unit has a start code of at least 3 bytes which gets
+	 * replaced with a 4 byte size, so this is the worst case */
+	avc_packet->data = bmalloc(src->size + src->size / 3 + 4);
+	parse.out = avc_packet->data;
+
+	parse_nal_units(src->data, src->size, convert_nal, &parse);
+
+	if (parse.has_slice) {
+		avc_packet->keyframe = parse.keyframe;
+		avc_packet->priority = parse.priority;
+	}
 
-	avc_packet->data          = output.bytes.array;
-	avc_packet->size          = output.bytes.num;
+	avc_packet->size          = parse.out - avc_packet->data;
 	avc_packet->drop_priority = get_drop_priority(avc_packet->priority);
 }
 
@@ -153,33 +198,22 @@ static inline bool has_start_code(const uint8_t *data)
 	return data[2] == 1 || (data[2] == 0 && data[3] == 1);
 }
 
-static void get_sps_pps(const uint8_t *data, size_t size,
-		const uint8_t **sps, size_t *sps_size,
-		const uint8_t **pps, size_t *pps_size)
-{
-	const uint8_t *nal_start, *nal_end;
-	const uint8_t *end = data+size;
-	int type;
-
-	nal_start = obs_avc_find_startcode(data, end);
-	while (true) {
-		while (nal_start < end && !*(nal_start++));
-
-		if (nal_start == end)
-			break;
-
-		nal_end = obs_avc_find_startcode(nal_start, end);
-
-		type = nal_start[0] & 0x1F;
-		if (type == NAL_SPS) {
-			*sps = nal_start;
-			*sps_size = nal_end - nal_start;
-		} else if (type == NAL_PPS) {
-			*pps = nal_start;
-			*pps_size = nal_end - nal_start;
-		}
+struct avc_header_parse {
+	const uint8_t *sps, *pps;
+	size_t        sps_size, pps_size;
+};
 
-		nal_start = nal_end;
+static void find_sps_pps(void *param, const uint8_t *nal, size_t size)
+{
+	struct avc_header_parse *parse = param;
+	int type = nal[0] & 0x1F;
+
+	if (type == NAL_SPS) {
+		parse->sps      = nal;
+		parse->sps_size = size;
+	} else if (type == NAL_PPS) {
+		parse->pps      = nal;
+		parse->pps_size = size;
 	}
 }
 
@@ -187,8 +221,9 @@ size_t obs_parse_avc_header(uint8_t **header, const uint8_t *data, size_t size)
 {
 	struct array_output_data output;
 	struct serializer s;
-	const uint8_t *sps = NULL, *pps = NULL;
-	size_t sps_size = 0, pps_size = 0;
+	struct avc_header_parse parse = {0};
+	const uint8_t *sps, *pps;
+	size_t sps_size, pps_size;
 
 	array_output_serializer_init(&s, &output);
 
@@ -199,7 +234,12 @@ size_t obs_parse_avc_header(uint8_t **header, const uint8_t *data, size_t size)
 		return size;
 	}
 
-	get_sps_pps(data, size, &sps, &sps_size, &pps, &pps_size);
+	parse_nal_units(data, size, find_sps_pps, &parse);
+	sps      = parse.sps;
+	pps      = parse.pps;
+	sps_size = parse.sps_size;
+	pps_size = parse.pps_size;
+
 	if (!sps || !pps || sps_size < 4)
 		return 0;
 
@@ -25,6 +25,13 @@ extern "C" {
 
 struct encoder_packet;
 
+enum {
+	OBS_NAL_PRIORITY_DISPOSABLE = 0,
+	OBS_NAL_PRIORITY_LOW        = 1,
+	OBS_NAL_PRIORITY_HIGH       = 2,
+	OBS_NAL_PRIORITY_HIGHEST    = 3,
+};
+
 /* Helpers for parsing AVC NAL units.  */
 
 EXPORT const uint8_t *obs_avc_find_startcode(const uint8_t *p,
@@ -54,20 +54,24 @@ obs_display_t obs_display_create(struct gs_init_data *graphics_data)
 		graphics_data->num_backbuffers = 1;
 
 	if (!obs_display_init(display, graphics_data)) {
-		obs_display_destroy(display);
-		display = NULL;
-	} else {
-		pthread_mutex_lock(&obs->data.displays_mutex);
-		display->prev_next      = &obs->data.first_display;
-		display->next           = obs->data.first_display;
-		obs->data.first_display = display;
-		if (display->next)
-			display->next->prev_next = &display->next;
-		pthread_mutex_unlock(&obs->data.displays_mutex);
+		obs_display_free(display);
+		gs_leavecontext();
+		bfree(display);
+		return NULL;
 	}
 
 	gs_leavecontext();
 
+	/* the display thread enters the graphics context while holding the
+	 * displays mutex, so don't lock it from within the context */
+	pthread_mutex_lock(&obs->data.displays_mutex);
+	display->prev_next      = &obs->data.first_display;
+	display->next           = obs->data.first_display;
+	obs->data.first_display = display;
+	if (display->next)
+		display->next->prev_next = &display->next;
+	pthread_mutex_unlock(&obs->data.displays_mutex);
+
 	return display;
 }
 
@@ -164,13 +168,15 @@ static inline void render_display_begin(struct obs_display *display)
 	gs_setviewport(0, 0, display->cx, display->cy);
 }
 
-static inline void render_display_end()
+static inline void render_display_end(bool present)
 {
 	gs_endscene();
-	gs_present();
+
+	if (present)
+		gs_present();
 }
 
-void render_display(struct obs_display *display)
+void render_display(struct obs_display *display, bool present)
 {
 	if (!display) return;
 
@@ -187,5 +193,27 @@ void render_display(struct obs_display *display)
 
 	pthread_mutex_unlock(&display->draw_callbacks_mutex);
 
-	render_display_end();
+	render_display_end(present);
+}
+
+/*
+ * Used by the display thread.  The graphics context is only held while the
+ * display renders, and the present (which can wait for vertical sync) is done
+ * after it has been released when the graphics subsystem allows it, so the
+ * video thread isn't held up by it.
+ */
+void render_display_threaded(struct obs_display *display)
+{
+	graphics_t graphics = obs_graphics();
+
+	gs_entercontext(graphics);
+	render_display(display, false);
+	gs_leavecontext();
+
+	if (!gs_present_swapchain(graphics, display->swap)) {
+		gs_entercontext(graphics);
+		gs_load_swapchain(display->swap);
+		gs_present();
+		gs_leavecontext();
+	}
 }
@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include "util/platform.h"
+#include "util/profiler.h"
 #include "obs.h"
 #include "obs-internal.h"
 
@@ -77,7 +79,8 @@ static struct obs_encoder *create_encoder(const char *id,
 
 	obs_context_data_insert(&encoder->context,
 			&obs->data.encoders_mutex,
-			&obs->data.first_encoder);
+			&obs->data.first_encoder,
+			&obs->data.encoders_index);
 
 	return encoder;
 }
@@ -260,9 +263,28 @@ void obs_encoder_update(obs_encoder_t encoder, obs_data_t settings)
 
 	obs_data_apply(encoder->context.settings, settings);
 
-	if (encoder->info.update && encoder->context.data)
+	if (encoder->info.update && encoder->context.data) {
 		encoder->info.update(encoder->context.data,
 				encoder->context.settings);
+
+		/* settings take precedence over any runtime bitrate */
+		os_atomic_set_long(&encoder->requested_bitrate, 0);
+	}
+}
+
+bool obs_encoder_request_bitrate(obs_encoder_t encoder, uint32_t bitrate)
+{
+	if (!encoder || !encoder->info.update_bitrate || !bitrate)
+		return false;
+
+	os_atomic_set_long(&encoder->requested_bitrate, (long)bitrate);
+	return true;
+}
+
+uint32_t obs_encoder_get_bitrate(obs_encoder_t encoder)
+{
+	return encoder ?
+		(uint32_t)os_atomic_load_long(&encoder->requested_bitrate) : 0;
 }
 
 bool obs_encoder_get_extra_data(obs_encoder_t encoder, uint8_t **extra_data,
@@ -321,8 +343,10 @@ bool obs_encoder_initialize(obs_encoder_t encoder)
 	if (!encoder->context.data)
 		return false;
 
-	encoder->paired_encoder  = NULL;
-	encoder->start_ts        = 0;
+	encoder->paired_encoder         = NULL;
+	encoder->start_ts               = 0;
+	encoder->applied_bitrate        = 0;
+	os_atomic_set_long(&encoder->requested_bitrate, 0);
 
 	if (encoder->info.type == OBS_ENCODER_AUDIO)
 		intitialize_audio_encoder(encoder);
@@ -498,22 +522,54 @@ static void full_stop(struct obs_encoder *encoder)
 	}
 }
 
+static inline void update_bitrate(struct obs_encoder *encoder)
+{
+	long bitrate = os_atomic_load_long(&encoder->requested_bitrate);
+
+	if (bitrate == encoder->applied_bitrate)
+		return;
+
+	encoder->applied_bitrate = bitrate;
+
+	/* a request of 0 means obs_encoder_update has already reapplied the
+	 * bitrate from the settings */
+	if (!bitrate)
+		return;
+
+	if (!encoder->info.update_bitrate(encoder->context.data,
+				(uint32_t)bitrate))
+		blog(LOG_WARNING, "Encoder '%s' failed to change bitrate to "
+				"%ld", encoder->context.name, bitrate);
+}
+
 static inline void do_encode(struct obs_encoder *encoder,
 		struct encoder_frame *frame)
 {
 	struct encoder_packet pkt = {0};
+	uint64_t start_time;
 	bool received = false;
 	bool success;
 
+	profile_start("do_encode");
+
+	if (encoder->info.update_bitrate)
+		update_bitrate(encoder);
+
 	pkt.timebase_num = encoder->timebase_num;
 	pkt.timebase_den = encoder->timebase_den;
 
+	start_time = os_gettime_ns();
 	success = encoder->info.encode(encoder->context.data, frame, &pkt,
 			&received);
+
+	if (encoder->info.type == OBS_ENCODER_VIDEO)
+		obs_add_time_sample(obs->video.encode_times,
+				os_gettime_ns() - start_time);
 	if (!success) {
 		full_stop(encoder);
 		blog(LOG_ERROR, "Error encoding with encoder '%s'",
 				encoder->context.name);
+		profile_end("do_encode");
 		return;
 	}
 
@@ -532,6 +588,8 @@ static inline void do_encode(struct obs_encoder *encoder,
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 	}
+
+	profile_end("do_encode");
 }
 
 static void receive_video(void *param, struct video_data *frame)
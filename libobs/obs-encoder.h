@@ -211,6 +211,18 @@ struct obs_encoder_info {
 	 *                    otherwise
 	 */
 	bool (*video_info)(void *data, struct video_scale_info *info);
+
+	/**
+	 * Changes the target bitrate of the encoder at runtime.  This is
+	 * called from the encoding thread, between frames, in response to
+	 * obs_encoder_request_bitrate (usually by an output reacting to
+	 * network conditions).  It does not modify the encoder settings.
+	 *
+	 * @param  data     Data associated with this encoder context
+	 * @param  bitrate  New target bitrate, in kbps
+	 * @return          true if successful, false otherwise
+	 */
+	bool (*update_bitrate)(void *data, uint32_t bitrate);
 };
 
 EXPORT void obs_register_encoder_s(const struct obs_encoder_info *info,
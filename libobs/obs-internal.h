@@ -22,6 +22,7 @@
 #include "util/circlebuf.h"
 #include "util/dstr.h"
 #include "util/threading.h"
+#include "util/job-pool.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -34,6 +35,10 @@
 #include "obs.h"
 
 #define NUM_TEXTURES 2
+#define NUM_GPU_TIMERS 4
+
+/* frame readbacks in flight, the oldest one is downloaded each frame */
+#define NUM_STAGE_SURFACES 3
 #define MICROSECOND_DEN 1000000
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
@@ -93,17 +98,21 @@ extern void obs_display_free(struct obs_display *display);
 
 struct obs_core_video {
 	graphics_t                      graphics;
-	stagesurf_t                     copy_surfaces[NUM_TEXTURES];
+	stagesurf_t                     copy_surfaces[NUM_STAGE_SURFACES];
+	bool                            surfaces_copied[NUM_STAGE_SURFACES];
+	int                             cur_surface;
 	texture_t                       render_textures[NUM_TEXTURES];
 	texture_t                       output_textures[NUM_TEXTURES];
 	texture_t                       convert_textures[NUM_TEXTURES];
 	bool                            textures_rendered[NUM_TEXTURES];
 	bool                            textures_output[NUM_TEXTURES];
-	bool                            textures_copied[NUM_TEXTURES];
 	bool                            textures_converted[NUM_TEXTURES];
 	struct source_frame             convert_frames[NUM_TEXTURES];
 	effect_t                        default_effect;
 	effect_t                        conversion_effect;
+	effect_t                        bicubic_effect;
+	effect_t                        bilinear_effect;
+	effect_t                        lanczos_effect;
 	stagesurf_t                     mapped_surface;
 	int                             cur_texture;
 
@@ -111,8 +120,54 @@ struct obs_core_video {
 	pthread_t                       video_thread;
 	bool                            thread_initialized;
 
+	bool                            threaded_displays;
+	pthread_t                       display_thread;
+	os_event_t                      display_stop_event;
+	bool                            display_thread_initialized;
+	uint32_t                        display_fps;
+	uint64_t                        display_interval_ns;
+	int                             main_texture;
+
+	/* sources whose CPU-side tick work runs on the job pool */
+	DARRAY(struct obs_source*)      tick_sources;
+	float                           tick_seconds;
+
+	uint32_t                        rendered_frames;
+	uint32_t                        readback_stalls;
+	uint64_t                        readback_stall_time;
+	volatile long                   render_times[OBS_TIME_HISTOGRAM_BUCKETS];
+	volatile long                   encode_times[OBS_TIME_HISTOGRAM_BUCKETS];
+	uint64_t                        last_stats_time;
+
+	/* scene items culled while rendering the main texture */
+	bool                            counting_culled;
+	uint32_t                        frame_culled_items;
+	uint32_t                        culled_items;
+
+	/* draw calls and sprites of the last main texture render */
+	uint32_t                        draw_calls;
+	uint32_t                        sprites;
+
 	bool                            gpu_conversion;
 	const char                      *conversion_tech;
+
+	/* RGB to YUV conversion of the output texture */
+	bool                            output_yuv;
+	float                           output_matrix[16];
+
+	/* RGB output at the base size, staged from the render texture */
+	bool                            direct_output;
+
+	/* separable output scaling: horizontal pass into scale_texture,
+	 * vertical pass into the output texture */
+	enum obs_scale_type             scale_type;
+	effect_t                        scale_effect;
+	texture_t                       scale_texture;
+
+	/* GPU time of the scale passes while profiling.  results are read a
+	 * few frames later so that the video thread never waits on them */
+	gputimer_t                      scale_timers[NUM_GPU_TIMERS];
+	size_t                          cur_scale_timer;
 	uint32_t                        conversion_height;
 	uint32_t                        plane_offsets[3];
 	uint32_t                        plane_sizes[3];
@@ -134,10 +189,20 @@ struct obs_core_audio {
 	float                           present_volume;
 };
 
+/* name lookup table for contexts, protected by the mutex of the list the
+ * contexts are in */
+struct obs_context_index {
+	struct obs_context_data         **buckets;
+	size_t                          num_buckets;
+	size_t                          count;
+	uint64_t                        next_order;
+};
+
 /* user sources, output channels, and displays */
 struct obs_core_data {
 	pthread_mutex_t                 user_sources_mutex;
 	DARRAY(struct obs_source*)      user_sources;
+	uint64_t                        next_user_order;
 
 	struct obs_source               *first_source;
 	struct obs_display              *first_display;
@@ -151,6 +216,11 @@ struct obs_core_data {
 	pthread_mutex_t                 encoders_mutex;
 	pthread_mutex_t                 services_mutex;
 
+	struct obs_context_index        sources_index;
+	struct obs_context_index        outputs_index;
+	struct obs_context_index        encoders_index;
+	struct obs_context_index        services_index;
+
 	struct obs_view                 main_view;
 
 	long long                       unnamed_index;
@@ -172,6 +242,9 @@ struct obs_core {
 	signal_handler_t                signals;
 	proc_handler_t                  procs;
 
+	/* worker threads shared by source ticking and frame unpacking */
+	job_pool_t                      job_pool;
+
 	/* segmented into multiple sub-structures to keep things a bit more
 	 * clean and organized */
 	struct obs_core_video           video;
@@ -182,6 +255,21 @@ struct obs_core {
 extern struct obs_core *obs;
 
 extern void *obs_video_thread(void *param);
+extern void *obs_display_thread(void *param);
+
+static inline void obs_add_time_sample(volatile long *histogram,
+		uint64_t time_ns)
+{
+	uint64_t ms     = time_ns / 1000000;
+	int      bucket = 0;
+
+	while (ms && bucket < OBS_TIME_HISTOGRAM_BUCKETS - 1) {
+		ms >>= 1;
+		bucket++;
+	}
+
+	os_atomic_inc_long(histogram + bucket);
+}
 
 
 /* ------------------------------------------------------------------------- */
@@ -197,6 +285,12 @@ struct obs_context_data {
 	pthread_mutex_t                 *mutex;
 	struct obs_context_data         *next;
 	struct obs_context_data         **prev_next;
+
+	struct obs_context_index        *index;
+	uint32_t                        name_hash;
+	uint64_t                        index_order;
+	struct obs_context_data         *hash_next;
+	struct obs_context_data         **hash_prev_next;
 };
 
 extern bool obs_context_data_init(
@@ -206,12 +300,18 @@ extern bool obs_context_data_init(
 extern void obs_context_data_free(struct obs_context_data *context);
 
 extern void obs_context_data_insert(struct obs_context_data *context,
-		pthread_mutex_t *mutex, void *first);
+		pthread_mutex_t *mutex, void *first,
+		struct obs_context_index *index);
 extern void obs_context_data_remove(struct obs_context_data *context);
 
 extern void obs_context_data_setname(struct obs_context_data *context,
 		const char *name);
 
+extern struct obs_context_data *obs_context_index_find(
+		struct obs_context_index *index, const char *name,
+		struct obs_context_data *prev);
+extern void obs_context_index_free(struct obs_context_index *index);
+
 
 /* ------------------------------------------------------------------------- */
 /* sources  */
@@ -224,6 +324,18 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	bool                            defer_update;
 
+	/* time spent ticking the source for the last frame, in nanoseconds */
+	uint64_t                        tick_prepare_time;
+	uint64_t                        tick_time;
+
+	/* time spent uploading the last async frame, in nanoseconds */
+	uint64_t                        upload_time;
+
+	/* whether the source was drawn or culled since the last tick, see
+	 * obs_source_skip_video */
+	bool                            video_rendered;
+	bool                            video_skipped;
+
 	/* ensures show/hide are only called once */
 	volatile long                   show_refs;
 
@@ -238,6 +350,11 @@ struct obs_source {
 	 * to handle things but it's the best option) */
 	bool                            removed;
 
+	/* whether the source is in the user source list, and when it was
+	 * added to it */
+	bool                            user_source;
+	uint64_t                        user_order;
+
 	/* timing (if video is present, is based upon video) */
 	volatile bool                   timing_set;
 	volatile uint64_t               timing_adjust;
@@ -285,8 +402,17 @@ struct obs_source {
 
 	/* async video data */
 	texture_t                       async_texture;
+	texture_t                       async_plane_textures[2];
 	texrender_t                     async_convert_texrender;
 	bool                            async_gpu_conversion;
+
+	/* format and size of frames to unpack on the thread that outputs
+	 * them, set by the render thread */
+	pthread_mutex_t                 async_mutex;
+	bool                            async_cpu_conversion;
+	enum video_format               async_cpu_format;
+	uint32_t                        async_cpu_width;
+	uint32_t                        async_cpu_height;
 	enum video_format               async_format;
 	float                           async_color_matrix[16];
 	bool                            async_full_range;
@@ -307,6 +433,12 @@ struct obs_source {
 	pthread_mutex_t                 filter_mutex;
 	texrender_t                     filter_texrender;
 	bool                            rendering_filter;
+
+	/* cached filter chain output (OBS_SOURCE_CACHEABLE) */
+	texrender_t                     cache_texrender;
+	volatile bool                   cache_valid;
+	uint32_t                        cache_cx;
+	uint32_t                        cache_cy;
 };
 
 extern bool obs_source_init_context(struct obs_source *source,
@@ -323,8 +455,17 @@ enum view_type {
 
 extern void obs_source_activate(obs_source_t source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t source, enum view_type type);
+extern bool obs_source_video_tick_begin(obs_source_t source);
+extern void obs_source_video_tick_prepare(obs_source_t source, float seconds);
 extern void obs_source_video_tick(obs_source_t source, float seconds);
 
+/* default effect technique the source draws with, NULL if it can't batch */
+extern const char *obs_source_batch_technique(obs_source_t source);
+extern void obs_source_batch_render(obs_source_t source, effect_t effect);
+
+extern bool obs_source_opaque(obs_source_t source);
+extern void obs_source_skip_video(obs_source_t source);
+
 
 /* ------------------------------------------------------------------------- */
 /* outputs  */
@@ -388,6 +529,14 @@ struct obs_encoder {
 
 	int64_t                         cur_pts;
 
+	/* runtime bitrate requested by outputs, applied in the encoding
+	 * thread.  0 means the bitrate from the settings is used.  only
+	 * accessed with os_atomic_* */
+	volatile long                   requested_bitrate;
+
+	/* encoding thread only */
+	long                            applied_bitrate;
+
 	struct circlebuf                audio_input_buffer[MAX_AV_PLANES];
 	uint8_t                         *audio_output_buffer[MAX_AV_PLANES];
 
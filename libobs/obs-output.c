@@ -85,7 +85,8 @@ obs_output_t obs_output_create(const char *id, const char *name,
 
 	obs_context_data_insert(&output->context,
 			&obs->data.outputs_mutex,
-			&obs->data.first_output);
+			&obs->data.first_output,
+			&obs->data.outputs_index);
 
 	return output;
 
@@ -17,6 +17,7 @@
 
 #include "util/threading.h"
 #include "graphics/math-defs.h"
+#include "graphics/axisang.h"
 #include "obs-scene.h"
 
 static const char *obs_scene_signals[] = {
@@ -49,6 +50,8 @@ static void *scene_create(obs_data_t settings, struct obs_source *source)
 	struct obs_scene *scene = bmalloc(sizeof(struct obs_scene));
 	scene->source     = source;
 	scene->first_item = NULL;
+	scene->list_dirty = false;
+	da_init(scene->draw_list);
 
 	signal_handler_add_array(obs_source_signalhandler(source),
 			obs_scene_signals);
@@ -94,6 +97,7 @@ static void scene_destroy(void *data)
 	struct obs_scene *scene = data;
 
 	remove_all_items(scene);
+	da_free(scene->draw_list);
 	pthread_mutex_destroy(&scene->mutex);
 	bfree(scene);
 }
@@ -123,6 +127,8 @@ static void scene_enum_sources(void *data,
 
 static inline void detach_sceneitem(struct obs_scene_item *item)
 {
+	item->parent->list_dirty = true;
+
 	if (item->prev)
 		item->prev->next = item->next;
 	else
@@ -138,6 +144,7 @@ static inline void attach_sceneitem(struct obs_scene_item *item,
 		struct obs_scene_item *prev)
 {
 	item->prev = prev;
+	item->parent->list_dirty = true;
 
 	if (prev) {
 		item->next = prev->next;
@@ -152,37 +159,253 @@ static inline void attach_sceneitem(struct obs_scene_item *item,
 	}
 }
 
-static void scene_video_render(void *data, effect_t effect)
+static void rebuild_draw_list(struct obs_scene *scene)
 {
-	struct obs_scene *scene = data;
-	struct obs_scene_item *item;
+	struct obs_scene_item *item = scene->first_item;
 
-	pthread_mutex_lock(&scene->mutex);
-
-	item = scene->first_item;
+	da_resize(scene->draw_list, 0);
 
 	while (item) {
-		if (obs_source_removed(item->source)) {
-			struct obs_scene_item *del_item = item;
-			item = item->next;
+		da_push_back(scene->draw_list, &item);
+		item = item->next;
+	}
+
+	scene->list_dirty = false;
+}
+
+static void update_item_transform(struct obs_scene_item *item)
+{
+	struct matrix3 *mat = &item->draw_transform;
+	struct vec3    origin, scale, pos;
+	struct axisang rot;
+
+	vec3_set(&origin, item->origin.x, item->origin.y, 0.0f);
+	vec3_set(&scale, item->scale.x, item->scale.y, 1.0f);
+	vec3_set(&pos, -item->pos.x, -item->pos.y, 0.0f);
+	axisang_set(&rot, 0.0f, 0.0f, 1.0f, RAD(-item->rot));
+
+	matrix3_identity(mat);
+	matrix3_translate(mat, mat, &origin);
+	matrix3_scale(mat, mat, &scale);
+	matrix3_rotate_aa(mat, mat, &rot);
+	matrix3_translate(mat, mat, &pos);
+
+	item->transform_dirty = false;
+}
+
+/*
+ * consecutive items drawn with the same default effect technique share a
+ * single technique begin/end rather than each setting up their own
+ */
+struct draw_batch {
+	effect_t    effect;
+	technique_t tech;
+	const char  *tech_name;
+};
+
+static inline void end_batch(struct draw_batch *batch)
+{
+	if (batch->tech_name) {
+		technique_endpass(batch->tech);
+		technique_end(batch->tech);
+		batch->tech_name = NULL;
+	}
+}
+
+static inline void begin_batch(struct draw_batch *batch, const char *name)
+{
+	batch->tech = effect_gettechnique(batch->effect, name);
+	if (!batch->tech)
+		return;
+
+	/* multi-pass techniques are left to the source to draw */
+	if (technique_begin(batch->tech) != 1) {
+		technique_end(batch->tech);
+		return;
+	}
+
+	technique_beginpass(batch->tech, 0);
+	batch->tech_name = name;
+}
+
+static inline void render_item(struct draw_batch *batch,
+		struct obs_scene_item *item)
+{
+	const char *tech_name = obs_source_batch_technique(item->source);
+
+	if (tech_name != batch->tech_name) {
+		end_batch(batch);
+		if (tech_name)
+			begin_batch(batch, tech_name);
+	}
+
+	if (item->transform_dirty)
+		update_item_transform(item);
+
+	gs_matrix_push();
+	gs_matrix_mul(&item->draw_transform);
+
+	if (batch->tech_name)
+		obs_source_batch_render(item->source, batch->effect);
+	else
+		obs_source_video_render(item->source);
+
+	gs_matrix_pop();
+}
+
+static inline void transform_point(struct vec3 *dst, float x, float y,
+		const struct matrix3 *m)
+{
+	struct vec3 temp;
+
+	vec3_mulf(dst, &m->x, x);
+	vec3_mulf(&temp, &m->y, y);
+	vec3_add(dst, dst, &temp);
+	vec3_add(dst, dst, &m->t);
+}
+
+/* returns whether the item lines up with the canvas axes */
+static bool get_item_bounds(struct obs_scene_item *item, struct bounds *b)
+{
+	uint32_t       cx = obs_source_getwidth(item->source);
+	uint32_t       cy = obs_source_getheight(item->source);
+	struct matrix3 world;
+	struct vec3    p;
+
+	if (item->transform_dirty)
+		update_item_transform(item);
+
+	gs_matrix_push();
+	gs_matrix_mul(&item->draw_transform);
+	gs_matrix_get(&world);
+	gs_matrix_pop();
+
+	transform_point(&p, 0.0f, 0.0f, &world);
+	vec3_copy(&b->min, &p);
+	vec3_copy(&b->max, &p);
+
+	transform_point(&p, (float)cx, 0.0f, &world);
+	bounds_merge_point(b, b, &p);
+	transform_point(&p, 0.0f, (float)cy, &world);
+	bounds_merge_point(b, b, &p);
+	transform_point(&p, (float)cx, (float)cy, &world);
+	bounds_merge_point(b, b, &p);
+
+	return (close_float(world.x.y, 0.0f, EPSILON) &&
+	        close_float(world.y.x, 0.0f, EPSILON)) ||
+	       (close_float(world.x.x, 0.0f, EPSILON) &&
+	        close_float(world.y.y, 0.0f, EPSILON));
+}
 
-			obs_sceneitem_remove(del_item);
+#define MAX_OCCLUDERS 16
+
+/* the area the scene is being drawn in to, from the current orthographic
+ * projection.  scenes can be drawn in to displays, projectors and nested
+ * scenes, not just the base canvas */
+static bool get_canvas_bounds(struct bounds *canvas)
+{
+	float       left, right, top, bottom;
+	struct vec3 corner;
+
+	if (!gs_get_ortho(&left, &right, &top, &bottom))
+		return false;
+
+	vec3_set(&canvas->min, left, top, 0.0f);
+	vec3_copy(&canvas->max, &canvas->min);
+	vec3_set(&corner, right, bottom, 0.0f);
+	bounds_merge_point(canvas, canvas, &corner);
+	return true;
+}
+
+/*
+ * walks the items from top to bottom, culling items that are hidden, lie
+ * outside of the area being drawn to, or are fully covered by a single
+ * opaque, axis-aligned item above them
+ */
+static void cull_items(struct obs_scene *scene)
+{
+	struct bounds occluders[MAX_OCCLUDERS];
+	size_t        num_occluders = 0;
+	struct bounds canvas;
+	bool          have_canvas = get_canvas_bounds(&canvas);
+	size_t        i = scene->draw_list.num;
+
+	while (i-- > 0) {
+		struct obs_scene_item *item = scene->draw_list.array[i];
+		struct bounds         *b    = &item->draw_bounds;
+		bool                  axis_aligned;
+		size_t                j;
+
+		item->culled = !item->visible;
+		if (item->culled || obs_source_removed(item->source))
+			continue;
+
+		/* sizeless sources may still draw, so leave them be */
+		if (!obs_source_getwidth(item->source) ||
+		    !obs_source_getheight(item->source))
+			continue;
+
+		axis_aligned = get_item_bounds(item, b);
+
+		if (have_canvas && !bounds_intersects(&canvas, b, 0.0f)) {
+			item->culled = true;
 			continue;
 		}
 
-		gs_matrix_push();
-		gs_matrix_translate3f(item->origin.x, item->origin.y, 0.0f);
-		gs_matrix_scale3f(item->scale.x, item->scale.y, 1.0f);
-		gs_matrix_rotaa4f(0.0f, 0.0f, 1.0f, RAD(-item->rot));
-		gs_matrix_translate3f(-item->pos.x, -item->pos.y, 0.0f);
+		for (j = 0; j < num_occluders; j++) {
+			if (bounds_inside(&occluders[j], b)) {
+				item->culled = true;
+				break;
+			}
+		}
 
-		obs_source_video_render(item->source);
+		if (!item->culled && axis_aligned &&
+		    num_occluders < MAX_OCCLUDERS &&
+		    obs_source_opaque(item->source))
+			bounds_copy(&occluders[num_occluders++], b);
+	}
+}
 
-		gs_matrix_pop();
+static void scene_video_render(void *data, effect_t effect)
+{
+	struct obs_scene  *scene = data;
+	struct draw_batch batch  = {obs->video.default_effect, NULL, NULL};
+	size_t            i;
 
-		item = item->next;
+	pthread_mutex_lock(&scene->mutex);
+
+	if (scene->list_dirty)
+		rebuild_draw_list(scene);
+
+	cull_items(scene);
+
+	/* items that share effect state (for example the same source shown
+	 * several times) are merged into one draw */
+	gs_sprite_batch_begin();
+
+	for (i = 0; i < scene->draw_list.num; i++) {
+		struct obs_scene_item *item = scene->draw_list.array[i];
+
+		/* the list is rebuilt on the next frame */
+		if (obs_source_removed(item->source)) {
+			obs_sceneitem_remove(item);
+			continue;
+		}
+
+		/* culled items skip their filter chains as well */
+		if (item->culled) {
+			obs_source_skip_video(item->source);
+			if (obs->video.counting_culled)
+				obs->video.frame_culled_items++;
+			continue;
+		}
+
+		render_item(&batch, item);
 	}
 
+	end_batch(&batch);
+	gs_sprite_batch_end();
+
 	pthread_mutex_unlock(&scene->mutex);
 
 	UNUSED_PARAMETER(effect);
@@ -207,6 +430,7 @@ static void scene_load_item(struct obs_scene *scene, obs_data_t item_data)
 	obs_data_get_vec2(item_data, "origin", &item->origin);
 	obs_data_get_vec2(item_data, "pos",    &item->pos);
 	obs_data_get_vec2(item_data, "scale",  &item->scale);
+	item->transform_dirty = true;
 	obs_source_release(source);
 }
 
@@ -397,6 +621,7 @@ obs_sceneitem_t obs_scene_add(obs_scene_t scene, obs_source_t source)
 	item->visible = true;
 	item->parent  = scene;
 	item->ref     = 1;
+	item->transform_dirty = true;
 	vec2_set(&item->scale, 1.0f, 1.0f);
 
 	obs_source_addref(source);
@@ -415,6 +640,8 @@ obs_sceneitem_t obs_scene_add(obs_scene_t scene, obs_source_t source)
 		item->prev = last;
 	}
 
+	scene->list_dirty = true;
+
 	pthread_mutex_unlock(&scene->mutex);
 
 	calldata_setptr(&params, "scene", scene);
@@ -494,26 +721,34 @@ obs_source_t obs_sceneitem_getsource(obs_sceneitem_t item)
 
 void obs_sceneitem_setpos(obs_sceneitem_t item, const struct vec2 *pos)
 {
-	if (item)
+	if (item) {
 		vec2_copy(&item->pos, pos);
+		item->transform_dirty = true;
+	}
 }
 
 void obs_sceneitem_setrot(obs_sceneitem_t item, float rot)
 {
-	if (item)
+	if (item) {
 		item->rot = rot;
+		item->transform_dirty = true;
+	}
 }
 
 void obs_sceneitem_setorigin(obs_sceneitem_t item, const struct vec2 *origin)
 {
-	if (item)
+	if (item) {
 		vec2_copy(&item->origin, origin);
+		item->transform_dirty = true;
+	}
 }
 
 void obs_sceneitem_setscale(obs_sceneitem_t item, const struct vec2 *scale)
 {
-	if (item)
+	if (item) {
 		vec2_copy(&item->scale, scale);
+		item->transform_dirty = true;
+	}
 }
 
 void obs_sceneitem_setorder(obs_sceneitem_t item, enum order_movement movement)
@@ -552,6 +787,17 @@ void obs_sceneitem_setorder(obs_sceneitem_t item, enum order_movement movement)
 	obs_scene_release(scene);
 }
 
+void obs_sceneitem_setvisible(obs_sceneitem_t item, bool visible)
+{
+	if (item)
+		item->visible = visible;
+}
+
+bool obs_sceneitem_visible(obs_sceneitem_t item)
+{
+	return item ? item->visible : false;
+}
+
 void obs_sceneitem_getpos(obs_sceneitem_t item, struct vec2 *pos)
 {
 	if (item)
@@ -19,6 +19,8 @@
 
 #include "obs.h"
 #include "obs-internal.h"
+#include "graphics/matrix3.h"
+#include "graphics/bounds.h"
 
 /* how obs scene! */
 
@@ -35,6 +37,14 @@ struct obs_scene_item {
 	struct vec2           scale;
 	float                 rot;
 
+	/* cached local transform, rebuilt when the item is moved */
+	struct matrix3        draw_transform;
+	bool                  transform_dirty;
+
+	/* canvas space bounds, updated each frame before drawing */
+	struct bounds         draw_bounds;
+	bool                  culled;
+
 	/* would do **prev_next, but not really great for reordering */
 	struct obs_scene_item *prev;
 	struct obs_scene_item *next;
@@ -45,4 +55,8 @@ struct obs_scene {
 
 	pthread_mutex_t       mutex;
 	struct obs_scene_item *first_item;
+
+	/* flattened item order, rebuilt when items are added/removed/moved */
+	DARRAY(struct obs_scene_item*) draw_list;
+	bool                  list_dirty;
 };
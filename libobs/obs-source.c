@@ -24,6 +24,7 @@
 #include "callback/calldata.h"
 #include "graphics/matrix3.h"
 #include "graphics/vec3.h"
+#include "graphics/vec4.h"
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -110,6 +111,7 @@ bool obs_source_init(struct obs_source *source,
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->video_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
+	pthread_mutex_init_value(&source->async_mutex);
 
 	memcpy(&source->info, info, sizeof(struct obs_source_info));
 
@@ -119,6 +121,8 @@ bool obs_source_init(struct obs_source *source,
 		return false;
 	if (pthread_mutex_init(&source->video_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->async_mutex, NULL) != 0)
+		return false;
 
 	if (info->output_flags & OBS_SOURCE_AUDIO) {
 		source->audio_line = audio_output_createline(obs->audio.audio,
@@ -132,7 +136,8 @@ bool obs_source_init(struct obs_source *source,
 
 	obs_context_data_insert(&source->context,
 			&obs->data.sources_mutex,
-			&obs->data.first_source);
+			&obs->data.first_source,
+			&obs->data.sources_index);
 	return true;
 }
 
@@ -234,7 +239,11 @@ void obs_source_destroy(struct obs_source *source)
 
 	gs_entercontext(obs->video.graphics);
 	texrender_destroy(source->async_convert_texrender);
-	texture_destroy(source->async_texture);
+	texrender_destroy(source->cache_texrender);
+	texrender_destroy(source->filter_texrender);
+	gs_texture_pool_release(source->async_texture);
+	gs_texture_pool_release(source->async_plane_textures[0]);
+	gs_texture_pool_release(source->async_plane_textures[1]);
 	gs_leavecontext();
 
 	for (i = 0; i < MAX_AV_PLANES; i++)
@@ -243,12 +252,12 @@ void obs_source_destroy(struct obs_source *source)
 	audio_line_destroy(source->audio_line);
 	audio_resampler_destroy(source->resampler);
 
-	texrender_destroy(source->filter_texrender);
 	da_free(source->video_frames);
 	da_free(source->filters);
 	pthread_mutex_destroy(&source->filter_mutex);
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->video_mutex);
+	pthread_mutex_destroy(&source->async_mutex);
 	obs_context_data_free(&source->context);
 	bfree(source);
 }
@@ -289,6 +298,7 @@ void obs_source_remove(obs_source_t source)
 	exists = (id != DARRAY_INVALID);
 	if (exists) {
 		da_erase(data->user_sources, id);
+		source->user_source = false;
 		obs_source_release(source);
 	}
 
@@ -359,6 +369,7 @@ static void obs_source_deferred_update(obs_source_t source)
 				source->context.settings);
 
 	source->defer_update = false;
+	obs_source_invalidate(source);
 }
 
 void obs_source_update(obs_source_t source, obs_data_t settings)
@@ -366,6 +377,7 @@ void obs_source_update(obs_source_t source, obs_data_t settings)
 	if (!source) return;
 
 	obs_data_apply(source->context.settings, settings);
+	obs_source_invalidate(source);
 
 	if (source->context.data && source->info.update) {
 		if (source->info.output_flags & OBS_SOURCE_VIDEO)
@@ -477,10 +489,42 @@ void obs_source_deactivate(obs_source_t source, enum view_type type)
 	}
 }
 
+/* called from the video thread before any sources are prepared, returns
+ * whether the source has tick work that can be prepared ahead of time */
+bool obs_source_video_tick_begin(obs_source_t source)
+{
+	if (source->defer_update)
+		obs_source_deferred_update(source);
+
+	/* culled everywhere it was used last frame */
+	if (source->video_skipped && !source->video_rendered &&
+	    (source->info.output_flags & OBS_SOURCE_ASYNC) != 0)
+		obs_source_releaseframe(source, obs_source_getframe(source));
+
+	source->video_skipped  = false;
+	source->video_rendered = false;
+
+	source->tick_prepare_time = 0;
+
+	return source->context.data && source->info.video_tick_prepare;
+}
+
+void obs_source_video_tick_prepare(obs_source_t source, float seconds)
+{
+	uint64_t start_time = os_gettime_ns();
+
+	source->info.video_tick_prepare(source->context.data, seconds);
+	source->tick_prepare_time = os_gettime_ns() - start_time;
+}
+
 void obs_source_video_tick(obs_source_t source, float seconds)
 {
+	uint64_t start_time;
+
 	if (!source) return;
 
+	start_time = os_gettime_ns();
+
 	if (source->defer_update)
 		obs_source_deferred_update(source);
 
@@ -490,6 +534,19 @@ void obs_source_video_tick(obs_source_t source, float seconds)
 
 	if (source->context.data && source->info.video_tick)
 		source->info.video_tick(source->context.data, seconds);
+
+	source->tick_time = source->tick_prepare_time +
+		(os_gettime_ns() - start_time);
+}
+
+uint64_t obs_source_get_tick_time(obs_source_t source)
+{
+	return source ? source->tick_time : 0;
+}
+
+uint64_t obs_source_get_upload_time(obs_source_t source)
+{
+	return source ? source->upload_time : 0;
 }
 
 /* unless the value is 3+ hours worth of frames, this won't overflow */
@@ -598,6 +655,7 @@ static inline enum convert_type get_convert_type(enum video_format format)
 	case VIDEO_FORMAT_RGBA:
 	case VIDEO_FORMAT_BGRA:
 	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_YUVX:
 		return CONVERT_NONE;
 	}
 
@@ -612,6 +670,39 @@ static inline bool set_packed422_sizes(struct obs_source *source,
 	return true;
 }
 
+static inline bool create_plane_texture(struct obs_source *source, int idx,
+		uint32_t width, uint32_t height)
+{
+	source->async_plane_textures[idx] = gs_texture_pool_acquire(width,
+			height, GS_R8, GS_DYNAMIC);
+	return source->async_plane_textures[idx] != NULL;
+}
+
+/* the luma plane is uploaded to async_texture, chroma to the plane textures */
+static inline bool set_planar420_sizes(struct obs_source *source,
+		struct source_frame *frame, bool nv12)
+{
+	uint32_t chroma_width  = (frame->width  + 1) / 2;
+	uint32_t chroma_height = (frame->height + 1) / 2;
+
+	source->async_convert_width  = frame->width;
+	source->async_convert_height = frame->height;
+
+	/* NV12 chroma is interleaved, so it is sampled one byte at a time */
+	if (nv12)
+		return create_plane_texture(source, 0, chroma_width * 2,
+				chroma_height);
+
+	return create_plane_texture(source, 0, chroma_width, chroma_height) &&
+	       create_plane_texture(source, 1, chroma_width, chroma_height);
+}
+
+static inline enum gs_color_format convert_texture_format(
+		enum convert_type type)
+{
+	return (type == CONVERT_NV12 || type == CONVERT_420) ? GS_R8 : GS_RGBA;
+}
+
 static inline bool init_gpu_conversion(struct obs_source *source,
 		struct source_frame *frame)
 {
@@ -621,9 +712,10 @@ static inline bool init_gpu_conversion(struct obs_source *source,
 			return set_packed422_sizes(source, frame);
 
 		case CONVERT_NV12:
+			return set_planar420_sizes(source, frame, true);
+
 		case CONVERT_420:
-			/* TODO: implement conversion */
-			break;
+			return set_planar420_sizes(source, frame, false);
 
 		case CONVERT_NONE:
 			assert(false && "No conversion requested");
@@ -646,8 +738,15 @@ static inline bool set_async_texture_size(struct obs_source *source,
 			return true;
 	}
 
-	texture_destroy(source->async_texture);
+	/* resized textures go back to the pool, so sources that flip between
+	 * sizes don't reallocate every time */
+	gs_texture_pool_release(source->async_texture);
+	gs_texture_pool_release(source->async_plane_textures[0]);
+	gs_texture_pool_release(source->async_plane_textures[1]);
 	texrender_destroy(source->async_convert_texrender);
+	source->async_texture           = NULL;
+	source->async_plane_textures[0] = NULL;
+	source->async_plane_textures[1] = NULL;
 	source->async_convert_texrender = NULL;
 
 	if (cur != CONVERT_NONE && init_gpu_conversion(source, frame)) {
@@ -656,17 +755,34 @@ static inline bool set_async_texture_size(struct obs_source *source,
 		source->async_convert_texrender =
 			texrender_create(GS_RGBA, GS_ZS_NONE);
 
-		source->async_texture = gs_create_texture(
+		source->async_texture = gs_texture_pool_acquire(
 				source->async_convert_width,
 				source->async_convert_height,
-				GS_RGBA, 1, NULL, GS_DYNAMIC);
+				convert_texture_format(cur), GS_DYNAMIC);
+
+		/* the format or size may have changed from one that had to be
+		 * unpacked on the CPU */
+		pthread_mutex_lock(&source->async_mutex);
+		source->async_cpu_conversion = false;
+		pthread_mutex_unlock(&source->async_mutex);
 
 	} else {
 		source->async_gpu_conversion = false;
 
-		source->async_texture = gs_create_texture(
+		/* unpack further frames of this format and size on the thread
+		 * that outputs them */
+		if (cur != CONVERT_NONE) {
+			pthread_mutex_lock(&source->async_mutex);
+			source->async_cpu_format     = frame->format;
+			source->async_cpu_width      = frame->width;
+			source->async_cpu_height     = frame->height;
+			source->async_cpu_conversion = true;
+			pthread_mutex_unlock(&source->async_mutex);
+		}
+
+		source->async_texture = gs_texture_pool_acquire(
 				frame->width, frame->height,
-				GS_RGBA, 1, NULL, GS_DYNAMIC);
+				GS_RGBA, GS_DYNAMIC);
 	}
 
 	if (!source->async_texture)
@@ -677,18 +793,27 @@ static inline bool set_async_texture_size(struct obs_source *source,
 	return true;
 }
 
-static void upload_raw_frame(texture_t tex, const struct source_frame *frame)
+static void upload_raw_frame(struct obs_source *source,
+		const struct source_frame *frame)
 {
+	texture_t *planes = source->async_plane_textures;
+
 	switch (get_convert_type(frame->format)) {
 		case CONVERT_422_U:
 		case CONVERT_422_Y:
-			texture_setimage(tex, frame->data[0],
+			texture_setimage(source->async_texture, frame->data[0],
 					frame->linesize[0], false);
 			break;
 
-		case CONVERT_NV12:
 		case CONVERT_420:
-			assert(false && "Conversion not yet implemented");
+			texture_setimage(planes[1], frame->data[2],
+					frame->linesize[2], false);
+			/* fall through */
+		case CONVERT_NV12:
+			texture_setimage(source->async_texture, frame->data[0],
+					frame->linesize[0], false);
+			texture_setimage(planes[0], frame->data[1],
+					frame->linesize[1], false);
 			break;
 
 		case CONVERT_NONE:
@@ -710,13 +835,15 @@ static const char *select_conversion_technique(enum video_format format)
 			return "YVYU_Reverse";
 
 		case VIDEO_FORMAT_NV12:
+			return "NV12_Reverse";
+
 		case VIDEO_FORMAT_I420:
-			assert(false && "Conversion not yet implemented");
-			break;
+			return "I420_Reverse";
 
 		case VIDEO_FORMAT_BGRA:
 		case VIDEO_FORMAT_BGRX:
 		case VIDEO_FORMAT_RGBA:
+		case VIDEO_FORMAT_YUVX:
 		case VIDEO_FORMAT_NONE:
 			assert(false && "No conversion requested");
 			break;
@@ -738,7 +865,7 @@ static bool update_async_texrender(struct obs_source *source,
 
 	texrender_reset(texrender);
 
-	upload_raw_frame(tex, frame);
+	upload_raw_frame(source, frame);
 
 	uint32_t cx = source->async_width;
 	uint32_t cy = source->async_height;
@@ -755,6 +882,12 @@ static bool update_async_texrender(struct obs_source *source,
 
 	effect_settexture(conv, effect_getparambyname(conv, "image"),
 			tex);
+	if (source->async_plane_textures[0])
+		effect_settexture(conv, effect_getparambyname(conv, "image1"),
+				source->async_plane_textures[0]);
+	if (source->async_plane_textures[1])
+		effect_settexture(conv, effect_getparambyname(conv, "image2"),
+				source->async_plane_textures[1]);
 	set_eparam(conv, "width",  (float)cx);
 	set_eparam(conv, "height", (float)cy);
 	set_eparam(conv, "width_i",  1.0f / cx);
@@ -893,11 +1026,16 @@ static void obs_source_draw_async_texture(struct obs_source *source)
 static void obs_source_render_async_video(obs_source_t source)
 {
 	struct source_frame *frame = obs_source_getframe(source);
+	uint64_t start_time;
+
 	if (frame) {
 		if (!set_async_texture_size(source, frame))
 			return;
+
+		start_time = os_gettime_ns();
 		if (!update_async_texture(source, frame))
 			return;
+		source->upload_time = os_gettime_ns() - start_time;
 	}
 
 	if (source->async_texture)
@@ -906,13 +1044,117 @@ static void obs_source_render_async_video(obs_source_t source)
 	obs_source_releaseframe(source, frame);
 }
 
-static inline void obs_source_render_filters(obs_source_t source)
+void obs_source_invalidate(obs_source_t source)
+{
+	if (!source) return;
+
+	source->cache_valid = false;
+	if (source->filter_parent)
+		source->filter_parent->cache_valid = false;
+}
+
+static inline bool filter_chain_cacheable(obs_source_t source)
+{
+	size_t i;
+
+	if ((source->info.output_flags & OBS_SOURCE_CACHEABLE) == 0)
+		return false;
+
+	for (i = 0; i < source->filters.num; i++) {
+		obs_source_t filter = source->filters.array[i];
+		if ((filter->info.output_flags & OBS_SOURCE_CACHEABLE) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+static inline void render_filter_chain(obs_source_t source)
 {
 	source->rendering_filter = true;
 	obs_source_video_render(source->filters.array[0]);
 	source->rendering_filter = false;
 }
 
+static bool update_filter_cache(obs_source_t source, uint32_t cx, uint32_t cy)
+{
+	struct vec4 clear_color;
+
+	if (!source->cache_texrender)
+		source->cache_texrender = texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	/* pending async frames have to be consumed by rendering */
+	if (source->video_frames.num)
+		source->cache_valid = false;
+
+	if (source->cache_valid &&
+	    source->cache_cx == cx && source->cache_cy == cy)
+		return true;
+
+	/* set before rendering so changes made while rendering still
+	 * invalidate the cache */
+	source->cache_valid = true;
+	source->cache_cx    = cx;
+	source->cache_cy    = cy;
+
+	texrender_reset(source->cache_texrender);
+	if (!texrender_begin(source->cache_texrender, cx, cy)) {
+		source->cache_valid = false;
+		return false;
+	}
+
+	vec4_zero(&clear_color);
+	gs_clear(GS_CLEAR_COLOR, &clear_color, 1.0f, 0);
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	/* the cache keeps the chain's output alpha as is, it's applied once
+	 * when the cache is drawn.  blending with the cleared texture would
+	 * apply it twice */
+	gs_enable_blending(false);
+	render_filter_chain(source);
+	gs_enable_blending(true);
+
+	texrender_end(source->cache_texrender);
+	return true;
+}
+
+static void obs_source_render_cached(obs_source_t source)
+{
+	uint32_t    cx = obs_source_getwidth(source);
+	uint32_t    cy = obs_source_getheight(source);
+	effect_t    effect;
+	technique_t tech;
+	texture_t   tex;
+	size_t      passes, i;
+
+	if (!cx || !cy || !update_filter_cache(source, cx, cy)) {
+		render_filter_chain(source);
+		return;
+	}
+
+	effect = obs->video.default_effect;
+	tech   = effect_gettechnique(effect, "Draw");
+	tex    = texrender_gettexture(source->cache_texrender);
+
+	passes = technique_begin(tech);
+	for (i = 0; i < passes; i++) {
+		technique_beginpass(tech, i);
+		effect_settexture(effect,
+				effect_getparambyname(effect, "image"), tex);
+		gs_draw_sprite(tex, 0, 0, 0);
+		technique_endpass(tech);
+	}
+	technique_end(tech);
+}
+
+static inline void obs_source_render_filters(obs_source_t source)
+{
+	if (filter_chain_cacheable(source))
+		obs_source_render_cached(source);
+	else
+		render_filter_chain(source);
+}
+
 static inline void obs_source_default_render(obs_source_t source,
 		bool color_matrix)
 {
@@ -947,10 +1189,72 @@ static inline void obs_source_main_render(obs_source_t source)
 				custom_draw ? NULL : gs_geteffect());
 }
 
+const char *obs_source_batch_technique(obs_source_t source)
+{
+	uint32_t flags;
+
+	if (!source_valid(source) || !source->info.video_render)
+		return NULL;
+
+	flags = source->info.output_flags;
+	if (source->filter_parent || source->filters.num ||
+	    (flags & OBS_SOURCE_CUSTOM_DRAW) != 0)
+		return NULL;
+
+	return (flags & OBS_SOURCE_COLOR_MATRIX) ? "DrawMatrix" : "Draw";
+}
+
+/* renders within a technique pass already begun by the caller */
+void obs_source_batch_render(obs_source_t source, effect_t effect)
+{
+	source->info.video_render(source->context.data, effect);
+}
+
+bool obs_source_opaque(obs_source_t source)
+{
+	uint32_t flags;
+
+	if (!source_valid(source) || source->filters.num)
+		return false;
+
+	flags = source->info.output_flags;
+	if ((flags & OBS_SOURCE_OPAQUE) != 0)
+		return true;
+
+	/* async frames without an alpha channel */
+	return (flags & OBS_SOURCE_ASYNC) != 0 && !source->info.video_render &&
+		source->async_texture && format_is_yuv(source->async_format);
+}
+
+static void skip_tree(obs_source_t parent, obs_source_t child, void *param)
+{
+	child->video_skipped = true;
+
+	UNUSED_PARAMETER(parent);
+	UNUSED_PARAMETER(param);
+}
+
+/*
+ * called for sources that are culled from a scene.  the same source may still
+ * be drawn elsewhere (another scene, a display or a projector), so its async
+ * frames are only consumed on the next tick if nothing drew it, so they don't
+ * pile up for sources that are active but hidden
+ */
+void obs_source_skip_video(obs_source_t source)
+{
+	if (!source_valid(source))
+		return;
+
+	skip_tree(NULL, source, NULL);
+	obs_source_enum_tree(source, skip_tree, NULL);
+}
+
 void obs_source_video_render(obs_source_t source)
 {
 	if (!source_valid(source)) return;
 
+	source->video_rendered = true;
+
 	if (source->filters.num && !source->rendering_filter)
 		obs_source_render_filters(source);
 
@@ -1016,6 +1320,8 @@ void obs_source_filter_add(obs_source_t source, obs_source_t filter)
 
 	filter->filter_parent = source;
 	filter->filter_target = source;
+
+	obs_source_invalidate(source);
 }
 
 void obs_source_filter_remove(obs_source_t source, obs_source_t filter)
@@ -1042,6 +1348,8 @@ void obs_source_filter_remove(obs_source_t source, obs_source_t filter)
 
 	filter->filter_parent = NULL;
 	filter->filter_target = NULL;
+
+	obs_source_invalidate(source);
 }
 
 void obs_source_filter_setorder(obs_source_t source, obs_source_t filter,
@@ -1083,6 +1391,8 @@ void obs_source_filter_setorder(obs_source_t source, obs_source_t filter,
 			source : source->filters.array[idx+1];
 		source->filters.array[i]->filter_target = next_filter;
 	}
+
+	obs_source_invalidate(source);
 }
 
 obs_data_t obs_source_getsettings(obs_source_t source)
@@ -1133,7 +1443,7 @@ static inline void copy_frame_data_plane(struct source_frame *dst,
 				dst->linesize[plane] * lines);
 }
 
-static void copy_frame_data(struct source_frame *dst,
+static void copy_frame_info(struct source_frame *dst,
 		const struct source_frame *src)
 {
 	dst->flip         = src->flip;
@@ -1145,6 +1455,12 @@ static void copy_frame_data(struct source_frame *dst,
 		memcpy(dst->color_range_min, src->color_range_min, size);
 		memcpy(dst->color_range_max, src->color_range_max, size);
 	}
+}
+
+static void copy_frame_data(struct source_frame *dst,
+		const struct source_frame *src)
+{
+	copy_frame_info(dst, src);
 
 	switch (dst->format) {
 	case VIDEO_FORMAT_I420:
@@ -1165,6 +1481,7 @@ static void copy_frame_data(struct source_frame *dst,
 	case VIDEO_FORMAT_RGBA:
 	case VIDEO_FORMAT_BGRA:
 	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_YUVX:
 		copy_frame_data_plane(dst, src, 0, dst->height);
 	}
 }
@@ -1179,6 +1496,111 @@ static inline struct source_frame *cache_video(const struct source_frame *frame)
 	return new_frame;
 }
 
+static void unpack_rows(const struct source_frame *frame,
+		struct source_frame *new_frame, uint32_t start_y, uint32_t end_y)
+{
+	const uint8_t *const *input = (const uint8_t *const*)frame->data;
+	uint8_t              *output   = new_frame->data[0];
+	uint32_t             linesize  = new_frame->linesize[0];
+
+	switch (get_convert_type(frame->format)) {
+	case CONVERT_420:
+		decompress_420(input, frame->linesize, start_y, end_y,
+				output, linesize);
+		break;
+	case CONVERT_NV12:
+		decompress_nv12(input, frame->linesize, start_y, end_y,
+				output, linesize);
+		break;
+	case CONVERT_422_Y:
+		decompress_422(frame->data[0], frame->linesize[0],
+				start_y, end_y, output, linesize, true);
+		break;
+	case CONVERT_422_U:
+		decompress_422(frame->data[0], frame->linesize[0],
+				start_y, end_y, output, linesize, false);
+		break;
+	case CONVERT_NONE:
+		break;
+	}
+}
+
+/* maximum number of threads a frame is unpacked on besides the calling
+ * thread */
+#define MAX_UNPACK_THREADS 4
+
+/* frames smaller than this aren't worth waking up the pool for */
+#define MIN_UNPACK_POOL_HEIGHT 480
+
+struct unpack_job {
+	const struct source_frame *input;
+	struct source_frame       *output;
+	uint32_t                  num_slices;
+};
+
+static void unpack_slice(void *param, size_t idx)
+{
+	struct unpack_job *job = param;
+	uint32_t start_y, end_y;
+
+	get_decompress_slice(job->input->height, job->num_slices,
+			(uint32_t)idx, &start_y, &end_y);
+	if (start_y < end_y)
+		unpack_rows(job->input, job->output, start_y, end_y);
+}
+
+/* splits the frame in to even row ranges, and unpacks them on the job pool
+ * and the calling thread.  one frame is unpacked at a time, other sources
+ * unpack on their own thread while the pool is busy */
+static bool unpack_threaded(const struct source_frame *frame,
+		struct source_frame *new_frame)
+{
+	size_t num_threads = job_pool_max_threads(obs->job_pool);
+	struct unpack_job job;
+
+	if (!num_threads || frame->height < MIN_UNPACK_POOL_HEIGHT)
+		return false;
+	if (num_threads > MAX_UNPACK_THREADS)
+		num_threads = MAX_UNPACK_THREADS;
+
+	job.input      = frame;
+	job.output     = new_frame;
+	job.num_slices = (uint32_t)num_threads + 1;
+
+	return job_pool_try_run(obs->job_pool, job.num_slices, unpack_slice,
+			&job);
+}
+
+/* unpacks YUV frames to packed 444 when the source can't convert them on
+ * the GPU, so the render thread only has to upload them */
+static struct source_frame *unpack_video(const struct source_frame *frame)
+{
+	struct source_frame *new_frame = source_frame_create(VIDEO_FORMAT_YUVX,
+			frame->width, frame->height);
+
+	copy_frame_info(new_frame, frame);
+
+	if (!unpack_threaded(frame, new_frame))
+		unpack_rows(frame, new_frame, 0, frame->height);
+
+	return new_frame;
+}
+
+static inline bool unpack_on_output(obs_source_t source,
+		const struct source_frame *frame)
+{
+	bool unpack;
+
+	pthread_mutex_lock(&source->async_mutex);
+	unpack = source->async_cpu_conversion &&
+		frame->format == source->async_cpu_format &&
+		frame->width  == source->async_cpu_width &&
+		frame->height == source->async_cpu_height;
+	pthread_mutex_unlock(&source->async_mutex);
+
+	return unpack;
+}
+
 static bool ready_async_frame(obs_source_t source, uint64_t sys_time);
 
 static inline void cycle_frames(struct obs_source *source)
@@ -1193,7 +1615,8 @@ void obs_source_output_video(obs_source_t source,
 	if (!source || !frame)
 		return;
 
-	struct source_frame *output = cache_video(frame);
+	struct source_frame *output = unpack_on_output(source, frame) ?
+		unpack_video(frame) : cache_video(frame);
 
 	pthread_mutex_lock(&source->filter_mutex);
 	output = filter_async_video(source, output);
@@ -1204,6 +1627,8 @@ void obs_source_output_video(obs_source_t source,
 		cycle_frames(source);
 		da_push_back(source->video_frames, &output);
 		pthread_mutex_unlock(&source->video_mutex);
+
+		obs_source_invalidate(source);
 	}
 }
 
@@ -1568,6 +1993,10 @@ void obs_source_process_filter(obs_source_t filter, effect_t effect,
 
 	render_filter_tex(texrender_gettexture(filter->filter_texrender),
 			effect, width, height, use_matrix);
+
+	/* the intermediate target is only needed for this draw, so hand it
+	 * back to the pool for the next filter in the chain to reuse */
+	texrender_release(filter->filter_texrender);
 }
 
 signal_handler_t obs_source_signalhandler(obs_source_t source)
@@ -88,6 +88,27 @@ enum obs_source_type {
  */
 #define OBS_SOURCE_COLOR_MATRIX (1<<4)
 
+/**
+ * Source covers its entire width/height with opaque pixels.
+ *
+ * Scenes use this to skip drawing items that are completely hidden behind
+ * the source.  Do not specify this if the source may draw with any
+ * transparency.
+ */
+#define OBS_SOURCE_OPAQUE       (1<<5)
+
+/**
+ * Source output only changes when its settings are updated, when it outputs
+ * a new async frame, or when it calls obs_source_invalidate.
+ *
+ * This allows the output of the source's filter chain to be cached and
+ * reused while nothing changes.  Filters can specify it as well; a chain is
+ * only cached when the source and all of its filters specify it.  The chain
+ * renders in to the cache with blending disabled, so each source and filter
+ * in it should draw its output with a single draw.
+ */
+#define OBS_SOURCE_CACHEABLE    (1<<6)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t parent, obs_source_t child,
@@ -197,6 +218,18 @@ struct obs_source_info {
 	 */
 	void (*video_tick)(void *data, float seconds);
 
+	/**
+	 * Called each video frame before video_tick to do any CPU-side work
+	 * (such as capturing) ahead of time.  This may be called from a
+	 * worker thread in parallel with other sources, so graphics
+	 * functions must not be used here; upload the results in video_tick
+	 * instead.
+	 *
+	 * @param  data     Source data
+	 * @param  seconds  Seconds elapsed since the last frame
+	 */
+	void (*video_tick_prepare)(void *data, float seconds);
+
 	/**
 	 * Called when rendering the source with the graphics subsystem.
 	 *
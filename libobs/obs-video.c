@@ -15,17 +15,29 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <errno.h>
 #include "obs.h"
 #include "obs-internal.h"
+#include "util/platform.h"
+#include "util/profiler.h"
 #include "graphics/vec4.h"
 #include "media-io/format-conversion.h"
 
+static void prepare_source(void *param, size_t idx)
+{
+	struct obs_core_video *video = param;
+
+	obs_source_video_tick_prepare(video->tick_sources.array[idx],
+			video->tick_seconds);
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
-	struct obs_core_data *data = &obs->data;
-	struct obs_source    *source;
-	uint64_t             delta_time;
-	float                seconds;
+	struct obs_core_data  *data  = &obs->data;
+	struct obs_core_video *video = &obs->video;
+	struct obs_source     *source;
+	uint64_t              delta_time;
+	float                 seconds;
 
 	if (!last_time)
 		last_time = cur_time - video_getframetime(obs->video.video);
@@ -34,6 +46,24 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 
 	pthread_mutex_lock(&data->sources_mutex);
 
+	da_resize(video->tick_sources, 0);
+
+	source = data->first_source;
+	while (source) {
+		if (source->refs && obs_source_video_tick_begin(source))
+			da_push_back(video->tick_sources, &source);
+		source = (struct obs_source*)source->context.next;
+	}
+
+	/* the CPU-side tick work of each source runs in parallel, with the
+	 * video thread itself taking part */
+	video->tick_seconds = seconds;
+	job_pool_run(obs->job_pool, video->tick_sources.num, prepare_source,
+			video);
+
+	/* uploads and other graphics work are done in a single context */
+	gs_entercontext(obs_graphics());
+
 	source = data->first_source;
 	while (source) {
 		if (source->refs)
@@ -41,13 +71,16 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 		source = (struct obs_source*)source->context.next;
 	}
 
+	gs_leavecontext();
+
 	pthread_mutex_unlock(&data->sources_mutex);
 
 	return cur_time;
 }
 
 /* in obs-display.c */
-extern void render_display(struct obs_display *display);
+extern void render_display(struct obs_display *display, bool present);
+extern void render_display_threaded(struct obs_display *display);
 
 static inline void render_displays(void)
 {
@@ -63,18 +96,40 @@ static inline void render_displays(void)
 
 	display = obs->data.first_display;
 	while (display) {
-		render_display(display);
+		render_display(display, true);
 		display = display->next;
 	}
 
 	pthread_mutex_unlock(&obs->data.displays_mutex);
 
 	/* render main display */
-	render_display(&obs->video.main_display);
+	render_display(&obs->video.main_display, true);
 
 	gs_leavecontext();
 }
 
+/* the display thread enters the graphics context separately for each
+ * display, rather than holding it for all of them */
+static inline void render_displays_threaded(void)
+{
+	struct obs_display *display;
+
+	if (!obs->data.valid)
+		return;
+
+	pthread_mutex_lock(&obs->data.displays_mutex);
+
+	display = obs->data.first_display;
+	while (display) {
+		render_display_threaded(display);
+		display = display->next;
+	}
+
+	pthread_mutex_unlock(&obs->data.displays_mutex);
+
+	render_display_threaded(&obs->video.main_display);
+}
+
 static inline void set_render_size(uint32_t width, uint32_t height)
 {
 	gs_enable_depthtest(false);
@@ -96,49 +151,39 @@ static inline void unmap_last_surface(struct obs_core_video *video)
 static inline void render_main_texture(struct obs_core_video *video,
 		int cur_texture)
 {
-	struct vec4 clear_color;
+	struct gs_draw_stats draw_start, draw_end;
+	struct vec4          clear_color;
 	vec4_set(&clear_color, 0.0f, 0.0f, 0.0f, 1.0f);
 
 	gs_setrendertarget(video->render_textures[cur_texture], NULL);
 	gs_clear(GS_CLEAR_COLOR, &clear_color, 1.0f, 0);
 
 	set_render_size(video->base_width, video->base_height);
+
+	gs_get_draw_stats(&draw_start);
+
+	video->frame_culled_items = 0;
+	video->counting_culled    = true;
 	obs_view_render(&obs->data.main_view);
+	video->counting_culled    = false;
+	video->culled_items       = video->frame_culled_items;
+
+	gs_get_draw_stats(&draw_end);
+	video->draw_calls = (uint32_t)(draw_end.draw_calls -
+			draw_start.draw_calls);
+	video->sprites    = (uint32_t)(draw_end.sprites - draw_start.sprites);
 
 	video->textures_rendered[cur_texture] = true;
+	video->main_texture = cur_texture;
 }
 
-static inline void render_output_texture(struct obs_core_video *video,
-		int cur_texture, int prev_texture)
+static inline void draw_texture(effect_t effect, const char *tech_name,
+		texture_t texture, uint32_t width, uint32_t height)
 {
-	texture_t   texture = video->render_textures[prev_texture];
-	texture_t   target  = video->output_textures[cur_texture];
-	uint32_t    width   = texture_getwidth(target);
-	uint32_t    height  = texture_getheight(target);
-
-	/* TODO: replace with actual downscalers or unpackers */
-	effect_t    effect  = video->default_effect;
-	technique_t tech    = effect_gettechnique(effect, "DrawMatrix");
-	eparam_t    image   = effect_getparambyname(effect, "image");
-	eparam_t    matrix  = effect_getparambyname(effect, "color_matrix");
+	technique_t tech  = effect_gettechnique(effect, tech_name);
+	eparam_t    image = effect_getparambyname(effect, "image");
 	size_t      passes, i;
 
-	if (!video->textures_rendered[prev_texture])
-		return;
-
-	gs_setrendertarget(target, NULL);
-	set_render_size(width, height);
-
-	/* TODO: replace with programmable code */
-	const float mat_val[16] =
-	{
-		-0.100644f, -0.338572f,  0.439216f,  0.501961f,
-		 0.182586f,  0.614231f,  0.062007f,  0.062745f,
-		 0.439216f, -0.398942f, -0.040274f,  0.501961f,
-		 0.000000f,  0.000000f,  0.000000f,  1.000000f
-	};
-
-	effect_setval(effect, matrix, mat_val, sizeof(mat_val));
 	effect_settexture(effect, image, texture);
 
 	passes = technique_begin(tech);
@@ -148,6 +193,107 @@ static inline void render_output_texture(struct obs_core_video *video,
 		technique_endpass(tech);
 	}
 	technique_end(tech);
+}
+
+static inline void set_output_matrix(struct obs_core_video *video,
+		effect_t effect)
+{
+	eparam_t matrix = effect_getparambyname(effect, "color_matrix");
+	effect_setval(effect, matrix, video->output_matrix,
+			sizeof(video->output_matrix));
+}
+
+/* one direction of the separable scale filter */
+static void scale_pass(struct obs_core_video *video, texture_t texture,
+		texture_t target, bool vertical, bool matrix)
+{
+	effect_t effect      = video->scale_effect;
+	uint32_t src_size[2] = {texture_getwidth(texture),
+	                        texture_getheight(texture)};
+	uint32_t width       = texture_getwidth(target);
+	uint32_t height      = texture_getheight(target);
+	uint32_t dst_size    = vertical ? height : width;
+	float    ratio       = (float)src_size[vertical] / (float)dst_size;
+	struct vec2 dim, dim_i, dir;
+
+	vec2_set(&dim, (float)src_size[0], (float)src_size[1]);
+	vec2_set(&dim_i, 1.0f / dim.x, 1.0f / dim.y);
+	vec2_set(&dir, vertical ? 0.0f : 1.0f, vertical ? 1.0f : 0.0f);
+
+	gs_setrendertarget(target, NULL);
+	set_render_size(width, height);
+
+	effect_setvec2(effect,
+			effect_getparambyname(effect, "base_dimension"), &dim);
+	effect_setvec2(effect,
+			effect_getparambyname(effect, "base_dimension_i"), &dim_i);
+	effect_setvec2(effect,
+			effect_getparambyname(effect, "scale_dir"), &dir);
+	effect_setfloat(effect,
+			effect_getparambyname(effect, "kernel_scale"),
+			ratio > 1.0f ? ratio : 1.0f);
+
+	if (matrix)
+		set_output_matrix(video, effect);
+
+	draw_texture(effect, matrix ? "DrawMatrix" : "Draw", texture,
+			width, height);
+}
+
+/* "scale_output_texture" only times submitting the two passes on the CPU,
+ * "scale_output_texture_gpu" is the time the GPU spends on them */
+static void scale_output_texture(struct obs_core_video *video,
+		texture_t texture, texture_t target)
+{
+	gputimer_t timer  = video->scale_timers[video->cur_scale_timer];
+	bool       timing = timer && profiler_active();
+	uint64_t   gpu_ns;
+
+	/* result of the passes NUM_GPU_TIMERS frames ago */
+	if (gputimer_get_data(timer, &gpu_ns))
+		profile_record("scale_output_texture_gpu", gpu_ns);
+
+	profile_start("scale_output_texture");
+
+	if (timing)
+		gputimer_begin(timer);
+
+	scale_pass(video, texture, video->scale_texture, false, false);
+	scale_pass(video, video->scale_texture, target, true,
+			video->output_yuv);
+
+	if (timing)
+		gputimer_end(timer);
+
+	profile_end("scale_output_texture");
+
+	if (++video->cur_scale_timer == NUM_GPU_TIMERS)
+		video->cur_scale_timer = 0;
+}
+
+static inline void render_output_texture(struct obs_core_video *video,
+		int cur_texture, int prev_texture)
+{
+	texture_t texture = video->render_textures[prev_texture];
+	texture_t target  = video->output_textures[cur_texture];
+	effect_t  effect  = video->default_effect;
+
+	if (!video->textures_rendered[prev_texture])
+		return;
+
+	if (video->scale_effect) {
+		scale_output_texture(video, texture, target);
+	} else {
+		gs_setrendertarget(target, NULL);
+		set_render_size(video->output_width, video->output_height);
+
+		if (video->output_yuv)
+			set_output_matrix(video, effect);
+
+		draw_texture(effect, video->output_yuv ? "DrawMatrix" : "Draw",
+				texture, video->output_width,
+				video->output_height);
+	}
 
 	video->textures_output[cur_texture] = true;
 }
@@ -205,18 +351,21 @@ static void render_convert_texture(struct obs_core_video *video,
 }
 
 static inline void stage_output_texture(struct obs_core_video *video,
-		int cur_texture, int prev_texture)
+		int prev_texture)
 {
 	texture_t   texture;
 	bool        texture_ready;
-	stagesurf_t copy = video->copy_surfaces[cur_texture];
+	stagesurf_t copy = video->copy_surfaces[video->cur_surface];
 
 	if (video->gpu_conversion) {
 		texture = video->convert_textures[prev_texture];
 		texture_ready = video->textures_converted[prev_texture];
+	} else if (video->direct_output) {
+		texture = video->render_textures[prev_texture];
+		texture_ready = video->textures_rendered[prev_texture];
 	} else {
 		texture = video->output_textures[prev_texture];
-		texture_ready = video->output_textures[prev_texture];
+		texture_ready = video->textures_output[prev_texture];
 	}
 
 	unmap_last_surface(video);
@@ -226,7 +375,7 @@ static inline void stage_output_texture(struct obs_core_video *video,
 
 	gs_stage_texture(copy, texture);
 
-	video->textures_copied[cur_texture] = true;
+	video->surfaces_copied[video->cur_surface] = true;
 }
 
 static inline void render_video(struct obs_core_video *video, int cur_texture,
@@ -237,12 +386,16 @@ static inline void render_video(struct obs_core_video *video, int cur_texture,
 	gs_enable_depthtest(false);
 	gs_setcullmode(GS_NEITHER);
 
+	profile_start("render_main_texture");
 	render_main_texture(video, cur_texture);
-	render_output_texture(video, cur_texture, prev_texture);
+	profile_end("render_main_texture");
+
+	if (!video->direct_output)
+		render_output_texture(video, cur_texture, prev_texture);
 	if (video->gpu_conversion)
 		render_convert_texture(video, cur_texture, prev_texture);
 
-	stage_output_texture(video, cur_texture, prev_texture);
+	stage_output_texture(video, prev_texture);
 
 	gs_setrendertarget(NULL, NULL);
 	gs_enable_blending(true);
@@ -250,15 +403,33 @@ static inline void render_video(struct obs_core_video *video, int cur_texture,
 	gs_endscene();
 }
 
+/* maps the oldest readback in the ring.  it was queued
+ * NUM_STAGE_SURFACES-1 frames ago, so normally it has long since finished;
+ * when it hasn't, the wait is counted as a stall */
 static inline bool download_frame(struct obs_core_video *video,
-		int prev_texture, struct video_data *frame)
+		struct video_data *frame)
 {
-	stagesurf_t surface = video->copy_surfaces[prev_texture];
+	int         oldest  = (video->cur_surface + 1) % NUM_STAGE_SURFACES;
+	stagesurf_t surface = video->copy_surfaces[oldest];
+	uint64_t    start;
+	bool        success;
 
-	if (!video->textures_copied[prev_texture])
+	if (!video->surfaces_copied[oldest])
 		return false;
 
-	if (!stagesurface_map(surface, &frame->data[0], &frame->linesize[0]))
+	if (stagesurface_isready(surface)) {
+		success = stagesurface_map(surface, &frame->data[0],
+				&frame->linesize[0]);
+	} else {
+		start   = os_gettime_ns();
+		success = stagesurface_map(surface, &frame->data[0],
+				&frame->linesize[0]);
+
+		video->readback_stall_time += os_gettime_ns() - start;
+		video->readback_stalls++;
+	}
+
+	if (!success)
 		return false;
 
 	video->mapped_surface = surface;
@@ -391,7 +562,13 @@ static inline void output_video_data(struct obs_core_video *video,
 			return;
 
 	} else if (format_is_yuv(info->format)) {
-		if (!convert_frame(video, frame, info, cur_texture))
+		bool success;
+
+		profile_start("convert_frame");
+		success = convert_frame(video, frame, info, cur_texture);
+		profile_end("convert_frame");
+
+		if (!success)
 			return;
 	}
 
@@ -411,16 +588,58 @@ static inline void output_frame(uint64_t timestamp)
 
 	gs_entercontext(obs_graphics());
 
+	profile_start("render_video");
 	render_video(video, cur_texture, prev_texture);
-	frame_ready = download_frame(video, prev_texture, &frame);
+	profile_end("render_video");
+
+	profile_start("download_frame");
+	frame_ready = download_frame(video, &frame);
+	profile_end("download_frame");
 
 	gs_leavecontext();
 
-	if (frame_ready)
+	if (frame_ready) {
+		profile_start("output_video_data");
 		output_video_data(video, &frame, cur_texture);
+		profile_end("output_video_data");
+
+		video->rendered_frames++;
+	}
 
 	if (++video->cur_texture == NUM_TEXTURES)
 		video->cur_texture = 0;
+	if (++video->cur_surface == NUM_STAGE_SURFACES)
+		video->cur_surface = 0;
+}
+
+#define STATS_INTERVAL 1000000000ULL
+
+static void send_video_stats(uint64_t cur_time)
+{
+	struct obs_core_video *video = &obs->video;
+	struct calldata       params = {0};
+
+	if (cur_time - video->last_stats_time < STATS_INTERVAL)
+		return;
+
+	video->last_stats_time = cur_time;
+
+	calldata_setint(&params, "total_frames",
+			video_output_total_frames(video->video));
+	calldata_setint(&params, "rendered_frames", video->rendered_frames);
+	calldata_setint(&params, "lagged_frames",
+			video_output_lagged_frames(video->video));
+	calldata_setint(&params, "duplicated_frames",
+			video_output_duplicated_frames(video->video));
+	calldata_setint(&params, "culled_items", video->culled_items);
+	calldata_setint(&params, "draw_calls", video->draw_calls);
+	calldata_setint(&params, "sprites", video->sprites);
+	calldata_setint(&params, "readback_stalls", video->readback_stalls);
+	calldata_setint(&params, "readback_stall_time",
+			(long long)video->readback_stall_time);
+
+	signal_handler_signal(obs->signals, "video_stats", &params);
+	calldata_free(&params);
 }
 
 void *obs_video_thread(void *param)
@@ -429,14 +648,64 @@ void *obs_video_thread(void *param)
 
 	while (video_output_wait(obs->video.video)) {
 		uint64_t cur_time = video_gettime(obs->video.video);
+		uint64_t start_time = os_gettime_ns();
 
+		profile_start("obs_video_thread");
+
+		profile_start("tick_sources");
 		last_time = tick_sources(cur_time, last_time);
+		profile_end("tick_sources");
 
-		render_displays();
+		if (!obs->video.threaded_displays) {
+			profile_start("render_displays");
+			render_displays();
+			profile_end("render_displays");
+		}
 
+		profile_start("output_frame");
 		output_frame(cur_time);
+		profile_end("output_frame");
+
+		profile_end("obs_video_thread");
+
+		obs_add_time_sample(obs->video.render_times,
+				os_gettime_ns() - start_time);
+		send_video_stats(cur_time);
 	}
 
 	UNUSED_PARAMETER(param);
 	return NULL;
 }
+
+static inline unsigned long display_wait_ms(uint64_t next_time)
+{
+	uint64_t t = os_gettime_ns();
+	return (next_time > t) ? (unsigned long)((next_time - t) / 1000000) : 0;
+}
+
+/* displays are drawn from the last composited texture at their own rate so
+ * that presenting them never holds up the video thread's frame output */
+void *obs_display_thread(void *param)
+{
+	struct obs_core_video *video = &obs->video;
+	uint64_t next_time = os_gettime_ns();
+
+	os_set_thread_sched(OS_THREAD_SCHED_LOW);
+
+	do {
+		profile_start("render_displays");
+		render_displays_threaded();
+		profile_end("render_displays");
+
+		next_time += video->display_interval_ns;
+
+		/* don't try to catch up if presenting took too long */
+		if (next_time < os_gettime_ns())
+			next_time = os_gettime_ns();
+
+	} while (os_event_timedwait(video->display_stop_event,
+				display_wait_ms(next_time)) == ETIMEDOUT);
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
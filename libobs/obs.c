@@ -16,6 +16,8 @@
 ******************************************************************************/
 
 #include "callback/calldata.h"
+#include "util/platform.h"
+#include "util/profiler.h"
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -36,6 +38,22 @@ static inline void make_gs_init_data(struct gs_init_data *gid,
 	gid->adapter         = ovi->adapter;
 }
 
+static inline enum video_colorspace get_output_colorspace(
+		const struct obs_video_info *ovi)
+{
+	if (ovi->colorspace != VIDEO_CS_DEFAULT)
+		return ovi->colorspace;
+
+	return ovi->output_height >= 720 ? VIDEO_CS_709 : VIDEO_CS_601;
+}
+
+static inline enum video_range_type get_output_range(
+		const struct obs_video_info *ovi)
+{
+	return ovi->range == VIDEO_RANGE_FULL ?
+		VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL;
+}
+
 static inline void make_video_info(struct video_output_info *vi,
 		struct obs_video_info *ovi)
 {
@@ -45,6 +63,10 @@ static inline void make_video_info(struct video_output_info *vi,
 	vi->fps_den = ovi->fps_den;
 	vi->width   = ovi->output_width;
 	vi->height  = ovi->output_height;
+	vi->thread_sched  = ovi->timing_thread_sched;
+	vi->sleep_spin_us = ovi->timing_spin_us;
+	vi->colorspace    = get_output_colorspace(ovi);
+	vi->range         = get_output_range(ovi);
 }
 
 #define PIXEL_SIZE 4
@@ -162,13 +184,15 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 		video->conversion_height : ovi->output_height;
 	size_t i;
 
-	for (i = 0; i < NUM_TEXTURES; i++) {
+	for (i = 0; i < NUM_STAGE_SURFACES; i++) {
 		video->copy_surfaces[i] = gs_create_stagesurface(
 				ovi->output_width, output_height, GS_RGBA);
 
 		if (!video->copy_surfaces[i])
 			return false;
+	}
 
+	for (i = 0; i < NUM_TEXTURES; i++) {
 		video->render_textures[i] = gs_create_texture(
 				ovi->base_width, ovi->base_height,
 				GS_RGBA, 1, NULL, GS_RENDERTARGET);
@@ -189,6 +213,20 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 					ovi->output_width, ovi->output_height);
 	}
 
+	if (video->scale_effect) {
+		video->scale_texture = gs_create_texture(
+				ovi->output_width, ovi->base_height,
+				GS_RGBA, 1, NULL, GS_RENDERTARGET);
+
+		if (!video->scale_texture)
+			return false;
+
+		/* not every device can time GPU work, in which case the
+		 * timers are NULL and nothing is measured */
+		for (size_t i = 0; i < NUM_GPU_TIMERS; i++)
+			video->scale_timers[i] = gs_create_gputimer();
+	}
+
 	return true;
 }
 
@@ -223,16 +261,73 @@ static bool obs_init_graphics(struct obs_video_info *ovi)
 				NULL);
 		bfree(filename);
 
+		filename = find_libobs_data_file("bicubic_scale.effect");
+		video->bicubic_effect = gs_create_effect_from_file(filename,
+				NULL);
+		bfree(filename);
+
+		filename = find_libobs_data_file("bilinear_lowres_scale.effect");
+		video->bilinear_effect = gs_create_effect_from_file(filename,
+				NULL);
+		bfree(filename);
+
+		filename = find_libobs_data_file("lanczos_scale.effect");
+		video->lanczos_effect = gs_create_effect_from_file(filename,
+				NULL);
+		bfree(filename);
+
 		if (!video->default_effect)
 			success = false;
 		if (!video->conversion_effect)
 			success = false;
+		if (!video->bicubic_effect || !video->bilinear_effect ||
+		    !video->lanczos_effect)
+			success = false;
 	}
 
 	gs_leavecontext();
 	return success;
 }
 
+static bool obs_init_display_thread(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	uint32_t fps_num = ovi->display_fps ? ovi->display_fps : ovi->fps_num;
+	uint32_t fps_den = ovi->display_fps ? 1 : ovi->fps_den;
+
+	video->display_fps = ovi->display_fps;
+	video->display_interval_ns = (uint64_t)(1000000000.0 *
+			(double)fps_den / (double)fps_num);
+
+	if (os_event_init(&video->display_stop_event, OS_EVENT_TYPE_MANUAL)
+			!= 0)
+		return false;
+
+	video->threaded_displays = true;
+
+	if (pthread_create(&video->display_thread, NULL,
+				obs_display_thread, obs) != 0) {
+		video->threaded_displays = false;
+		return false;
+	}
+
+	video->display_thread_initialized = true;
+	return true;
+}
+
+static inline effect_t get_scale_effect(enum obs_scale_type type)
+{
+	struct obs_core_video *video = &obs->video;
+
+	switch (type) {
+	case OBS_SCALE_BILINEAR: return video->bilinear_effect;
+	case OBS_SCALE_LANCZOS:  return video->lanczos_effect;
+	case OBS_SCALE_BICUBIC:  break;
+	}
+
+	return video->bicubic_effect;
+}
+
 static bool obs_init_video(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -245,6 +340,32 @@ static bool obs_init_video(struct obs_video_info *ovi)
 	video->output_width   = ovi->output_width;
 	video->output_height  = ovi->output_height;
 	video->gpu_conversion = ovi->gpu_conversion;
+	video->main_texture   = -1;
+
+	video->output_yuv     = format_is_yuv(ovi->output_format);
+	video->direct_output  = !video->output_yuv &&
+		ovi->output_width  == ovi->base_width &&
+		ovi->output_height == ovi->base_height;
+
+	if (video->output_yuv)
+		video_format_get_output_matrix(vi.colorspace, vi.range,
+				video->output_matrix);
+
+	video->scale_type   = ovi->scale_type;
+	video->scale_effect = NULL;
+	if (ovi->output_width  != ovi->base_width ||
+	    ovi->output_height != ovi->base_height)
+		video->scale_effect = get_scale_effect(ovi->scale_type);
+
+	video->rendered_frames = 0;
+	video->last_stats_time = 0;
+	video->culled_items    = 0;
+	video->draw_calls      = 0;
+	video->sprites         = 0;
+	video->readback_stalls = 0;
+	video->readback_stall_time = 0;
+	memset((void*)video->render_times, 0, sizeof(video->render_times));
+	memset((void*)video->encode_times, 0, sizeof(video->encode_times));
 
 	errorcode = video_output_open(&video->video, &vi);
 
@@ -278,6 +399,10 @@ static bool obs_init_video(struct obs_video_info *ovi)
 		return false;
 
 	video->thread_initialized = true;
+
+	if (ovi->threaded_displays && !obs_init_display_thread(ovi))
+		return false;
+
 	return true;
 }
 
@@ -286,6 +411,12 @@ static void stop_video(void)
 	struct obs_core_video *video = &obs->video;
 	void *thread_retval;
 
+	if (video->display_thread_initialized) {
+		os_event_signal(video->display_stop_event);
+		pthread_join(video->display_thread, &thread_retval);
+		video->display_thread_initialized = false;
+	}
+
 	if (video->video) {
 		video_output_stop(video->video);
 		if (video->thread_initialized) {
@@ -294,12 +425,20 @@ static void stop_video(void)
 		}
 	}
 
+	da_free(video->tick_sources);
 }
 
 static void obs_free_video(void)
 {
 	struct obs_core_video *video = &obs->video;
 
+	if (video->display_stop_event) {
+		os_event_destroy(video->display_stop_event);
+		video->display_stop_event = NULL;
+		video->threaded_displays  = false;
+		video->display_fps        = 0;
+	}
+
 	if (video->video) {
 		obs_display_free(&video->main_display);
 		video_output_close(video->video);
@@ -315,22 +454,35 @@ static void obs_free_video(void)
 			video->mapped_surface = NULL;
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < NUM_STAGE_SURFACES; i++) {
 			stagesurface_destroy(video->copy_surfaces[i]);
+			video->copy_surfaces[i]   = NULL;
+			video->surfaces_copied[i] = false;
+		}
+
+		for (size_t i = 0; i < NUM_TEXTURES; i++) {
 			texture_destroy(video->render_textures[i]);
 			texture_destroy(video->convert_textures[i]);
 			texture_destroy(video->output_textures[i]);
 			source_frame_free(&video->convert_frames[i]);
 
-			video->copy_surfaces[i]    = NULL;
 			video->render_textures[i]  = NULL;
 			video->convert_textures[i] = NULL;
 			video->output_textures[i]  = NULL;
 		}
 
+		texture_destroy(video->scale_texture);
+		video->scale_texture = NULL;
+
+		for (size_t i = 0; i < NUM_GPU_TIMERS; i++) {
+			gputimer_destroy(video->scale_timers[i]);
+			video->scale_timers[i] = NULL;
+		}
+
 		gs_leavecontext();
 
 		video->cur_texture = 0;
+		video->cur_surface = 0;
 	}
 }
 
@@ -343,7 +495,14 @@ static void obs_free_graphics(void)
 
 		effect_destroy(video->default_effect);
 		effect_destroy(video->conversion_effect);
-		video->default_effect = NULL;
+		effect_destroy(video->bicubic_effect);
+		effect_destroy(video->bilinear_effect);
+		effect_destroy(video->lanczos_effect);
+		video->default_effect    = NULL;
+		video->conversion_effect = NULL;
+		video->bicubic_effect    = NULL;
+		video->bilinear_effect   = NULL;
+		video->lanczos_effect    = NULL;
 
 		gs_leavecontext();
 
@@ -448,11 +607,17 @@ static void obs_free_data(void)
 	da_free(data->user_sources);
 
 	FREE_OBS_LINKED_LIST(source);
+
 	FREE_OBS_LINKED_LIST(output);
 	FREE_OBS_LINKED_LIST(encoder);
 	FREE_OBS_LINKED_LIST(display);
 	FREE_OBS_LINKED_LIST(service);
 
+	obs_context_index_free(&data->sources_index);
+	obs_context_index_free(&data->outputs_index);
+	obs_context_index_free(&data->encoders_index);
+	obs_context_index_free(&data->services_index);
+
 	pthread_mutex_destroy(&data->user_sources_mutex);
 	pthread_mutex_destroy(&data->sources_mutex);
 	pthread_mutex_destroy(&data->displays_mutex);
@@ -475,6 +640,11 @@ static const char *obs_signals[] = {
 	"void channel_change(int channel, in out ptr source, ptr prev_source)",
 	"void master_volume(in out float volume)",
 
+	"void video_stats(int total_frames, int rendered_frames, "
+		"int lagged_frames, int duplicated_frames, int culled_items, "
+		"int draw_calls, int sprites, "
+		"int readback_stalls, int readback_stall_time)",
+
 	NULL
 };
 
@@ -493,10 +663,28 @@ static inline bool obs_init_handlers(void)
 
 extern const struct obs_source_info scene_info;
 
+/* maximum number of job pool worker threads */
+#define MAX_JOB_THREADS 8
+
+static bool obs_init_job_pool(void)
+{
+	int num_threads = os_get_logical_cores() - 1;
+
+	if (num_threads > MAX_JOB_THREADS)
+		num_threads = MAX_JOB_THREADS;
+	if (num_threads < 0)
+		num_threads = 0;
+
+	obs->job_pool = job_pool_create((size_t)num_threads);
+	return obs->job_pool != NULL;
+}
+
 static bool obs_init(void)
 {
 	obs = bzalloc(sizeof(struct obs_core));
 
+	if (!obs_init_job_pool())
+		return false;
 	if (!obs_init_data())
 		return false;
 	if (!obs_init_handlers())
@@ -506,6 +694,24 @@ static bool obs_init(void)
 	return true;
 }
 
+/* OBS_PROFILER=1 profiles the whole session, and any other value is used as
+ * the path of a trace file to write as well */
+static inline void start_profiler(void)
+{
+	const char *value = getenv("OBS_PROFILER");
+
+	if (!value || !*value || strcmp(value, "0") == 0)
+		return;
+
+	if (strcmp(value, "1") == 0)
+		value = NULL;
+
+	if (profiler_start(value))
+		blog(LOG_INFO, "Profiler started%s%s",
+				value ? ", writing trace to " : "",
+				value ? value : "");
+}
+
 bool obs_startup(void)
 {
 	bool success;
@@ -515,6 +721,8 @@ bool obs_startup(void)
 		return false;
 	}
 
+	start_profiler();
+
 	success = obs_init();
 	if (!success)
 		obs_shutdown();
@@ -542,6 +750,10 @@ void obs_shutdown(void)
 	obs_free_video();
 	obs_free_graphics();
 	obs_free_audio();
+
+	/* the video thread has stopped and all sources are gone */
+	job_pool_destroy(obs->job_pool);
+
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 
@@ -549,6 +761,11 @@ void obs_shutdown(void)
 		free_module(obs->modules.array+i);
 	da_free(obs->modules);
 
+	/* all profiled threads have stopped by now */
+	profiler_stop();
+	profiler_print();
+	profiler_free();
+
 	bfree(obs);
 	obs = NULL;
 }
@@ -619,6 +836,36 @@ bool obs_get_video_info(struct obs_video_info *ovi)
 	ovi->output_format = info->format;
 	ovi->fps_num       = info->fps_num;
 	ovi->fps_den       = info->fps_den;
+	ovi->threaded_displays = video->threaded_displays;
+	ovi->display_fps   = video->display_fps;
+	ovi->colorspace    = info->colorspace;
+	ovi->range         = info->range;
+	ovi->scale_type    = video->scale_type;
+
+	return true;
+}
+
+bool obs_get_video_stats(struct obs_video_stats *stats)
+{
+	struct obs_core_video *video = &obs->video;
+
+	if (!obs || !video->video)
+		return false;
+
+	stats->total_frames      = video_output_total_frames(video->video);
+	stats->lagged_frames     = video_output_lagged_frames(video->video);
+	stats->duplicated_frames = video_output_duplicated_frames(video->video);
+	stats->rendered_frames   = video->rendered_frames;
+	stats->culled_items      = video->culled_items;
+	stats->draw_calls        = video->draw_calls;
+	stats->sprites           = video->sprites;
+	stats->readback_stalls   = video->readback_stalls;
+	stats->readback_stall_time = video->readback_stall_time;
+
+	for (size_t i = 0; i < OBS_TIME_HISTOGRAM_BUCKETS; i++) {
+		stats->render_times[i] = (uint32_t)video->render_times[i];
+		stats->encode_times[i] = (uint32_t)video->encode_times[i];
+	}
 
 	return true;
 }
@@ -780,6 +1027,8 @@ bool obs_add_source(obs_source_t source)
 
 	pthread_mutex_lock(&obs->data.sources_mutex);
 	da_push_back(obs->data.user_sources, &source);
+	source->user_source = true;
+	source->user_order  = obs->data.next_user_order++;
 	obs_source_addref(source);
 	pthread_mutex_unlock(&obs->data.sources_mutex);
 
@@ -894,64 +1143,70 @@ void obs_enum_services(bool (*enum_proc)(void*, obs_service_t), void *param)
 
 obs_source_t obs_get_source_by_name(const char *name)
 {
-	struct obs_core_data *data = &obs->data;
-	struct obs_source *source = NULL;
-	size_t i;
+	struct obs_core_data    *data = &obs->data;
+	struct obs_context_data *context = NULL;
+	struct obs_source       *source = NULL;
 
-	if (!obs) return NULL;
+	if (!obs || !name) return NULL;
+
+	/* the user source list is only modified with sources_mutex locked, so
+	 * that's what guards the lookup rather than user_sources_mutex.
+	 * callers that hold user_sources_mutex (obs_load_sources) already lock
+	 * sources_mutex inside it when creating sources, so this doesn't add a
+	 * new lock order */
+	pthread_mutex_lock(&data->sources_mutex);
 
-	pthread_mutex_lock(&data->user_sources_mutex);
+	/* only sources that have been added by the user.  this used to search
+	 * the user source list from the start, so the one added first is
+	 * returned if names collide */
+	while ((context = obs_context_index_find(&data->sources_index, name,
+					context)) != NULL) {
+		struct obs_source *cur_source = (struct obs_source*)context;
 
-	for (i = 0; i < data->user_sources.num; i++) {
-		struct obs_source *cur_source = data->user_sources.array[i];
-		if (strcmp(cur_source->context.name, name) == 0) {
+		if (cur_source->user_source && (!source ||
+		    cur_source->user_order < source->user_order))
 			source = cur_source;
-			obs_source_addref(source);
-			break;
-		}
 	}
 
-	pthread_mutex_unlock(&data->user_sources_mutex);
+	if (source)
+		obs_source_addref(source);
+
+	pthread_mutex_unlock(&data->sources_mutex);
 	return source;
 }
 
-static inline void *get_context_by_name(void *vfirst, const char *name,
-		pthread_mutex_t *mutex)
+static inline void *get_context_by_name(struct obs_context_index *index,
+		const char *name, pthread_mutex_t *mutex)
 {
-	struct obs_context_data **first = vfirst;
 	struct obs_context_data *context;
 
-	pthread_mutex_lock(mutex);
-
-	context = *first;
-	while (context) {
-		if (strcmp(context->name, name) == 0)
-			break;
-		context = context->next;
-	}
+	if (!name) return NULL;
 
+	pthread_mutex_lock(mutex);
+	context = obs_context_index_find(index, name, NULL);
 	pthread_mutex_unlock(mutex);
+
 	return context;
 }
 
 obs_output_t obs_get_output_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_output, name,
+	return get_context_by_name(&obs->data.outputs_index, name,
 			&obs->data.outputs_mutex);
 }
 
 obs_encoder_t obs_get_encoder_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_encoder, name,
+	return get_context_by_name(&obs->data.encoders_index, name,
 			&obs->data.encoders_mutex);
 }
 
 obs_service_t obs_get_service_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_service, name,
+	return get_context_by_name(&obs->data.services_index, name,
 			&obs->data.services_mutex);
 }
 
@@ -997,10 +1252,44 @@ void obs_resize(uint32_t cx, uint32_t cy)
 	obs_display_resize(&obs->video.main_display, cx, cy);
 }
 
+/* when displays are threaded, draw the frame the video thread already
+ * composited instead of rendering every source a second time */
+static void render_main_texture(struct obs_core_video *video)
+{
+	texture_t   texture;
+	effect_t    effect = video->default_effect;
+	technique_t tech   = effect_gettechnique(effect, "Draw");
+	eparam_t    image  = effect_getparambyname(effect, "image");
+	size_t      passes, i;
+
+	if (video->main_texture < 0)
+		return;
+
+	texture = video->render_textures[video->main_texture];
+	effect_settexture(effect, image, texture);
+
+	gs_enable_blending(false);
+
+	passes = technique_begin(tech);
+	for (i = 0; i < passes; i++) {
+		technique_beginpass(tech, i);
+		gs_draw_sprite(texture, 0, video->base_width,
+				video->base_height);
+		technique_endpass(tech);
+	}
+	technique_end(tech);
+
+	gs_enable_blending(true);
+}
+
 void obs_render_main_view(void)
 {
 	if (!obs) return;
-	obs_view_render(&obs->data.main_view);
+
+	if (obs->video.threaded_displays)
+		render_main_texture(&obs->video);
+	else
+		obs_view_render(&obs->data.main_view);
 }
 
 void obs_set_master_volume(float volume)
@@ -1186,14 +1475,138 @@ void obs_context_data_free(struct obs_context_data *context)
 	memset(context, 0, sizeof(*context));
 }
 
+/* ------------------------------------------------------------------------- */
+/* context name index */
+
+#define MIN_INDEX_BUCKETS 64
+
+/* FNV-1a */
+static inline uint32_t hash_name(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static inline struct obs_context_data **get_bucket(
+		struct obs_context_index *index, uint32_t hash)
+{
+	return index->buckets + (hash & (index->num_buckets - 1));
+}
+
+/* buckets are kept newest first, like the context lists, so that the same
+ * context is found for a name as when the lists were searched.  new contexts
+ * go to the head of their bucket, and renamed contexts (and contexts moved
+ * by a resize) go back to where their age puts them */
+static void index_link(struct obs_context_index *index,
+		struct obs_context_data *context)
+{
+	struct obs_context_data **bucket = get_bucket(index, context->name_hash);
+
+	while (*bucket && (*bucket)->index_order > context->index_order)
+		bucket = &(*bucket)->hash_next;
+
+	context->hash_prev_next = bucket;
+	context->hash_next      = *bucket;
+	*bucket                 = context;
+	if (context->hash_next)
+		context->hash_next->hash_prev_next = &context->hash_next;
+}
+
+static void index_resize(struct obs_context_index *index, size_t num_buckets)
+{
+	struct obs_context_data **old_buckets = index->buckets;
+	size_t                  old_num       = index->num_buckets;
+
+	index->buckets     = bzalloc(num_buckets * sizeof(*index->buckets));
+	index->num_buckets = num_buckets;
+
+	for (size_t i = 0; i < old_num; i++) {
+		struct obs_context_data *context = old_buckets[i];
+
+		while (context) {
+			struct obs_context_data *next = context->hash_next;
+			index_link(index, context);
+			context = next;
+		}
+	}
+
+	bfree(old_buckets);
+}
+
+static void index_insert(struct obs_context_index *index,
+		struct obs_context_data *context)
+{
+	if (!index->num_buckets)
+		index_resize(index, MIN_INDEX_BUCKETS);
+	else if (index->count >= index->num_buckets)
+		index_resize(index, index->num_buckets * 2);
+
+	context->index     = index;
+	context->name_hash = hash_name(context->name);
+	index_link(index, context);
+	index->count++;
+}
+
+static void index_remove(struct obs_context_data *context)
+{
+	if (!context->index)
+		return;
+
+	*context->hash_prev_next = context->hash_next;
+	if (context->hash_next)
+		context->hash_next->hash_prev_next = context->hash_prev_next;
+
+	context->index->count--;
+	context->index = NULL;
+}
+
+struct obs_context_data *obs_context_index_find(
+		struct obs_context_index *index, const char *name,
+		struct obs_context_data *prev)
+{
+	struct obs_context_data *context;
+	uint32_t                hash;
+
+	if (!index->num_buckets)
+		return NULL;
+
+	hash    = hash_name(name);
+	context = prev ? prev->hash_next : *get_bucket(index, hash);
+
+	while (context) {
+		if (context->name_hash == hash &&
+		    strcmp(context->name, name) == 0)
+			break;
+		context = context->hash_next;
+	}
+
+	return context;
+}
+
+void obs_context_index_free(struct obs_context_index *index)
+{
+	bfree(index->buckets);
+	memset(index, 0, sizeof(*index));
+}
+
+/* ------------------------------------------------------------------------- */
+
 void obs_context_data_insert(struct obs_context_data *context,
-		pthread_mutex_t *mutex, void *pfirst)
+		pthread_mutex_t *mutex, void *pfirst,
+		struct obs_context_index *index)
 {
 	struct obs_context_data **first = pfirst;
 
 	assert(context);
 	assert(mutex);
 	assert(first);
+	assert(index);
 
 	context->mutex = mutex;
 
@@ -1203,6 +1616,8 @@ void obs_context_data_insert(struct obs_context_data *context,
 	*first              = context;
 	if (context->next)
 		context->next->prev_next = &context->next;
+	context->index_order = ++index->next_order;
+	index_insert(index, context);
 	pthread_mutex_unlock(mutex);
 }
 
@@ -1213,6 +1628,7 @@ void obs_context_data_remove(struct obs_context_data *context)
 		*context->prev_next = context->next;
 		if (context->next)
 			context->next->prev_next = context->prev_next;
+		index_remove(context);
 		pthread_mutex_unlock(context->mutex);
 
 		context->mutex = NULL;
@@ -1222,6 +1638,23 @@ void obs_context_data_remove(struct obs_context_data *context)
 void obs_context_data_setname(struct obs_context_data *context,
 		const char *name)
 {
-	bfree(context->name);
-	context->name = dup_name(name);
+	pthread_mutex_t *mutex = context->mutex;
+
+	if (mutex)
+		pthread_mutex_lock(mutex);
+
+	if (context->index) {
+		struct obs_context_index *index = context->index;
+
+		index_remove(context);
+		bfree(context->name);
+		context->name = dup_name(name);
+		index_insert(index, context);
+	} else {
+		bfree(context->name);
+		context->name = dup_name(name);
+	}
+
+	if (mutex)
+		pthread_mutex_unlock(mutex);
 }
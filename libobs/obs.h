@@ -114,6 +114,13 @@ enum allow_direct_render {
 	ALLOW_DIRECT_RENDERING,
 };
 
+/** Filter used to scale the base canvas to the output size */
+enum obs_scale_type {
+	OBS_SCALE_BICUBIC,
+	OBS_SCALE_BILINEAR,
+	OBS_SCALE_LANCZOS
+};
+
 /**
  * Video initialization structure
  */
@@ -144,6 +151,76 @@ struct obs_video_info {
 
 	/** Use shaders to convert to different color formats */
 	bool                gpu_conversion;
+
+	/** Scheduling policy of the video timing thread */
+	enum os_thread_sched timing_thread_sched;
+
+	/**
+	 * Microseconds the video timing thread busy-waits before each frame
+	 * deadline for more precise frame timing (0 to disable)
+	 */
+	uint32_t            timing_spin_us;
+
+	/**
+	 * Render displays on a separate thread from the last composited
+	 * frame rather than re-rendering the main view on the video thread
+	 */
+	bool                threaded_displays;
+
+	/** Threaded display refresh rate (0 to use the output FPS) */
+	uint32_t            display_fps;
+
+	/**
+	 * Color space and range of YUV output.  The default color space is
+	 * 709 for outputs 720 pixels high or more and 601 otherwise, and the
+	 * default range is partial.
+	 */
+	enum video_colorspace colorspace;
+	enum video_range_type range;
+
+	/** Output scaling filter, used when the output and base sizes differ */
+	enum obs_scale_type scale_type;
+};
+
+/**
+ * Number of buckets in frame time histograms.  Bucket 0 counts times under
+ * 1ms, bucket N counts times from 2^(N-1)ms up to 2^N ms, and the last bucket
+ * also counts anything longer.
+ */
+#define OBS_TIME_HISTOGRAM_BUCKETS 8
+
+/**
+ * Video pipeline statistics since video was last reset
+ */
+struct obs_video_stats {
+	uint32_t            total_frames;      /**< Frames output */
+	uint32_t            rendered_frames;   /**< Frames rendered */
+	uint32_t            lagged_frames;     /**< Frames that were late */
+
+	/** Frames repeated to the encoders because no new frame was ready */
+	uint32_t            duplicated_frames;
+
+	/** Time taken to tick, render and output each frame */
+	uint32_t            render_times[OBS_TIME_HISTOGRAM_BUCKETS];
+
+	/** Time video encoders took to encode each frame */
+	uint32_t            encode_times[OBS_TIME_HISTOGRAM_BUCKETS];
+
+	/** Scene items skipped in the last frame (hidden, off-canvas, covered) */
+	uint32_t            culled_items;
+
+	/**
+	 * Draw calls and sprites used to render the last frame of the main
+	 * view.  Fewer draw calls than sprites means sprites were batched
+	 */
+	uint32_t            draw_calls;
+	uint32_t            sprites;
+
+	/** Frames whose GPU readback had not finished when it was needed */
+	uint32_t            readback_stalls;
+
+	/** Total time spent waiting on those readbacks, in nanoseconds */
+	uint64_t            readback_stall_time;
 };
 
 /**
@@ -198,7 +275,14 @@ struct source_frame {
 /* ------------------------------------------------------------------------- */
 /* OBS context */
 
-/** Initializes OBS */
+/**
+ * Initializes OBS
+ *
+ *   If the OBS_PROFILER environment variable is set to 1, the profiler (see
+ * util/profiler.h) runs from startup to shutdown, and the results are logged
+ * on shutdown.  Any other value except 0 is used as the path of a Chrome
+ * trace file to write as well.
+ */
 EXPORT bool obs_startup(void);
 
 /** Releases all data associated with OBS and terminates the OBS context */
@@ -227,6 +311,14 @@ EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct audio_output_info *ai);
 
+/**
+ * Gets the current video pipeline statistics, returns false if no video.
+ *
+ *   These are also sent about once a second through the "video_stats" core
+ * signal.
+ */
+EXPORT bool obs_get_video_stats(struct obs_video_stats *stats);
+
 /**
  * Loads a plugin module
  *
@@ -507,6 +599,13 @@ EXPORT obs_properties_t obs_source_properties(obs_source_t source,
 /** Updates settings for this source */
 EXPORT void obs_source_update(obs_source_t source, obs_data_t settings);
 
+/**
+ * Marks the output of the source as changed.  Sources that specify
+ * OBS_SOURCE_CACHEABLE call this (usually from video_tick) whenever their
+ * output changes outside of updates and async frames.
+ */
+EXPORT void obs_source_invalidate(obs_source_t source);
+
 /** Renders a video source. */
 EXPORT void obs_source_video_render(obs_source_t source);
 
@@ -516,6 +615,19 @@ EXPORT uint32_t obs_source_getwidth(obs_source_t source);
 /** Gets the height of a source (if it has video) */
 EXPORT uint32_t obs_source_getheight(obs_source_t source);
 
+/**
+ * Gets the time (in nanoseconds) the source spent in video_tick_prepare and
+ * video_tick for the last frame
+ */
+EXPORT uint64_t obs_source_get_tick_time(obs_source_t source);
+
+/**
+ * Gets the time (in nanoseconds) spent uploading the last async video frame
+ * of the source.  Synchronous sources upload in video_tick, which is
+ * included in obs_source_get_tick_time instead.
+ */
+EXPORT uint64_t obs_source_get_upload_time(obs_source_t source);
+
 /** If the source is a filter, returns the parent source of the filter */
 EXPORT obs_source_t obs_filter_getparent(obs_source_t filter);
 
@@ -707,6 +819,9 @@ EXPORT float obs_sceneitem_getrot(obs_sceneitem_t item);
 EXPORT void  obs_sceneitem_getorigin(obs_sceneitem_t item, struct vec2 *center);
 EXPORT void  obs_sceneitem_getscale(obs_sceneitem_t item, struct vec2 *scale);
 
+EXPORT void obs_sceneitem_setvisible(obs_sceneitem_t item, bool visible);
+EXPORT bool obs_sceneitem_visible(obs_sceneitem_t item);
+
 
 /* ------------------------------------------------------------------------- */
 /* Outputs */
@@ -908,6 +1023,22 @@ EXPORT obs_properties_t obs_encoder_properties(obs_encoder_t encoder,
  */
 EXPORT void obs_encoder_update(obs_encoder_t encoder, obs_data_t settings);
 
+/**
+ * Requests a runtime change of the target bitrate (in kbps) without changing
+ * the encoder settings.  The change is applied by the encoding thread before
+ * the next frame.  Used by outputs to adapt to network conditions.  Returns
+ * false if the encoder does not support runtime bitrate changes.
+ */
+EXPORT bool obs_encoder_request_bitrate(obs_encoder_t encoder,
+		uint32_t bitrate);
+
+/**
+ * Returns the runtime bitrate (in kbps) last requested for the encoder, or 0
+ * if it is running at the bitrate specified in its settings (no request was
+ * made, or the settings were updated since)
+ */
+EXPORT uint32_t obs_encoder_get_bitrate(obs_encoder_t encoder);
+
 /** Gets extra data (headers) associated with this context */
 EXPORT bool obs_encoder_get_extra_data(obs_encoder_t encoder,
 		uint8_t **extra_data, size_t *size);
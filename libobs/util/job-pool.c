@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+#include "bmem.h"
+#include "darray.h"
+#include "threading.h"
+#include "job-pool.h"
+
+struct job_pool {
+	pthread_mutex_t   run_mutex;
+	DARRAY(pthread_t) threads;
+	size_t            max_threads;
+	bool              started;
+
+	job_pool_proc_t   proc;
+	void              *param;
+	long              num_jobs;
+	volatile long     next_job;
+
+	os_sem_t          start_sem;
+	os_sem_t          done_sem;
+	volatile bool     stop;
+};
+
+static void run_jobs(struct job_pool *pool)
+{
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&pool->next_job) - 1) <
+			pool->num_jobs)
+		pool->proc(pool->param, (size_t)idx);
+}
+
+static void *job_thread(void *data)
+{
+	struct job_pool *pool = data;
+
+	while (os_sem_wait(pool->start_sem) == 0) {
+		if (pool->stop)
+			break;
+
+		run_jobs(pool);
+		os_sem_post(pool->done_sem);
+	}
+
+	return NULL;
+}
+
+job_pool_t job_pool_create(size_t max_threads)
+{
+	struct job_pool *pool = bzalloc(sizeof(struct job_pool));
+
+	pool->max_threads = max_threads;
+
+	if (pthread_mutex_init(&pool->run_mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		goto fail;
+	if (os_sem_init(&pool->done_sem, 0) != 0)
+		goto fail;
+
+	return pool;
+
+fail:
+	os_sem_destroy(pool->start_sem);
+	bfree(pool);
+	return NULL;
+}
+
+void job_pool_destroy(job_pool_t pool)
+{
+	void *thread_retval;
+
+	if (!pool)
+		return;
+
+	pool->stop = true;
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], &thread_retval);
+
+	pthread_mutex_destroy(&pool->run_mutex);
+	os_sem_destroy(pool->start_sem);
+	os_sem_destroy(pool->done_sem);
+	da_free(pool->threads);
+	bfree(pool);
+}
+
+size_t job_pool_max_threads(job_pool_t pool)
+{
+	return pool ? pool->max_threads : 0;
+}
+
+/* with fewer threads if some couldn't be created */
+static void start_threads(struct job_pool *pool)
+{
+	pool->started = true;
+
+	for (size_t i = 0; i < pool->max_threads; i++) {
+		pthread_t thread;
+
+		if (pthread_create(&thread, NULL, job_thread, pool) != 0)
+			break;
+
+		da_push_back(pool->threads, &thread);
+	}
+}
+
+/* every woken worker posts done_sem when it runs out of jobs, so nothing
+ * touches the jobs' data once this returns */
+static void run_locked(struct job_pool *pool, size_t num_jobs,
+		job_pool_proc_t proc, void *param)
+{
+	size_t num_workers = num_jobs - 1;
+
+	if (num_workers && !pool->started)
+		start_threads(pool);
+	if (num_workers > pool->threads.num)
+		num_workers = pool->threads.num;
+
+	pool->proc     = proc;
+	pool->param    = param;
+	pool->num_jobs = (long)num_jobs;
+	pool->next_job = 0;
+
+	for (size_t i = 0; i < num_workers; i++)
+		os_sem_post(pool->start_sem);
+
+	run_jobs(pool);
+
+	for (size_t i = 0; i < num_workers; i++)
+		os_sem_wait(pool->done_sem);
+}
+
+void job_pool_run(job_pool_t pool, size_t num_jobs, job_pool_proc_t proc,
+		void *param)
+{
+	if (!pool) {
+		for (size_t i = 0; i < num_jobs; i++)
+			proc(param, i);
+		return;
+	}
+	if (!num_jobs)
+		return;
+
+	pthread_mutex_lock(&pool->run_mutex);
+	run_locked(pool, num_jobs, proc, param);
+	pthread_mutex_unlock(&pool->run_mutex);
+}
+
+bool job_pool_try_run(job_pool_t pool, size_t num_jobs, job_pool_proc_t proc,
+		void *param)
+{
+	if (!pool)
+		return false;
+	if (!num_jobs)
+		return true;
+	if (pthread_mutex_trylock(&pool->run_mutex) != 0)
+		return false;
+
+	run_locked(pool, num_jobs, proc, param);
+	pthread_mutex_unlock(&pool->run_mutex);
+	return true;
+}
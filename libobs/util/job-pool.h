@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ *   Splits work in to a number of independent jobs and runs them on a set of
+ * worker threads, with the calling thread taking part as well.  The worker
+ * threads are only created the first time more than one job is run, and are
+ * shared by everything that uses the pool.  One run happens at a time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct job_pool;
+typedef struct job_pool *job_pool_t;
+
+/** called once for each job index */
+typedef void (*job_pool_proc_t)(void *param, size_t idx);
+
+/** creates a pool using at most max_threads worker threads */
+EXPORT job_pool_t job_pool_create(size_t max_threads);
+EXPORT void job_pool_destroy(job_pool_t pool);
+
+/** the number of worker threads the pool runs jobs on */
+EXPORT size_t job_pool_max_threads(job_pool_t pool);
+
+/**
+ * runs jobs 0 to num_jobs-1, and returns when all of them are done.  waits
+ * for any other run of the pool to finish first.  without a pool, the jobs
+ * are run on the calling thread
+ */
+EXPORT void job_pool_run(job_pool_t pool, size_t num_jobs,
+		job_pool_proc_t proc, void *param);
+
+/**
+ * same as job_pool_run, but returns false without running anything if the
+ * pool is being used by another thread
+ */
+EXPORT bool job_pool_try_run(job_pool_t pool, size_t num_jobs,
+		job_pool_proc_t proc, void *param);
+
+#ifdef __cplusplus
+}
+#endif
@@ -21,6 +21,8 @@
 #include <dlfcn.h>
 #include <time.h>
 #include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
 
 #include <sys/stat.h>
 
@@ -60,23 +62,35 @@ void os_dlclose(void *module)
 	dlclose(module);
 }
 
+static __thread uint32_t sleep_spin_us = 0;
+
 bool os_sleepto_ns(uint64_t time_target)
 {
 	uint64_t current = os_gettime_ns();
+	uint64_t spin_ns = (uint64_t)sleep_spin_us * 1000;
+	uint64_t sleep_ns;
+
 	if (time_target < current)
 		return false;
 
-	time_target -= current;
-
-	struct timespec req, remain;
-	memset(&req, 0, sizeof(req));
-	memset(&remain, 0, sizeof(remain));
-	req.tv_sec = time_target/1000000000;
-	req.tv_nsec = time_target%1000000000;
+	if (time_target - current > spin_ns) {
+		sleep_ns = time_target - current - spin_ns;
 
-	while (nanosleep(&req, &remain)) {
-		req = remain;
+		struct timespec req, remain;
+		memset(&req, 0, sizeof(req));
 		memset(&remain, 0, sizeof(remain));
+		req.tv_sec = sleep_ns/1000000000;
+		req.tv_nsec = sleep_ns%1000000000;
+
+		while (nanosleep(&req, &remain)) {
+			req = remain;
+			memset(&remain, 0, sizeof(remain));
+		}
+	}
+
+	if (spin_ns) {
+		while (os_gettime_ns() < time_target)
+			;
 	}
 
 	return true;
@@ -87,6 +101,42 @@ void os_sleep_ms(uint32_t duration)
 	usleep(duration*1000);
 }
 
+void os_set_thread_sleep_spin(uint32_t usec)
+{
+	sleep_spin_us = usec;
+}
+
+bool os_set_thread_timer_slack(uint64_t slack_ns)
+{
+	UNUSED_PARAMETER(slack_ns);
+	return false;
+}
+
+bool os_set_thread_sched(enum os_thread_sched sched)
+{
+	struct sched_param param;
+	int policy;
+
+	memset(&param, 0, sizeof(param));
+
+	switch (sched) {
+	case OS_THREAD_SCHED_FIFO: policy = SCHED_FIFO;  break;
+	case OS_THREAD_SCHED_RR:   policy = SCHED_RR;    break;
+	default:                   policy = SCHED_OTHER; break;
+	}
+
+	if (policy != SCHED_OTHER)
+		param.sched_priority = sched_get_priority_min(policy) + 1;
+	else if (sched == OS_THREAD_SCHED_LOW)
+		param.sched_priority = (sched_get_priority_min(policy) +
+			sched_get_priority_max(policy)) / 2 - 4;
+	else
+		param.sched_priority = (sched_get_priority_min(policy) +
+			sched_get_priority_max(policy)) / 2;
+
+	return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+}
+
 
 /* clock function selection taken from libc++ */
 static uint64_t ns_time_simple()
@@ -126,6 +176,12 @@ uint64_t os_gettime_ns(void)
 	return f();
 }
 
+int os_get_logical_cores(void)
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cores > 0) ? (int)cores : 1;
+}
+
 /* gets the location ~/Library/Application Support/[name] */
 char *os_get_config_path(const char *name)
 {
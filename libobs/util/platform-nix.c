@@ -21,6 +21,14 @@
 #include <dlfcn.h>
 #include <unistd.h>
 #include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
 
 #include "dstr.h"
 #include "platform.h"
@@ -55,23 +63,41 @@ void os_dlclose(void *module)
 	dlclose(module);
 }
 
+static __thread uint32_t sleep_spin_us = 0;
+
+static inline void cpu_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#endif
+}
+
+/* sleeps until an absolute point in time, so time spent waking up or being
+ * interrupted doesn't accumulate */
+static void sleep_until(uint64_t time_target)
+{
+	struct timespec req;
+	req.tv_sec  = (time_t)(time_target / 1000000000);
+	req.tv_nsec = (long)(time_target % 1000000000);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &req, NULL)
+			== EINTR);
+}
+
 bool os_sleepto_ns(uint64_t time_target)
 {
 	uint64_t current = os_gettime_ns();
+	uint64_t spin_ns = (uint64_t)sleep_spin_us * 1000;
+
 	if (time_target < current)
 		return false;
 
-	time_target -= current;
+	if (time_target - current > spin_ns)
+		sleep_until(time_target - spin_ns);
 
-	struct timespec req, remain;
-	memset(&req, 0, sizeof(req));
-	memset(&remain, 0, sizeof(remain));
-	req.tv_sec = time_target/1000000000;
-	req.tv_nsec = time_target%1000000000;
-
-	while (nanosleep(&req, &remain)) {
-		req = remain;
-		memset(&remain, 0, sizeof(remain));
+	if (spin_ns) {
+		while (os_gettime_ns() < time_target)
+			cpu_relax();
 	}
 
 	return true;
@@ -79,7 +105,51 @@ bool os_sleepto_ns(uint64_t time_target)
 
 void os_sleep_ms(uint32_t duration)
 {
-	usleep(duration*1000);
+	sleep_until(os_gettime_ns() + (uint64_t)duration * 1000000);
+}
+
+void os_set_thread_sleep_spin(uint32_t usec)
+{
+	sleep_spin_us = usec;
+}
+
+bool os_set_thread_timer_slack(uint64_t slack_ns)
+{
+#ifdef __linux__
+	return prctl(PR_SET_TIMERSLACK, (unsigned long)slack_ns, 0, 0, 0) == 0;
+#else
+	UNUSED_PARAMETER(slack_ns);
+	return false;
+#endif
+}
+
+bool os_set_thread_sched(enum os_thread_sched sched)
+{
+	struct sched_param param;
+	int policy;
+
+	memset(&param, 0, sizeof(param));
+
+	switch (sched) {
+	case OS_THREAD_SCHED_FIFO: policy = SCHED_FIFO;  break;
+	case OS_THREAD_SCHED_RR:   policy = SCHED_RR;    break;
+	default:                   policy = SCHED_OTHER; break;
+	}
+
+	if (policy != SCHED_OTHER)
+		param.sched_priority = sched_get_priority_min(policy) + 1;
+
+	if (pthread_setschedparam(pthread_self(), policy, &param) != 0)
+		return false;
+
+#ifdef __linux__
+	/* SCHED_OTHER threads have no priority of their own, but linux applies
+	 * the nice value per thread */
+	if (policy == SCHED_OTHER)
+		return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid),
+				sched == OS_THREAD_SCHED_LOW ? 5 : 0) == 0;
+#endif
+	return true;
 }
 
 uint64_t os_gettime_ns(void)
@@ -89,6 +159,12 @@ uint64_t os_gettime_ns(void)
 	return ((uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec);
 }
 
+int os_get_logical_cores(void)
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cores > 0) ? (int)cores : 1;
+}
+
 /* should return $HOME/.[name] */
 char *os_get_config_path(const char *name)
 {
@@ -86,15 +86,19 @@ void os_dlclose(void *module)
 	FreeLibrary(module);
 }
 
+static __declspec(thread) uint32_t sleep_spin_us = 0;
+
 bool os_sleepto_ns(uint64_t time_target)
 {
 	uint64_t t = os_gettime_ns();
+	uint64_t spin_ns = (uint64_t)sleep_spin_us * 1000;
 	uint32_t milliseconds;
 
 	if (t >= time_target)
 		return false;
 
-	milliseconds = (uint32_t)((time_target - t)/1000000);
+	milliseconds = (time_target - t > spin_ns) ?
+		(uint32_t)((time_target - t - spin_ns)/1000000) : 0;
 	if (milliseconds > 1)
 		Sleep(milliseconds-1);
 
@@ -103,11 +107,10 @@ bool os_sleepto_ns(uint64_t time_target)
 		if (t >= time_target)
 			return true;
 
-#if 1
-		Sleep(1);
-#else
-		Sleep(0);
-#endif
+		if (time_target - t <= spin_ns)
+			YieldProcessor();
+		else
+			Sleep(1);
 	}
 }
 
@@ -120,6 +123,30 @@ void os_sleep_ms(uint32_t duration)
 	Sleep(duration);
 }
 
+void os_set_thread_sleep_spin(uint32_t usec)
+{
+	sleep_spin_us = usec;
+}
+
+bool os_set_thread_timer_slack(uint64_t slack_ns)
+{
+	UNUSED_PARAMETER(slack_ns);
+	return false;
+}
+
+bool os_set_thread_sched(enum os_thread_sched sched)
+{
+	int priority;
+
+	switch (sched) {
+	case OS_THREAD_SCHED_NORMAL: priority = THREAD_PRIORITY_NORMAL;       break;
+	case OS_THREAD_SCHED_LOW:    priority = THREAD_PRIORITY_BELOW_NORMAL; break;
+	default:                     priority = THREAD_PRIORITY_TIME_CRITICAL;
+	}
+
+	return !!SetThreadPriority(GetCurrentThread(), priority);
+}
+
 uint64_t os_gettime_ns(void)
 {
 	LARGE_INTEGER current_time;
@@ -133,6 +160,13 @@ uint64_t os_gettime_ns(void)
 	return (uint64_t)time_val;
 }
 
+int os_get_logical_cores(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors ? (int)info.dwNumberOfProcessors : 1;
+}
+
 /* returns %appdata%\[name] on windows */
 char *os_get_config_path(const char *name)
 {
@@ -70,8 +70,40 @@ EXPORT void os_dlclose(void *module);
 EXPORT bool os_sleepto_ns(uint64_t time_target);
 EXPORT void os_sleep_ms(uint32_t duration);
 
+/**
+ * Makes os_sleepto_ns busy-wait for the last few microseconds before the
+ * target time on the calling thread, trading CPU time for lower wakeup
+ * jitter.  0 (the default) disables spinning.
+ */
+EXPORT void os_set_thread_sleep_spin(uint32_t usec);
+
+/**
+ * Sets the timer slack of the calling thread in nanoseconds, which is how
+ * late the system may wake it from a sleep.  0 restores the default.
+ * Returns false if not supported on this platform.
+ */
+EXPORT bool os_set_thread_timer_slack(uint64_t slack_ns);
+
+enum os_thread_sched {
+	OS_THREAD_SCHED_NORMAL,
+	OS_THREAD_SCHED_FIFO,
+	OS_THREAD_SCHED_RR,
+	OS_THREAD_SCHED_LOW
+};
+
+/**
+ * Sets the scheduling policy of the calling thread.  The realtime policies
+ * usually require elevated privileges.  OS_THREAD_SCHED_LOW is the normal
+ * policy at a lower priority, for threads that shouldn't compete with the
+ * video and audio threads.  Returns false on failure.
+ */
+EXPORT bool os_set_thread_sched(enum os_thread_sched sched);
+
 EXPORT uint64_t os_gettime_ns(void);
 
+/** Returns the number of logical CPU cores available (at least 1) */
+EXPORT int os_get_logical_cores(void);
+
 EXPORT char *os_get_config_path(const char *name);
 
 EXPORT bool os_file_exists(const char *path);
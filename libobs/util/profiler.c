@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "bmem.h"
+#include "base.h"
+#include "darray.h"
+#include "platform.h"
+#include "threading.h"
+#include "profiler.h"
+
+#define MAX_NESTING         32
+#define RING_SIZE           8192 /* must be a power of two */
+#define MAX_SAMPLES         4096
+#define COLLECT_INTERVAL_MS 100
+
+struct profile_entry {
+	const char            *name;
+	uint64_t              start;
+	uint64_t              end;
+	int                   depth;
+};
+
+struct profile_scope_start {
+	const char            *name;
+	uint64_t              start;
+};
+
+/* single producer (the owning thread), single consumer (the collector) */
+struct profile_thread {
+	struct profile_entry       entries[RING_SIZE];
+	volatile long              write_pos;
+	volatile long              read_pos;
+	long                       dropped;
+
+	struct profile_scope_start stack[MAX_NESTING];
+	int                        depth;
+
+	int                        id;
+	bool                       exited;
+	struct profile_thread      *next;
+};
+
+struct profile_scope {
+	const char            *name;
+	int                   depth;
+	uint64_t              calls;
+	uint64_t              total_ns;
+	uint64_t              min_ns;
+	uint64_t              max_ns;
+	uint64_t              *samples;
+};
+
+static struct {
+	pthread_mutex_t               mutex;
+	struct profile_thread         *first_thread;
+	int                           next_thread_id;
+	long                          dropped;
+	pthread_key_t                 thread_key;
+	bool                          thread_key_created;
+	DARRAY(struct profile_scope)  scopes;
+
+	pthread_t                     collect_thread;
+	os_event_t                    stop_event;
+	bool                          thread_initialized;
+
+	FILE                          *trace;
+	bool                          trace_first;
+	uint64_t                      start_time;
+} profiler = {PTHREAD_MUTEX_INITIALIZER};
+
+static volatile bool enabled    = false;
+static volatile long generation = 0;
+
+#ifdef _MSC_VER
+static __declspec(thread) struct profile_thread *thread_data = NULL;
+static __declspec(thread) long thread_generation = 0;
+#else
+static __thread struct profile_thread *thread_data = NULL;
+static __thread long thread_generation = 0;
+#endif
+
+static inline bool names_equal(const char *name1, const char *name2)
+{
+	return name1 == name2 || strcmp(name1, name2) == 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* recording */
+
+/* the ring may already have been freed by profiler_free, so only mark it if
+ * it's still in the list.  the collector frees it once it's been drained */
+static void thread_exited(void *data)
+{
+	struct profile_thread *thread;
+
+	pthread_mutex_lock(&profiler.mutex);
+
+	for (thread = profiler.first_thread; thread; thread = thread->next) {
+		if (thread == data) {
+			thread->exited = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&profiler.mutex);
+}
+
+static struct profile_thread *get_thread(void)
+{
+	struct profile_thread *thread;
+	long cur_generation = os_atomic_load_long(&generation);
+
+	if (thread_data && thread_generation == cur_generation)
+		return thread_data;
+
+	thread = bzalloc(sizeof(struct profile_thread));
+
+	pthread_mutex_lock(&profiler.mutex);
+	thread->id            = profiler.next_thread_id++;
+	thread->next          = profiler.first_thread;
+	profiler.first_thread = thread;
+
+	if (!profiler.thread_key_created)
+		profiler.thread_key_created = pthread_key_create(
+				&profiler.thread_key, thread_exited) == 0;
+	if (profiler.thread_key_created)
+		pthread_setspecific(profiler.thread_key, thread);
+	pthread_mutex_unlock(&profiler.mutex);
+
+	thread_data       = thread;
+	thread_generation = cur_generation;
+	return thread;
+}
+
+static inline void push_entry(struct profile_thread *thread,
+		const struct profile_entry *entry)
+{
+	long write_pos = thread->write_pos;
+	long read_pos  = os_atomic_load_long(&thread->read_pos);
+
+	if ((unsigned long)(write_pos - read_pos) >= RING_SIZE) {
+		thread->dropped++;
+		return;
+	}
+
+	thread->entries[write_pos & (RING_SIZE - 1)] = *entry;
+	os_atomic_set_long(&thread->write_pos, write_pos + 1);
+}
+
+void profile_start(const char *name)
+{
+	struct profile_thread *thread;
+
+	if (!enabled)
+		return;
+
+	thread = get_thread();
+
+	if (thread->depth < MAX_NESTING) {
+		thread->stack[thread->depth].name  = name;
+		thread->stack[thread->depth].start = os_gettime_ns();
+	}
+
+	thread->depth++;
+}
+
+void profile_end(const char *name)
+{
+	struct profile_thread      *thread = thread_data;
+	struct profile_scope_start *scope;
+	struct profile_entry       entry;
+	int                        depth;
+
+	if (!thread || thread_generation != os_atomic_load_long(&generation))
+		return;
+
+	/* scope started before the profiler was */
+	if (!thread->depth)
+		return;
+
+	depth = --thread->depth;
+	if (depth >= MAX_NESTING)
+		return;
+
+	scope = thread->stack + depth;
+	if (!names_equal(scope->name, name)) {
+		blog(LOG_WARNING, "profile_end: expected '%s', got '%s'",
+				scope->name, name);
+		thread->depth = 0;
+		return;
+	}
+
+	if (!enabled)
+		return;
+
+	entry.name  = name;
+	entry.start = scope->start;
+	entry.end   = os_gettime_ns();
+	entry.depth = depth;
+	push_entry(thread, &entry);
+}
+
+void profile_record(const char *name, uint64_t time_ns)
+{
+	struct profile_thread *thread;
+	struct profile_entry  entry;
+
+	if (!enabled)
+		return;
+
+	thread = get_thread();
+
+	entry.end   = os_gettime_ns();
+	entry.start = entry.end - time_ns;
+	entry.name  = name;
+	entry.depth = thread->depth;
+	push_entry(thread, &entry);
+}
+
+/* ------------------------------------------------------------------------- */
+/* collection (always called with the profiler mutex locked) */
+
+static struct profile_scope *get_scope(const char *name, int depth)
+{
+	struct profile_scope *scope;
+
+	for (size_t i = 0; i < profiler.scopes.num; i++) {
+		scope = profiler.scopes.array+i;
+		if (names_equal(scope->name, name))
+			return scope;
+	}
+
+	scope = da_push_back_new(profiler.scopes);
+	scope->name    = name;
+	scope->depth   = depth;
+	scope->min_ns  = UINT64_MAX;
+	scope->samples = bmalloc(MAX_SAMPLES * sizeof(uint64_t));
+	return scope;
+}
+
+static void write_trace_entry(const struct profile_entry *entry, int tid)
+{
+	double ts  = (double)(entry->start - profiler.start_time) / 1000.0;
+	double dur = (double)(entry->end   - entry->start) / 1000.0;
+
+	fprintf(profiler.trace, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+			"\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			profiler.trace_first ? "" : ",",
+			entry->name, tid, ts, dur);
+
+	profiler.trace_first = false;
+}
+
+static void add_entry(const struct profile_entry *entry, int tid)
+{
+	struct profile_scope *scope = get_scope(entry->name, entry->depth);
+	uint64_t             time   = entry->end - entry->start;
+
+	scope->samples[scope->calls % MAX_SAMPLES] = time;
+	scope->total_ns += time;
+	scope->calls++;
+
+	if (time < scope->min_ns) scope->min_ns = time;
+	if (time > scope->max_ns) scope->max_ns = time;
+
+	if (profiler.trace)
+		write_trace_entry(entry, tid);
+}
+
+/* rings of threads that have exited are freed once they've been drained,
+ * so short-lived threads don't hold on to them until profiler_free */
+static void collect(void)
+{
+	struct profile_thread **prev_next = &profiler.first_thread;
+	struct profile_thread *thread;
+
+	while ((thread = *prev_next) != NULL) {
+		long write_pos = os_atomic_load_long(&thread->write_pos);
+		long read_pos  = thread->read_pos;
+
+		while (read_pos != write_pos) {
+			add_entry(thread->entries + (read_pos & (RING_SIZE-1)),
+					thread->id);
+			read_pos++;
+		}
+
+		os_atomic_set_long(&thread->read_pos, read_pos);
+
+		if (thread->exited) {
+			profiler.dropped += thread->dropped;
+			*prev_next = thread->next;
+			bfree(thread);
+		} else {
+			prev_next = &thread->next;
+		}
+	}
+}
+
+static void *collect_thread(void *param)
+{
+	while (os_event_timedwait(profiler.stop_event, COLLECT_INTERVAL_MS)
+			== ETIMEDOUT) {
+		pthread_mutex_lock(&profiler.mutex);
+		collect();
+		pthread_mutex_unlock(&profiler.mutex);
+	}
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+static void free_scopes(void)
+{
+	for (size_t i = 0; i < profiler.scopes.num; i++)
+		bfree(profiler.scopes.array[i].samples);
+	da_free(profiler.scopes);
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool profiler_start(const char *trace_path)
+{
+	bool success = false;
+
+	pthread_mutex_lock(&profiler.mutex);
+
+	if (enabled) {
+		blog(LOG_WARNING, "profiler_start: Profiler already started");
+		goto exit;
+	}
+
+	if (os_event_init(&profiler.stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto exit;
+
+	if (trace_path) {
+		profiler.trace = os_fopen(trace_path, "wb");
+		if (!profiler.trace)
+			blog(LOG_WARNING, "profiler_start: Failed to open "
+			                  "trace file '%s'", trace_path);
+		else
+			fputs("[", profiler.trace);
+		profiler.trace_first = true;
+	}
+
+	free_scopes();
+	profiler.start_time = os_gettime_ns();
+
+	if (pthread_create(&profiler.collect_thread, NULL, collect_thread,
+				NULL) != 0) {
+		blog(LOG_ERROR, "profiler_start: Failed to create thread");
+
+		if (profiler.trace) {
+			fclose(profiler.trace);
+			profiler.trace = NULL;
+		}
+
+		os_event_destroy(profiler.stop_event);
+		profiler.stop_event = NULL;
+		goto exit;
+	}
+
+	profiler.thread_initialized = true;
+	enabled = true;
+	success = true;
+
+exit:
+	pthread_mutex_unlock(&profiler.mutex);
+	return success;
+}
+
+void profiler_stop(void)
+{
+	struct profile_thread *thread;
+	long                  dropped;
+
+	if (!profiler.thread_initialized)
+		return;
+
+	enabled = false;
+
+	os_event_signal(profiler.stop_event);
+	pthread_join(profiler.collect_thread, NULL);
+	profiler.thread_initialized = false;
+
+	pthread_mutex_lock(&profiler.mutex);
+
+	collect();
+
+	dropped = profiler.dropped;
+	for (thread = profiler.first_thread; thread; thread = thread->next)
+		dropped += thread->dropped;
+	if (dropped)
+		blog(LOG_WARNING, "profiler: %ld scope(s) were dropped because "
+		                  "a thread's buffer was full", dropped);
+
+	if (profiler.trace) {
+		fputs("\n]\n", profiler.trace);
+		fclose(profiler.trace);
+		profiler.trace = NULL;
+	}
+
+	os_event_destroy(profiler.stop_event);
+	profiler.stop_event = NULL;
+
+	pthread_mutex_unlock(&profiler.mutex);
+}
+
+bool profiler_active(void)
+{
+	return enabled;
+}
+
+void profiler_free(void)
+{
+	struct profile_thread *thread;
+
+	profiler_stop();
+
+	pthread_mutex_lock(&profiler.mutex);
+
+	thread = profiler.first_thread;
+	while (thread) {
+		struct profile_thread *next = thread->next;
+		bfree(thread);
+		thread = next;
+	}
+
+	profiler.first_thread   = NULL;
+	profiler.next_thread_id = 0;
+	profiler.dropped        = 0;
+	os_atomic_inc_long(&generation);
+
+	free_scopes();
+
+	pthread_mutex_unlock(&profiler.mutex);
+}
+
+static int cmp_uint64(const void *val1, const void *val2)
+{
+	uint64_t v1 = *(const uint64_t*)val1;
+	uint64_t v2 = *(const uint64_t*)val2;
+	return (v1 > v2) - (v1 < v2);
+}
+
+static inline uint64_t percentile(const uint64_t *sorted, size_t num,
+		size_t percent)
+{
+	size_t idx = num * percent / 100;
+	return sorted[idx < num ? idx : num - 1];
+}
+
+static void get_stats(const struct profile_scope *scope,
+		struct profiler_stats *stats, uint64_t *sorted)
+{
+	size_t num = scope->calls < MAX_SAMPLES ?
+		(size_t)scope->calls : MAX_SAMPLES;
+
+	memcpy(sorted, scope->samples, num * sizeof(uint64_t));
+	qsort(sorted, num, sizeof(uint64_t), cmp_uint64);
+
+	stats->name      = scope->name;
+	stats->depth     = scope->depth;
+	stats->calls     = scope->calls;
+	stats->min_ns    = scope->min_ns;
+	stats->max_ns    = scope->max_ns;
+	stats->avg_ns    = scope->total_ns / scope->calls;
+	stats->median_ns = percentile(sorted, num, 50);
+	stats->p90_ns    = percentile(sorted, num, 90);
+	stats->p99_ns    = percentile(sorted, num, 99);
+}
+
+bool profiler_get_stats(const char *name, struct profiler_stats *stats)
+{
+	uint64_t *sorted = bmalloc(MAX_SAMPLES * sizeof(uint64_t));
+	bool     found   = false;
+
+	pthread_mutex_lock(&profiler.mutex);
+
+	collect();
+
+	for (size_t i = 0; i < profiler.scopes.num; i++) {
+		struct profile_scope *scope = profiler.scopes.array+i;
+
+		if (names_equal(scope->name, name)) {
+			get_stats(scope, stats, sorted);
+			found = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&profiler.mutex);
+
+	bfree(sorted);
+	return found;
+}
+
+void profiler_enum_stats(profiler_enum_proc_t callback, void *param)
+{
+	uint64_t *sorted = bmalloc(MAX_SAMPLES * sizeof(uint64_t));
+
+	pthread_mutex_lock(&profiler.mutex);
+
+	collect();
+
+	for (size_t i = 0; i < profiler.scopes.num; i++) {
+		struct profiler_stats stats;
+
+		get_stats(profiler.scopes.array+i, &stats, sorted);
+		if (!callback(param, &stats))
+			break;
+	}
+
+	pthread_mutex_unlock(&profiler.mutex);
+
+	bfree(sorted);
+}
+
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+static bool print_stats(void *param, const struct profiler_stats *stats)
+{
+	blog(LOG_INFO, "%*s%s: %"PRIu64" calls, "
+	               "min %.3f ms, avg %.3f ms, max %.3f ms, "
+	               "median %.3f ms, 90%% %.3f ms, 99%% %.3f ms",
+	               stats->depth * 2, "", stats->name, stats->calls,
+	               ns_to_ms(stats->min_ns), ns_to_ms(stats->avg_ns),
+	               ns_to_ms(stats->max_ns), ns_to_ms(stats->median_ns),
+	               ns_to_ms(stats->p90_ns), ns_to_ms(stats->p99_ns));
+
+	UNUSED_PARAMETER(param);
+	return true;
+}
+
+void profiler_print(void)
+{
+	if (!profiler.scopes.num && !enabled)
+		return;
+
+	blog(LOG_INFO, "== Profiler results ==================================");
+	profiler_enum_stats(print_stats, NULL);
+	blog(LOG_INFO, "======================================================");
+}
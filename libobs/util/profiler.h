@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ *   Lightweight scoped profiler.  Wrap the code to measure with
+ * profile_start/profile_end using the same name:
+ *
+ *   profile_start("render_video");
+ *   ...
+ *   profile_end("render_video");
+ *
+ *   Scopes can be nested.  Names are stored by pointer, so they must be
+ * static strings.  Each thread records into its own ring buffer without
+ * locking, and a collector thread periodically aggregates the timings per
+ * scope name.  When the profiler isn't running, profile_start/profile_end
+ * return immediately.
+ *
+ *   libobs starts the profiler in obs_startup when the OBS_PROFILER
+ * environment variable is set, and logs the results in obs_shutdown.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct profiler_stats {
+	const char *name;
+	int        depth;   /**< Nesting depth the scope was first seen at */
+	uint64_t   calls;
+	uint64_t   min_ns;
+	uint64_t   max_ns;
+	uint64_t   avg_ns;
+
+	/* percentiles of the most recent calls */
+	uint64_t   median_ns;
+	uint64_t   p90_ns;
+	uint64_t   p99_ns;
+};
+
+typedef bool (*profiler_enum_proc_t)(void *param,
+		const struct profiler_stats *stats);
+
+/**
+ * Starts profiling.
+ *
+ * @param  trace_path  If not NULL, also writes every recorded scope to this
+ *                     file as Chrome trace event JSON (chrome://tracing)
+ */
+EXPORT bool profiler_start(const char *trace_path);
+
+/** Stops profiling.  Collected statistics remain available until freed. */
+EXPORT void profiler_stop(void);
+
+/** Returns whether the profiler is currently running */
+EXPORT bool profiler_active(void);
+
+/**
+ * Frees all profiler data.  Must not be called while profiled threads may
+ * still be running.
+ */
+EXPORT void profiler_free(void);
+
+EXPORT void profile_start(const char *name);
+EXPORT void profile_end(const char *name);
+
+/**
+ * Records a scope that was timed some other way (for example on the GPU), as
+ * if it had just ended after taking time_ns.
+ */
+EXPORT void profile_record(const char *name, uint64_t time_ns);
+
+/** Gets the statistics of a specific scope, returns false if not found */
+EXPORT bool profiler_get_stats(const char *name, struct profiler_stats *stats);
+
+/** Enumerates the statistics of all scopes in the order they were first seen */
+EXPORT void profiler_enum_stats(profiler_enum_proc_t callback, void *param);
+
+/** Logs a summary of all scope statistics */
+EXPORT void profiler_print(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -248,3 +248,14 @@ long os_atomic_dec_long(volatile long *val)
 {
 	return __sync_sub_and_fetch(val, 1);
 }
+
+long os_atomic_set_long(volatile long *ptr, long val)
+{
+	__sync_synchronize();
+	return __sync_lock_test_and_set(ptr, val);
+}
+
+long os_atomic_load_long(const volatile long *ptr)
+{
+	return __sync_add_and_fetch((volatile long*)ptr, 0);
+}
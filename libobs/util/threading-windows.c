@@ -160,3 +160,13 @@ long os_atomic_dec_long(volatile long *val)
 {
 	return InterlockedDecrement(val);
 }
+
+long os_atomic_set_long(volatile long *ptr, long val)
+{
+	return InterlockedExchange(ptr, val);
+}
+
+long os_atomic_load_long(const volatile long *ptr)
+{
+	return InterlockedCompareExchange((volatile long*)ptr, 0, 0);
+}
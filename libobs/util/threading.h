@@ -72,6 +72,8 @@ EXPORT int  os_sem_wait(os_sem_t sem);
 
 EXPORT long os_atomic_inc_long(volatile long *val);
 EXPORT long os_atomic_dec_long(volatile long *val);
+EXPORT long os_atomic_set_long(volatile long *ptr, long val);
+EXPORT long os_atomic_load_long(const volatile long *ptr);
 
 
 #ifdef __cplusplus
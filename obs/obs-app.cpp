@@ -235,6 +235,8 @@ int main(int argc, char *argv[])
 	signal(SIGPIPE, SIG_IGN);
 #endif
 
+	InitPlatformThreads();
+
 	int ret = -1;
 	QCoreApplication::addLibraryPath(".");
 #ifdef _WIN32
@@ -77,3 +77,7 @@ bool InitApplicationBundle()
 #endif
 }
 
+void InitPlatformThreads()
+{
+}
+
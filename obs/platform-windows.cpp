@@ -67,3 +67,7 @@ bool InitApplicationBundle()
 {
 	return true;
 }
+
+void InitPlatformThreads()
+{
+}
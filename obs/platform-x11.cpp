@@ -101,3 +101,8 @@ bool InitApplicationBundle()
 {
 	return true;
 }
+
+void InitPlatformThreads()
+{
+	XInitThreads();
+}
@@ -39,3 +39,8 @@ void GetMonitors(std::vector<MonitorInfo> &monitors);
 /* Updates the working directory for OSX application bundles */
 bool InitApplicationBundle();
 
+/* Makes the window system connection safe to use from several threads (the
+ * display thread presents outside of the graphics context), call before
+ * anything else */
+void InitPlatformThreads();
+
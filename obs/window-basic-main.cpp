@@ -61,7 +61,7 @@ OBSBasic::OBSBasic(QWidget *parent)
 	ui->setupUi(this);
 
 	connect(windowHandle(), &QWindow::screenChanged, [this]() {
-		struct obs_video_info ovi;
+		struct obs_video_info ovi = {};
 
 		if (obs_get_video_info(&ovi))
 			ResizePreview(ovi.base_width, ovi.base_height);
@@ -363,6 +363,8 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_uint  (basicConfig, "Video", "FPSInt", 30);
 	config_set_default_uint  (basicConfig, "Video", "FPSNum", 30);
 	config_set_default_uint  (basicConfig, "Video", "FPSDen", 1);
+	config_set_default_string(basicConfig, "Video", "ScaleType",
+			"bicubic");
 
 	config_set_default_uint  (basicConfig, "Audio", "SampleRate", 44100);
 	config_set_default_string(basicConfig, "Audio", "ChannelSetup",
@@ -708,7 +710,7 @@ void OBSBasic::ChannelChanged(void *data, calldata_t params)
 void OBSBasic::RenderMain(void *data, uint32_t cx, uint32_t cy)
 {
 	OBSBasic *window = static_cast<OBSBasic*>(data);
-	obs_video_info ovi;
+	obs_video_info ovi = {};
 	int newCX, newCY;
 
 	obs_get_video_info(&ovi);
@@ -749,9 +751,24 @@ void OBSBasic::SetService(obs_service_t newService)
 	}
 }
 
+static inline enum obs_scale_type GetScaleType(config_t config)
+{
+	const char *scaleTypeStr = config_get_string(config,
+			"Video", "ScaleType");
+
+	if (!scaleTypeStr)
+		return OBS_SCALE_BICUBIC;
+	else if (strcmp(scaleTypeStr, "bilinear") == 0)
+		return OBS_SCALE_BILINEAR;
+	else if (strcmp(scaleTypeStr, "lanczos") == 0)
+		return OBS_SCALE_LANCZOS;
+	else
+		return OBS_SCALE_BICUBIC;
+}
+
 bool OBSBasic::ResetVideo()
 {
-	struct obs_video_info ovi;
+	struct obs_video_info ovi = {};
 
 	GetConfigFPS(ovi.fps_num, ovi.fps_den);
 
@@ -767,6 +784,7 @@ bool OBSBasic::ResetVideo()
 	ovi.output_format  = VIDEO_FORMAT_NV12;
 	ovi.adapter        = 0;
 	ovi.gpu_conversion = true;
+	ovi.scale_type     = GetScaleType(basicConfig);
 
 	QTToGSWindow(ui->preview->winId(), ovi.window);
 
@@ -886,7 +904,7 @@ void OBSBasic::changeEvent(QEvent *event)
 
 void OBSBasic::resizeEvent(QResizeEvent *event)
 {
-	struct obs_video_info ovi;
+	struct obs_video_info ovi = {};
 
 	if (obs_get_video_info(&ovi))
 		ResizePreview(ovi.base_width, ovi.base_height);
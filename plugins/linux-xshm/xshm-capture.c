@@ -0,0 +1,716 @@
+/*
+Copyright (C) 2014 by Leonhard Oelke <leonhard@in-verted.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <pthread.h>
+#include <sys/shm.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xdamage.h>
+
+#include <util/bmem.h>
+#include <util/darray.h>
+
+#include "xcursor.h"
+#include "xshm-capture.h"
+
+/* above this many damaged rectangles their bounding box is fetched instead */
+#define XSHM_MAX_DAMAGE_RECTS 16
+
+/* a distinct region of a screen, its texture is shared by all views of it */
+struct xshm_region {
+	int_fast32_t x, y;
+	uint32_t width, height;
+	texture_t texture;
+	uint64_t upload_count;
+	long refs;
+};
+
+struct xshm_shm {
+	int attached;
+	XShmSegmentInfo info;
+};
+
+struct xshm_screen {
+	int_fast32_t num;
+	Window root_window;
+	Visual *visual;
+	int depth;
+	uint32_t width, height;
+
+	struct xshm_shm shm;
+
+	/* header over the shared memory for the bounding box of the regions */
+	XImage *image;
+	int_fast32_t box_x, box_y;
+	bool box_dirty;
+
+	/* damaged rectangles that don't span the box are fetched to here */
+	struct xshm_shm scratch;
+	Damage damage;
+	XserverRegion damage_region;
+	DARRAY(XRectangle) damage_rects;
+
+	/* frames prepared, and grabs that changed the image */
+	uint64_t frame_count;
+	uint64_t grab_count;
+	uint64_t cursor_count;
+	DARRAY(struct xshm_region*) regions;
+	long refs;
+};
+
+struct xshm_view {
+	struct xshm_screen *screen;
+	struct xshm_region *region;
+	uint64_t seen;
+};
+
+/* global data */
+static pthread_mutex_t xshm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Display *xshm_dpy = NULL;
+static bool xshm_has_damage = false;
+static xcursor_t *xshm_cursor = NULL;
+static DARRAY(struct xshm_screen*) xshm_screens;
+
+/*
+ * Destroy the image header without freeing the shared memory it points to
+ */
+static void xshm_image_destroy(XImage *image)
+{
+	if (!image)
+		return;
+
+	image->data = NULL;
+	XDestroyImage(image);
+}
+
+static void xshm_shm_free(struct xshm_shm *shm)
+{
+	if (shm->attached)
+		XShmDetach(xshm_dpy, &shm->info);
+
+	if (shm->info.shmaddr != (char *) -1)
+		shmdt(shm->info.shmaddr);
+
+	if (shm->info.shmid != -1)
+		shmctl(shm->info.shmid, IPC_RMID, NULL);
+}
+
+/*
+ * Create a shared memory segment sized for the whole screen, so the bounding
+ * box can change without reallocating it
+ */
+static bool xshm_shm_init(struct xshm_shm *shm, struct xshm_screen *screen)
+{
+	XImage *image;
+
+	shm->info.shmid = -1;
+	shm->info.shmaddr = (char *) -1;
+
+	image = XShmCreateImage(xshm_dpy, screen->visual, screen->depth,
+		ZPixmap, NULL, &shm->info, screen->width, screen->height);
+	if (!image)
+		return false;
+
+	shm->info.shmid = shmget(IPC_PRIVATE,
+		image->bytes_per_line * image->height, IPC_CREAT | 0700);
+	xshm_image_destroy(image);
+	if (shm->info.shmid < 0)
+		return false;
+
+	shm->info.shmaddr = (char *) shmat(shm->info.shmid, 0, 0);
+	if (shm->info.shmaddr == (char *) -1)
+		return false;
+	shm->info.readOnly = False;
+
+	if (!XShmAttach(xshm_dpy, &shm->info))
+		return false;
+	shm->attached = 1;
+
+	return true;
+}
+
+static void xshm_screen_free(struct xshm_screen *screen)
+{
+	xshm_image_destroy(screen->image);
+
+	if (screen->damage)
+		XDamageDestroy(xshm_dpy, screen->damage);
+	if (screen->damage_region)
+		XFixesDestroyRegion(xshm_dpy, screen->damage_region);
+
+	xshm_shm_free(&screen->shm);
+	xshm_shm_free(&screen->scratch);
+
+	da_free(screen->damage_rects);
+	da_free(screen->regions);
+	bfree(screen);
+}
+
+static struct xshm_screen *xshm_screen_create(int_fast32_t num)
+{
+	struct xshm_screen *screen = bzalloc(sizeof(struct xshm_screen));
+	Screen *xscreen = XScreenOfDisplay(xshm_dpy, num);
+
+	screen->num = num;
+	screen->root_window = XRootWindowOfScreen(xscreen);
+	screen->visual = DefaultVisualOfScreen(xscreen);
+	screen->depth = DefaultDepthOfScreen(xscreen);
+	screen->width = WidthOfScreen(xscreen);
+	screen->height = HeightOfScreen(xscreen);
+	screen->scratch.info.shmid = -1;
+	screen->scratch.info.shmaddr = (char *) -1;
+	screen->box_dirty = true;
+
+	if (!xshm_shm_init(&screen->shm, screen))
+		goto fail;
+
+	if (xshm_has_damage) {
+		if (!xshm_shm_init(&screen->scratch, screen))
+			goto fail;
+
+		screen->damage = XDamageCreate(xshm_dpy, screen->root_window,
+			XDamageReportNonEmpty);
+		screen->damage_region = XFixesCreateRegion(xshm_dpy, NULL, 0);
+	}
+
+	return screen;
+
+fail:
+	blog(LOG_ERROR, "xshm: failed to set up capture of screen %d",
+		(int) num);
+	xshm_screen_free(screen);
+	return NULL;
+}
+
+static struct xshm_screen *xshm_screen_get(int_fast32_t num)
+{
+	struct xshm_screen *screen;
+
+	for (size_t i = 0; i < xshm_screens.num; ++i) {
+		screen = xshm_screens.array[i];
+		if (screen->num == num) {
+			screen->refs++;
+			return screen;
+		}
+	}
+
+	screen = xshm_screen_create(num);
+	if (!screen)
+		return NULL;
+
+	screen->refs = 1;
+	da_push_back(xshm_screens, &screen);
+	return screen;
+}
+
+static void xshm_screen_release(struct xshm_screen *screen)
+{
+	if (--screen->refs)
+		return;
+
+	da_erase_item(xshm_screens, &screen);
+	xshm_screen_free(screen);
+}
+
+static struct xshm_region *xshm_region_get(struct xshm_screen *screen,
+	int_fast32_t x, int_fast32_t y, uint32_t width, uint32_t height)
+{
+	struct xshm_region *region;
+
+	for (size_t i = 0; i < screen->regions.num; ++i) {
+		region = screen->regions.array[i];
+		if (region->x == x && region->y == y &&
+		    region->width == width && region->height == height) {
+			region->refs++;
+			return region;
+		}
+	}
+
+	region = bzalloc(sizeof(struct xshm_region));
+	region->x = x;
+	region->y = y;
+	region->width = width;
+	region->height = height;
+	region->refs = 1;
+
+	da_push_back(screen->regions, &region);
+	screen->box_dirty = true;
+	return region;
+}
+
+static void xshm_region_release(struct xshm_screen *screen,
+	struct xshm_region *region)
+{
+	if (--region->refs)
+		return;
+
+	da_erase_item(screen->regions, &region);
+	screen->box_dirty = true;
+
+	gs_texture_pool_release(region->texture);
+	bfree(region);
+}
+
+/*
+ * Recreate the image header for the bounding box of all regions, only this
+ * part of the screen is fetched from the server
+ */
+static bool xshm_screen_update_box(struct xshm_screen *screen)
+{
+	int_fast32_t x1 = (int_fast32_t) screen->width;
+	int_fast32_t y1 = (int_fast32_t) screen->height;
+	int_fast32_t x2 = 0, y2 = 0;
+
+	for (size_t i = 0; i < screen->regions.num; ++i) {
+		struct xshm_region *region = screen->regions.array[i];
+
+		if (region->x < x1) x1 = region->x;
+		if (region->y < y1) y1 = region->y;
+		if (region->x + (int_fast32_t) region->width > x2)
+			x2 = region->x + region->width;
+		if (region->y + (int_fast32_t) region->height > y2)
+			y2 = region->y + region->height;
+	}
+
+	xshm_image_destroy(screen->image);
+	screen->image = NULL;
+	screen->box_dirty = false;
+
+	if (x2 <= x1 || y2 <= y1)
+		return false;
+
+	screen->box_x = x1;
+	screen->box_y = y1;
+	screen->image = XShmCreateImage(xshm_dpy, screen->visual,
+		screen->depth, ZPixmap, screen->shm.info.shmaddr,
+		&screen->shm.info, x2 - x1, y2 - y1);
+
+	return screen->image != NULL;
+}
+
+static inline uint8_t *xshm_image_pixel(XImage *image, int_fast32_t x,
+	int_fast32_t y)
+{
+	return (uint8_t *) image->data + y * image->bytes_per_line + x * 4;
+}
+
+/*
+ * Clip a rectangle to the bounding box and make it relative to it, returns
+ * false if nothing is left
+ */
+static bool xshm_clip_to_box(struct xshm_screen *screen, XRectangle *rect)
+{
+	int_fast32_t x1 = rect->x - screen->box_x;
+	int_fast32_t y1 = rect->y - screen->box_y;
+	int_fast32_t x2 = x1 + rect->width;
+	int_fast32_t y2 = y1 + rect->height;
+
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 > screen->image->width)  x2 = screen->image->width;
+	if (y2 > screen->image->height) y2 = screen->image->height;
+
+	if (x2 <= x1 || y2 <= y1)
+		return false;
+
+	rect->x = x1;
+	rect->y = y1;
+	rect->width = x2 - x1;
+	rect->height = y2 - y1;
+	return true;
+}
+
+/*
+ * Fetch a rectangle of the box into the image. Rows spanning the whole box
+ * are contiguous in the image and fetched in place, anything narrower goes
+ * through the scratch segment since the server can't write with a stride.
+ */
+static void xshm_fetch_rect(struct xshm_screen *screen, XRectangle *rect)
+{
+	XImage *image = screen->image;
+	bool in_place = rect->width == image->width;
+	struct xshm_shm *shm = in_place ? &screen->shm : &screen->scratch;
+	char *data = in_place
+		? (char *) xshm_image_pixel(image, 0, rect->y)
+		: shm->info.shmaddr;
+	XImage *part;
+
+	part = XShmCreateImage(xshm_dpy, screen->visual, screen->depth,
+		ZPixmap, data, &shm->info, rect->width, rect->height);
+	if (!part)
+		return;
+
+	XShmGetImage(xshm_dpy, screen->root_window, part,
+		screen->box_x + rect->x, screen->box_y + rect->y, AllPlanes);
+
+	if (!in_place) {
+		for (int_fast32_t y = 0; y < rect->height; ++y)
+			memcpy(xshm_image_pixel(image, rect->x, rect->y + y),
+				part->data + y * part->bytes_per_line,
+				rect->width * 4);
+	}
+
+	xshm_image_destroy(part);
+}
+
+/*
+ * Take the damage accumulated since the last grab, returns false if nothing
+ * changed
+ */
+static bool xshm_fetch_damage(struct xshm_screen *screen)
+{
+	XRectangle *rects;
+	XRectangle bounds;
+	XEvent event;
+	int count = 0;
+
+	XDamageSubtract(xshm_dpy, screen->damage, None,
+		screen->damage_region);
+	rects = XFixesFetchRegion(xshm_dpy, screen->damage_region, &count);
+
+	/* the notify events aren't needed, the region has everything */
+	while (XPending(xshm_dpy))
+		XNextEvent(xshm_dpy, &event);
+
+	da_resize(screen->damage_rects, 0);
+
+	if (count > XSHM_MAX_DAMAGE_RECTS) {
+		int_fast32_t x1 = rects[0].x, y1 = rects[0].y;
+		int_fast32_t x2 = x1 + rects[0].width;
+		int_fast32_t y2 = y1 + rects[0].height;
+
+		for (int i = 1; i < count; ++i) {
+			if (rects[i].x < x1) x1 = rects[i].x;
+			if (rects[i].y < y1) y1 = rects[i].y;
+			if (rects[i].x + rects[i].width > x2)
+				x2 = rects[i].x + rects[i].width;
+			if (rects[i].y + rects[i].height > y2)
+				y2 = rects[i].y + rects[i].height;
+		}
+
+		bounds.x = x1;
+		bounds.y = y1;
+		bounds.width = x2 - x1;
+		bounds.height = y2 - y1;
+		if (xshm_clip_to_box(screen, &bounds))
+			da_push_back(screen->damage_rects, &bounds);
+	} else {
+		for (int i = 0; i < count; ++i) {
+			if (xshm_clip_to_box(screen, rects + i))
+				da_push_back(screen->damage_rects, rects + i);
+		}
+	}
+
+	if (rects)
+		XFree(rects);
+
+	return screen->damage_rects.num != 0;
+}
+
+static void xshm_screen_grab(struct xshm_screen *screen)
+{
+	bool full = !xshm_has_damage;
+
+	if (screen->box_dirty) {
+		xshm_screen_update_box(screen);
+		full = true;
+	}
+
+	if (!screen->image)
+		return;
+
+	/* with damage tracking only the changed parts are fetched, and a
+	 * frame where nothing changed doesn't fetch or upload anything */
+	if (xshm_has_damage && !xshm_fetch_damage(screen) && !full)
+		return;
+
+	if (full) {
+		XRectangle box = {0, 0, screen->image->width,
+			screen->image->height};
+
+		XShmGetImage(xshm_dpy, screen->root_window, screen->image,
+			screen->box_x, screen->box_y, AllPlanes);
+
+		da_resize(screen->damage_rects, 0);
+		da_push_back(screen->damage_rects, &box);
+	} else {
+		for (size_t i = 0; i < screen->damage_rects.num; ++i)
+			xshm_fetch_rect(screen, screen->damage_rects.array + i);
+	}
+
+	screen->grab_count++;
+}
+
+/*
+ * Upload the damaged parts of a region, the whole region is uploaded if its
+ * texture is new, it missed a grab, or partial updates aren't supported
+ */
+static void xshm_region_upload(struct xshm_screen *screen,
+	struct xshm_region *region)
+{
+	XImage *image = screen->image;
+	int_fast32_t rx = region->x - screen->box_x;
+	int_fast32_t ry = region->y - screen->box_y;
+	bool full;
+
+	if (!image || region->upload_count == screen->grab_count)
+		return;
+
+	full = !region->texture ||
+		region->upload_count + 1 != screen->grab_count;
+
+	if (!region->texture)
+		region->texture = gs_texture_pool_acquire(region->width,
+			region->height, GS_BGRA, GS_DYNAMIC);
+	if (!region->texture)
+		return;
+
+	for (size_t i = 0; !full && i < screen->damage_rects.num; ++i) {
+		XRectangle *rect = screen->damage_rects.array + i;
+		int_fast32_t x1 = rect->x, y1 = rect->y;
+		int_fast32_t x2 = x1 + rect->width;
+		int_fast32_t y2 = y1 + rect->height;
+
+		if (x1 < rx) x1 = rx;
+		if (y1 < ry) y1 = ry;
+		if (x2 > rx + (int_fast32_t) region->width)
+			x2 = rx + region->width;
+		if (y2 > ry + (int_fast32_t) region->height)
+			y2 = ry + region->height;
+
+		if (x2 <= x1 || y2 <= y1)
+			continue;
+
+		full = !texture_setimage_rect(region->texture,
+			x1 - rx, y1 - ry, x2 - x1, y2 - y1,
+			xshm_image_pixel(image, x1, y1),
+			image->bytes_per_line);
+	}
+
+	if (full)
+		texture_setimage(region->texture,
+			xshm_image_pixel(image, rx, ry),
+			image->bytes_per_line, False);
+
+	region->upload_count = screen->grab_count;
+}
+
+int_fast32_t xshm_screen_count(void)
+{
+	int_fast32_t count = 0;
+
+	pthread_mutex_lock(&xshm_mutex);
+
+	if (xshm_dpy) {
+		count = XScreenCount(xshm_dpy);
+	} else {
+		Display *dpy = XOpenDisplay(NULL);
+		if (dpy) {
+			count = XScreenCount(dpy);
+			XCloseDisplay(dpy);
+		}
+	}
+
+	pthread_mutex_unlock(&xshm_mutex);
+	return count;
+}
+
+bool xshm_screen_size(int_fast32_t screen, uint32_t *width, uint32_t *height)
+{
+	Display *dpy;
+	bool success = false;
+
+	pthread_mutex_lock(&xshm_mutex);
+
+	dpy = xshm_dpy ? xshm_dpy : XOpenDisplay(NULL);
+	if (dpy && screen >= 0 && screen < XScreenCount(dpy)) {
+		Screen *xscreen = XScreenOfDisplay(dpy, screen);
+		*width = WidthOfScreen(xscreen);
+		*height = HeightOfScreen(xscreen);
+		success = true;
+	}
+
+	if (dpy && dpy != xshm_dpy)
+		XCloseDisplay(dpy);
+
+	pthread_mutex_unlock(&xshm_mutex);
+	return success;
+}
+
+static bool xshm_query_damage(void)
+{
+	int event_base, error_base;
+
+	return XFixesQueryExtension(xshm_dpy, &event_base, &error_base) &&
+	       XDamageQueryExtension(xshm_dpy, &event_base, &error_base);
+}
+
+static void xshm_close_display(void)
+{
+	if (xshm_screens.num)
+		return;
+
+	if (xshm_cursor) {
+		xcursor_destroy(xshm_cursor);
+		xshm_cursor = NULL;
+	}
+
+	da_free(xshm_screens);
+	XCloseDisplay(xshm_dpy);
+	xshm_dpy = NULL;
+}
+
+xshm_view_t *xshm_view_create(int_fast32_t screen_num, int_fast32_t x,
+	int_fast32_t y, uint32_t width, uint32_t height)
+{
+	struct xshm_view *view = NULL;
+	struct xshm_screen *screen;
+
+	pthread_mutex_lock(&xshm_mutex);
+
+	if (!xshm_dpy) {
+		xshm_dpy = XOpenDisplay(NULL);
+		if (!xshm_dpy)
+			goto exit;
+
+		if (!XShmQueryExtension(xshm_dpy)) {
+			blog(LOG_ERROR, "xshm: MIT-SHM extension not available");
+			xshm_close_display();
+			goto exit;
+		}
+
+		xshm_has_damage = xshm_query_damage();
+		if (!xshm_has_damage)
+			blog(LOG_INFO, "xshm: XDamage not available, "
+				"grabbing every frame");
+	}
+
+	if (screen_num < 0 || screen_num >= XScreenCount(xshm_dpy))
+		screen_num = XDefaultScreen(xshm_dpy);
+
+	screen = xshm_screen_get(screen_num);
+	if (!screen) {
+		xshm_close_display();
+		goto exit;
+	}
+
+	/* clamp the region to the screen */
+	if (x < 0 || x >= (int_fast32_t) screen->width)
+		x = 0;
+	if (y < 0 || y >= (int_fast32_t) screen->height)
+		y = 0;
+	if (!width || x + width > screen->width)
+		width = screen->width - x;
+	if (!height || y + height > screen->height)
+		height = screen->height - y;
+
+	view = bzalloc(sizeof(struct xshm_view));
+	view->screen = screen;
+	view->region = xshm_region_get(screen, x, y, width, height);
+	view->seen = screen->frame_count;
+
+exit:
+	pthread_mutex_unlock(&xshm_mutex);
+	return view;
+}
+
+void xshm_view_destroy(xshm_view_t *view)
+{
+	if (!view)
+		return;
+
+	pthread_mutex_lock(&xshm_mutex);
+
+	xshm_region_release(view->screen, view->region);
+	xshm_screen_release(view->screen);
+	xshm_close_display();
+
+	pthread_mutex_unlock(&xshm_mutex);
+
+	bfree(view);
+}
+
+void xshm_view_prepare(xshm_view_t *view)
+{
+	struct xshm_screen *screen = view->screen;
+
+	pthread_mutex_lock(&xshm_mutex);
+
+	/* the first view to come back for a new frame grabs it for all */
+	if (view->seen == screen->frame_count) {
+		xshm_screen_grab(screen);
+		screen->frame_count++;
+	}
+	view->seen = screen->frame_count;
+
+	pthread_mutex_unlock(&xshm_mutex);
+}
+
+void xshm_view_tick(xshm_view_t *view)
+{
+	struct xshm_screen *screen = view->screen;
+
+	pthread_mutex_lock(&xshm_mutex);
+
+	xshm_region_upload(screen, view->region);
+
+	/* the cursor moves on its own, so it follows frames, not damage */
+	if (!xshm_cursor) {
+		xshm_cursor = xcursor_init(xshm_dpy);
+		screen->cursor_count = screen->frame_count;
+	} else if (screen->cursor_count != screen->frame_count) {
+		xcursor_tick(xshm_cursor);
+		screen->cursor_count = screen->frame_count;
+	}
+
+	pthread_mutex_unlock(&xshm_mutex);
+}
+
+void xshm_view_render(xshm_view_t *view, effect_t effect, bool show_cursor)
+{
+	struct xshm_region *region = view->region;
+	eparam_t image;
+
+	if (!region->texture)
+		return;
+
+	image = effect_getparambyname(effect, "image");
+	effect_settexture(effect, image, region->texture);
+
+	gs_enable_blending(False);
+	gs_draw_sprite(region->texture, 0, 0, 0);
+
+	if (show_cursor && xshm_cursor) {
+		/* move the cursor into the region */
+		gs_matrix_push();
+		gs_matrix_translate3f((float) region->x, (float) region->y,
+			0.0f);
+		xcursor_render(xshm_cursor);
+		gs_matrix_pop();
+	}
+}
+
+uint32_t xshm_view_width(xshm_view_t *view)
+{
+	return view->region->width;
+}
+
+uint32_t xshm_view_height(xshm_view_t *view)
+{
+	return view->region->height;
+}
@@ -0,0 +1,89 @@
+/*
+Copyright (C) 2014 by Leonhard Oelke <leonhard@in-verted.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <obs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared screen capture
+ *
+ * All views share a single X connection and a single shared memory image per
+ * screen. Each screen is grabbed once per frame, covering only the bounding
+ * box of the regions its views show, and views of the same region share one
+ * texture.
+ */
+typedef struct xshm_view xshm_view_t;
+
+/**
+ * Get the number of screens of the default display
+ */
+int_fast32_t xshm_screen_count(void);
+
+/**
+ * Get the size of a screen, returns false if it is not available
+ */
+bool xshm_screen_size(int_fast32_t screen, uint32_t *width, uint32_t *height);
+
+/**
+ * Create a view of a region of a screen
+ *
+ * A width or height of zero extends the region to the edge of the screen.
+ *
+ * This needs to be executed within a valid render context
+ */
+xshm_view_t *xshm_view_create(int_fast32_t screen, int_fast32_t x,
+	int_fast32_t y, uint32_t width, uint32_t height);
+
+/**
+ * Destroy a view, the screen is released with the last view on it
+ *
+ * This needs to be executed within a valid render context
+ */
+void xshm_view_destroy(xshm_view_t *view);
+
+/**
+ * Grab the screen of the view, unless another view already did this frame
+ *
+ * Safe to call from the parallel tick workers
+ */
+void xshm_view_prepare(xshm_view_t *view);
+
+/**
+ * Upload the region of the view, unless it was already uploaded this frame
+ *
+ * This needs to be executed within a valid render context
+ */
+void xshm_view_tick(xshm_view_t *view);
+
+/**
+ * Draw the view, optionally with the cursor
+ *
+ * This needs to be executed within a valid render context
+ */
+void xshm_view_render(xshm_view_t *view, effect_t effect, bool show_cursor);
+
+uint32_t xshm_view_width(xshm_view_t *view);
+uint32_t xshm_view_height(xshm_view_t *view);
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,25 +17,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdlib.h>
 #include <stdio.h>
 
-#include <sys/shm.h>
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
-#include <X11/extensions/XShm.h>
-
 #include <obs.h>
-#include "xcursor.h"
+#include "xshm-capture.h"
 
 #define XSHM_DATA(voidptr) struct xshm_data *data = voidptr;
 
 struct xshm_data {
-	Display *dpy;
-	Window root_window;
-	uint32_t width, height;
-	int shm_attached;
-	XShmSegmentInfo shm_info;
-	XImage *image;
-	texture_t texture;
-	xcursor_t *cursor;
+	xshm_view_t *view;
+	bool show_cursor;
 };
 
 static const char* xshm_getname(const char* locale)
@@ -44,99 +33,90 @@ static const char* xshm_getname(const char* locale)
 	return "X11 Shared Memory Screen Input";
 }
 
-static void xshm_destroy(void *vptr)
+/*
+ * Replace the view with one of the region selected in the settings, the
+ * crop is applied when grabbing so only the visible part is fetched
+ */
+static void xshm_update(void *vptr, obs_data_t settings)
 {
 	XSHM_DATA(vptr);
 
-	if (!data)
-		return;
+	int_fast32_t screen = obs_data_getint(settings, "screen");
+	int_fast32_t left   = obs_data_getint(settings, "cut_left");
+	int_fast32_t top    = obs_data_getint(settings, "cut_top");
+	int_fast32_t right  = obs_data_getint(settings, "cut_right");
+	int_fast32_t bottom = obs_data_getint(settings, "cut_bottom");
+	uint32_t width = 0, height = 0;
+
+	data->show_cursor = obs_data_getbool(settings, "show_cursor");
+
+	if (xshm_screen_size(screen, &width, &height)) {
+		width  = (left + right  < (int_fast32_t) width)
+			? width  - left - right  : 0;
+		height = (top  + bottom < (int_fast32_t) height)
+			? height - top  - bottom : 0;
+	}
 
 	gs_entercontext(obs_graphics());
 
-	texture_destroy(data->texture);
-	xcursor_destroy(data->cursor);
+	xshm_view_destroy(data->view);
+	data->view = xshm_view_create(screen, left, top, width, height);
 
 	gs_leavecontext();
 
-	if (data->shm_attached)
-		XShmDetach(data->dpy, &data->shm_info);
+	if (!data->view)
+		blog(LOG_ERROR, "xshm: unable to capture screen %d",
+			(int) screen);
+}
 
-	if (data->shm_info.shmaddr != (char *) -1) {
-		shmdt(data->shm_info.shmaddr);
-		data->shm_info.shmaddr = (char *) -1;
-	}
+static void xshm_defaults(obs_data_t settings)
+{
+	obs_data_set_default_int(settings, "screen", 0);
+	obs_data_set_default_int(settings, "cut_left", 0);
+	obs_data_set_default_int(settings, "cut_top", 0);
+	obs_data_set_default_int(settings, "cut_right", 0);
+	obs_data_set_default_int(settings, "cut_bottom", 0);
+	obs_data_set_default_bool(settings, "show_cursor", true);
+}
 
-	if (data->shm_info.shmid != -1)
-		shmctl(data->shm_info.shmid, IPC_RMID, NULL);
+static obs_properties_t xshm_properties(const char *locale)
+{
+	obs_properties_t props = obs_properties_create(locale);
+	int_fast32_t screens = xshm_screen_count();
+
+	obs_properties_add_int(props, "screen", "Screen", 0,
+		screens > 0 ? (int) screens - 1 : 0, 1);
+	obs_properties_add_int(props, "cut_left", "Crop Left", 0, 4096, 1);
+	obs_properties_add_int(props, "cut_top", "Crop Top", 0, 4096, 1);
+	obs_properties_add_int(props, "cut_right", "Crop Right", 0, 4096, 1);
+	obs_properties_add_int(props, "cut_bottom", "Crop Bottom", 0, 4096, 1);
+	obs_properties_add_bool(props, "show_cursor", "Capture Cursor");
+
+	return props;
+}
 
-	if (data->image)
-		XDestroyImage(data->image);
+static void xshm_destroy(void *vptr)
+{
+	XSHM_DATA(vptr);
 
-	if (data->dpy)
-		XCloseDisplay(data->dpy);
+	if (!data)
+		return;
+
+	gs_entercontext(obs_graphics());
+	xshm_view_destroy(data->view);
+	gs_leavecontext();
 
 	bfree(data);
 }
 
 static void *xshm_create(obs_data_t settings, obs_source_t source)
 {
-	UNUSED_PARAMETER(settings);
 	UNUSED_PARAMETER(source);
 
+	struct xshm_data *data = bzalloc(sizeof(struct xshm_data));
 
-	struct xshm_data *data = bmalloc(sizeof(struct xshm_data));
-	memset(data, 0, sizeof(struct xshm_data));
-
-	data->dpy = XOpenDisplay(NULL);
-	if (!data->dpy)
-		goto fail;
-
-	Screen *screen = XDefaultScreenOfDisplay(data->dpy);
-	data->width = WidthOfScreen(screen);
-	data->height = HeightOfScreen(screen);
-	data->root_window = XRootWindowOfScreen(screen);
-	Visual *visual = DefaultVisualOfScreen(screen);
-	int depth = DefaultDepthOfScreen(screen);
-
-	if (!XShmQueryExtension(data->dpy))
-		goto fail;
-
-	data->image = XShmCreateImage(data->dpy, visual, depth,
-		ZPixmap, NULL, &data->shm_info, data->width, data->height);
-	if (!data->image)
-		goto fail;
-
-	data->shm_info.shmid = shmget(IPC_PRIVATE,
-		data->image->bytes_per_line * data->image->height,
-		IPC_CREAT | 0700);
-	if (data->shm_info.shmid < 0)
-		goto fail;
-
-	data->shm_info.shmaddr
-		= data->image->data
-		= (char *) shmat(data->shm_info.shmid, 0, 0);
-	if (data->shm_info.shmaddr == (char *) -1)
-		goto fail;
-	data->shm_info.readOnly = False;
-
-
-	if (!XShmAttach(data->dpy, &data->shm_info))
-		goto fail;
-	data->shm_attached = 1;
-
-	if (!XShmGetImage(data->dpy, data->root_window, data->image,
-		0, 0, AllPlanes)) {
-		goto fail;
-	}
-
-
-	gs_entercontext(obs_graphics());
-	data->texture = gs_create_texture(data->width, data->height,
-		GS_BGRA, 1, (const void**) &data->image->data, GS_DYNAMIC);
-	data->cursor = xcursor_init(data->dpy);
-	gs_leavecontext();
-
-	if (!data->texture)
+	xshm_update(data, settings);
+	if (!data->view)
 		goto fail;
 
 	return data;
@@ -146,21 +126,25 @@ fail:
 	return NULL;
 }
 
-static void xshm_video_tick(void *vptr, float seconds)
+static void xshm_video_tick_prepare(void *vptr, float seconds)
 {
 	UNUSED_PARAMETER(seconds);
 	XSHM_DATA(vptr);
 
-	gs_entercontext(obs_graphics());
-
+	if (data->view)
+		xshm_view_prepare(data->view);
+}
 
-	XShmGetImage(data->dpy, data->root_window, data->image,
-		0, 0, AllPlanes);
-	texture_setimage(data->texture, (void *) data->image->data,
-		data->width * 4, False);
+static void xshm_video_tick(void *vptr, float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+	XSHM_DATA(vptr);
 
-	xcursor_tick(data->cursor);
+	if (!data->view)
+		return;
 
+	gs_entercontext(obs_graphics());
+	xshm_view_tick(data->view);
 	gs_leavecontext();
 }
 
@@ -168,38 +152,36 @@ static void xshm_video_render(void *vptr, effect_t effect)
 {
 	XSHM_DATA(vptr);
 
-	eparam_t image = effect_getparambyname(effect, "image");
-	effect_settexture(effect, image, data->texture);
-
-	gs_enable_blending(False);
-
-	gs_draw_sprite(data->texture, 0, 0, 0);
-
-	xcursor_render(data->cursor);
+	if (data->view)
+		xshm_view_render(data->view, effect, data->show_cursor);
 }
 
 static uint32_t xshm_getwidth(void *vptr)
 {
 	XSHM_DATA(vptr);
 
-	return texture_getwidth(data->texture);
+	return data->view ? xshm_view_width(data->view) : 0;
 }
 
 static uint32_t xshm_getheight(void *vptr)
 {
 	XSHM_DATA(vptr);
 
-	return texture_getheight(data->texture);
+	return data->view ? xshm_view_height(data->view) : 0;
 }
 
 struct obs_source_info xshm_input = {
     .id           = "xshm_input",
     .type         = OBS_SOURCE_TYPE_INPUT,
-    .output_flags = OBS_SOURCE_VIDEO,
+    .output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_OPAQUE,
     .getname      = xshm_getname,
     .create       = xshm_create,
     .destroy      = xshm_destroy,
+    .defaults     = xshm_defaults,
+    .properties   = xshm_properties,
+    .update       = xshm_update,
     .video_tick   = xshm_video_tick,
+    .video_tick_prepare = xshm_video_tick_prepare,
     .video_render = xshm_video_render,
     .getwidth     = xshm_getwidth,
     .getheight    = xshm_getheight
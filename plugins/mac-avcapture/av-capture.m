@@ -449,7 +449,7 @@ static void av_capture_update(void *data, obs_data_t settings)
 struct obs_source_info av_capture_info = {
 	.id           = "av_capture_input",
 	.type         = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_ASYNC_VIDEO,
+	.output_flags = OBS_SOURCE_ASYNC_VIDEO | OBS_SOURCE_CACHEABLE,
 	.getname      = av_capture_getname,
 	.create       = av_capture_create,
 	.destroy      = av_capture_destroy,
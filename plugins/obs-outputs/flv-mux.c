@@ -25,7 +25,6 @@
  * use anything else for a long time. */
 
 //#define DEBUG_TIMESTAMPS
-//#define WRITE_FLV_HEADER
 
 #define VIDEO_HEADER_SIZE 5
 #define MILLISECOND_DEN   1000
@@ -83,7 +82,8 @@ static void build_flv_meta_data(obs_output_t context,
 	*output = bmemdup(buf, *size);
 }
 
-void flv_meta_data(obs_output_t context, uint8_t **output, size_t *size)
+void flv_meta_data(obs_output_t context, uint8_t **output, size_t *size,
+		bool write_header)
 {
 	struct array_output_data data;
 	struct serializer s;
@@ -95,13 +95,13 @@ void flv_meta_data(obs_output_t context, uint8_t **output, size_t *size)
 
 	build_flv_meta_data(context, &meta_data, &meta_data_size);
 
-#ifdef WRITE_FLV_HEADER
-	s_write(&s, "FLV", 3);
-	s_w8(&s, 1);
-	s_w8(&s, 5);
-	s_wb32(&s, 9);
-	s_wb32(&s, 0);
-#endif
+	if (write_header) {
+		s_write(&s, "FLV", 3);
+		s_w8(&s, 1);
+		s_w8(&s, 5);
+		s_wb32(&s, 9);
+		s_wb32(&s, 0);
+	}
 
 	start_pos = serializer_get_pos(&s);
 
@@ -113,7 +113,7 @@ void flv_meta_data(obs_output_t context, uint8_t **output, size_t *size)
 
 	s_write(&s, meta_data, meta_data_size);
 
-	s_wb32(&s, (uint32_t)serializer_get_pos(&s) - start_pos + 4 - 1);
+	s_wb32(&s, (uint32_t)serializer_get_pos(&s) - start_pos);
 
 	*output = data.bytes.array;
 	*size   = data.bytes.num;
@@ -128,89 +128,103 @@ static uint32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 
 #ifdef DEBUG_TIMESTAMPS
 static int32_t last_time = 0;
-#endif
 
-static void flv_video(struct serializer *s, struct encoder_packet *packet,
-		bool is_header)
+static void debug_timestamp(const char *type, int32_t time_ms)
 {
-	int64_t offset  = packet->pts - packet->dts;
-	int32_t time_ms = get_ms_time(packet, packet->dts);
-
-	if (!packet->data || !packet->size)
-		return;
-
-	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
-
-#ifdef DEBUG_TIMESTAMPS
-	blog(LOG_DEBUG, "Video: %lu", time_ms);
+	blog(LOG_DEBUG, "%s: %d", type, time_ms);
 
 	if (last_time > time_ms)
 		blog(LOG_DEBUG, "Non-monotonic");
 
 	last_time = time_ms;
+}
 #endif
 
-	s_wb24(s, (uint32_t)packet->size + 5);
-	s_wb24(s, time_ms);
-	s_w8(s, (time_ms >> 24) & 0x7F);
-	s_wb24(s, 0);
+static inline uint8_t *put_be24(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)(val >> 16);
+	*(p++) = (uint8_t)(val >> 8);
+	*(p++) = (uint8_t)val;
+	return p;
+}
 
-	/* these are the 5 extra bytes mentioned above */
-	s_w8(s, packet->keyframe ? 0x17 : 0x27);
-	s_w8(s, is_header ? 0 : 1);
-	s_wb24(s, get_ms_time(packet, offset));
-	s_write(s, packet->data, packet->size);
+static inline void put_be32(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)(val >> 24);
+	*(p++) = (uint8_t)(val >> 16);
+	*(p++) = (uint8_t)(val >> 8);
+	*(p++) = (uint8_t)val;
+}
 
-	/* write tag size (starting byte doesnt count) */
-	s_wb32(s, (uint32_t)serializer_get_pos(s) + 4 - 1);
+static uint8_t *flv_tag_header(uint8_t *p, uint8_t type, uint32_t size,
+		int32_t time_ms)
+{
+	*(p++) = type;
+	p = put_be24(p, size);
+	p = put_be24(p, (uint32_t)time_ms);
+	*(p++) = (uint8_t)((time_ms >> 24) & 0x7F);
+	return put_be24(p, 0);
 }
 
-static void flv_audio(struct serializer *s, struct encoder_packet *packet,
+static void flv_video(struct flv_tag *tag, struct encoder_packet *packet,
 		bool is_header)
 {
+	int64_t offset  = packet->pts - packet->dts;
 	int32_t time_ms = get_ms_time(packet, packet->dts);
+	uint8_t *p      = tag->header;
 
-	if (!packet->data || !packet->size)
-		return;
+#ifdef DEBUG_TIMESTAMPS
+	debug_timestamp("Video", time_ms);
+#endif
 
-	s_w8(s, RTMP_PACKET_TYPE_AUDIO);
+	p = flv_tag_header(p, RTMP_PACKET_TYPE_VIDEO,
+			(uint32_t)packet->size + 5, time_ms);
 
-#ifdef DEBUG_TIMESTAMPS
-	blog(LOG_DEBUG, "Audio: %lu", time_ms);
+	/* these are the 5 extra bytes mentioned above */
+	*(p++) = packet->keyframe ? 0x17 : 0x27;
+	*(p++) = is_header ? 0 : 1;
+	p = put_be24(p, get_ms_time(packet, offset));
 
-	if (last_time > time_ms)
-		blog(LOG_DEBUG, "Non-monotonic");
+	tag->header_size = p - tag->header;
+}
 
-	last_time = time_ms;
+static void flv_audio(struct flv_tag *tag, struct encoder_packet *packet,
+		bool is_header)
+{
+	int32_t time_ms = get_ms_time(packet, packet->dts);
+	uint8_t *p      = tag->header;
+
+#ifdef DEBUG_TIMESTAMPS
+	debug_timestamp("Audio", time_ms);
 #endif
 
-	s_wb24(s, (uint32_t)packet->size + 2);
-	s_wb24(s, time_ms);
-	s_w8(s, (time_ms >> 24) & 0x7F);
-	s_wb24(s, 0);
+	p = flv_tag_header(p, RTMP_PACKET_TYPE_AUDIO,
+			(uint32_t)packet->size + 2, time_ms);
 
 	/* these are the two extra bytes mentioned above */
-	s_w8(s, 0xaf);
-	s_w8(s, is_header ? 0 : 1);
-	s_write(s, packet->data, packet->size);
+	*(p++) = 0xaf;
+	*(p++) = is_header ? 0 : 1;
 
-	/* write tag size (starting byte doesnt count) */
-	s_wb32(s, (uint32_t)serializer_get_pos(s) + 4 - 1);
+	tag->header_size = p - tag->header;
 }
 
-void flv_packet_mux(struct encoder_packet *packet,
-		uint8_t **output, size_t *size, bool is_header)
+bool flv_packet_tag(struct flv_tag *tag, struct encoder_packet *packet,
+		bool is_header)
 {
-	struct array_output_data data;
-	struct serializer s;
+	tag->header_size = 0;
+	tag->data        = packet->data;
+	tag->size        = packet->size;
 
-	array_output_serializer_init(&s, &data);
+	if (!packet->data || !packet->size)
+		return false;
 
 	if (packet->type == OBS_ENCODER_VIDEO)
-		flv_video(&s, packet, is_header);
+		flv_video(tag, packet, is_header);
 	else
-		flv_audio(&s, packet, is_header);
+		flv_audio(tag, packet, is_header);
 
-	*output = data.bytes.array;
-	*size   = data.bytes.num;
+	/* footer: FLV "previous tag size", the size of the header and data
+	 * written before it */
+	put_be32(tag->footer, (uint32_t)(tag->header_size + tag->size));
+	return true;
 }
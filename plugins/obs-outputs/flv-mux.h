@@ -19,6 +19,23 @@
 
 #include <obs.h>
 
-extern void flv_meta_data(obs_output_t context, uint8_t **output, size_t *size);
-extern void flv_packet_mux(struct encoder_packet *packet,
-		uint8_t **output, size_t *size, bool is_header);
+/* 11 byte FLV tag header + up to 5 bytes of codec specific header */
+#define FLV_TAG_HEADER_MAX 16
+
+/*
+ * A muxed FLV tag without any copy of the packet data.  Write out the header,
+ * then the (referenced) packet data, then the footer (previous tag size).
+ */
+struct flv_tag {
+	uint8_t       header[FLV_TAG_HEADER_MAX];
+	size_t        header_size;
+	const uint8_t *data;
+	size_t        size;
+	uint8_t       footer[4];
+};
+
+extern bool flv_packet_tag(struct flv_tag *tag, struct encoder_packet *packet,
+		bool is_header);
+
+extern void flv_meta_data(obs_output_t context, uint8_t **output, size_t *size,
+		bool write_header);
@@ -0,0 +1,561 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* O_DIRECT */
+#endif
+
+#include <obs.h>
+#include <obs-avc.h>
+#include <util/platform.h>
+#include <util/circlebuf.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "flv-mux.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/* writes are always done in multiples of the alignment (apart from the very
+ * last one), which is what O_DIRECT requires */
+#define WRITE_BUFFER_SIZE (4 * 1024 * 1024)
+#define WRITE_ALIGNMENT   4096
+
+struct flv_output {
+	obs_output_t     output;
+	struct dstr      path;
+
+	pthread_mutex_t  packets_mutex;
+	struct circlebuf packets;
+	bool             write_failed;
+
+	bool             active;
+	pthread_t        write_thread;
+
+	os_sem_t         write_sem;
+	os_event_t       stop_event;
+
+	int              fd;
+	bool             direct_io;
+	uint64_t         sync_interval_ns;
+	uint64_t         last_sync_ns;
+	uint64_t         total_bytes;
+
+	uint8_t          *buffer_mem;
+	uint8_t          *buffer;
+	size_t           buffer_size;
+};
+
+static const char *flv_output_getname(const char *locale)
+{
+	/* TODO: locale stuff */
+	UNUSED_PARAMETER(locale);
+	return "FLV File Output";
+}
+
+/* ------------------------------------------------------------------------- */
+/* file helpers */
+
+#ifdef _WIN32
+static int open_file(const char *path, bool direct_io)
+{
+	wchar_t *wpath;
+	int     fd;
+
+	os_utf8_to_wcs_ptr(path, 0, &wpath);
+	fd = _wopen(wpath, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+			_S_IREAD | _S_IWRITE);
+	bfree(wpath);
+
+	UNUSED_PARAMETER(direct_io);
+	return fd;
+}
+
+static inline int write_file(int fd, const uint8_t *data, size_t size)
+{
+	return _write(fd, data, (unsigned int)size);
+}
+
+#define sync_file  _commit
+#define close_file _close
+
+#else
+static int open_file(const char *path, bool direct_io)
+{
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+#ifdef O_DIRECT
+	if (direct_io) {
+		int fd = open(path, flags | O_DIRECT, 0644);
+		if (fd != -1)
+			return fd;
+
+		blog(LOG_WARNING, "Could not open '%s' for direct I/O, "
+				"falling back to buffered I/O", path);
+	}
+#else
+	UNUSED_PARAMETER(direct_io);
+#endif
+
+	return open(path, flags, 0644);
+}
+
+static inline int write_file(int fd, const uint8_t *data, size_t size)
+{
+	return (int)write(fd, data, size);
+}
+
+#define sync_file  fsync
+#define close_file close
+#endif
+
+static void disable_direct_io(struct flv_output *out)
+{
+#if !defined(_WIN32) && defined(O_DIRECT)
+	int flags = fcntl(out->fd, F_GETFL);
+	if (flags != -1)
+		fcntl(out->fd, F_SETFL, flags & ~O_DIRECT);
+#endif
+	out->direct_io = false;
+}
+
+static bool write_data(struct flv_output *out, const uint8_t *data,
+		size_t size)
+{
+	while (size) {
+		int ret = write_file(out->fd, data, size);
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			blog(LOG_WARNING, "Error writing to '%s': %d",
+					out->path.array, errno);
+			return false;
+		}
+
+		data             += ret;
+		size             -= ret;
+		out->total_bytes += ret;
+	}
+
+	return true;
+}
+
+/* writes out all aligned data in the buffer.  if this is the final write, the
+ * unaligned remainder is written as well */
+static bool flush_buffer(struct flv_output *out, bool final)
+{
+	size_t size = out->buffer_size;
+
+	if (!final)
+		size -= size % WRITE_ALIGNMENT;
+	else if (out->direct_io && size % WRITE_ALIGNMENT)
+		disable_direct_io(out);
+
+	if (!size)
+		return true;
+	if (!write_data(out, out->buffer, size))
+		return false;
+
+	out->buffer_size -= size;
+	if (out->buffer_size)
+		memmove(out->buffer, out->buffer + size, out->buffer_size);
+
+	return true;
+}
+
+static bool buffer_write(struct flv_output *out, const uint8_t *data,
+		size_t size)
+{
+	while (size) {
+		size_t space = WRITE_BUFFER_SIZE - out->buffer_size;
+		size_t copy  = size < space ? size : space;
+
+		memcpy(out->buffer + out->buffer_size, data, copy);
+		out->buffer_size += copy;
+		data             += copy;
+		size             -= copy;
+
+		if (out->buffer_size == WRITE_BUFFER_SIZE &&
+		    !flush_buffer(out, false))
+			return false;
+	}
+
+	return true;
+}
+
+static bool check_sync(struct flv_output *out)
+{
+	uint64_t ts;
+
+	if (!out->sync_interval_ns)
+		return true;
+
+	ts = os_gettime_ns();
+	if (ts - out->last_sync_ns < out->sync_interval_ns)
+		return true;
+
+	out->last_sync_ns = ts;
+
+	if (!flush_buffer(out, false))
+		return false;
+
+	sync_file(out->fd);
+	return true;
+}
+
+static void close_output_file(struct flv_output *out)
+{
+	if (out->fd != -1) {
+		close_file(out->fd);
+		out->fd = -1;
+	}
+
+	out->buffer_size = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* the packet callback can still be pushing packets at this point (data
+ * capture is only stopped after the write thread signals the failure) */
+static inline void free_packets(struct flv_output *out)
+{
+	pthread_mutex_lock(&out->packets_mutex);
+	while (out->packets.size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&out->packets, &packet, sizeof(packet));
+		obs_free_encoder_packet(&packet);
+	}
+	pthread_mutex_unlock(&out->packets_mutex);
+}
+
+static void flv_output_stop(void *data);
+
+static void flv_output_destroy(void *data)
+{
+	struct flv_output *out = data;
+
+	if (out) {
+		if (out->active)
+			flv_output_stop(data);
+
+		free_packets(out);
+		close_output_file(out);
+		dstr_free(&out->path);
+		os_event_destroy(out->stop_event);
+		os_sem_destroy(out->write_sem);
+		pthread_mutex_destroy(&out->packets_mutex);
+		circlebuf_free(&out->packets);
+		bfree(out->buffer_mem);
+		bfree(out);
+	}
+}
+
+static void *flv_output_create(obs_data_t settings, obs_output_t output)
+{
+	struct flv_output *out = bzalloc(sizeof(struct flv_output));
+	out->output = output;
+	out->fd     = -1;
+	pthread_mutex_init_value(&out->packets_mutex);
+
+	if (pthread_mutex_init(&out->packets_mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&out->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	out->buffer_mem = bmalloc(WRITE_BUFFER_SIZE + WRITE_ALIGNMENT);
+	out->buffer     = (uint8_t*)(((uintptr_t)out->buffer_mem +
+				WRITE_ALIGNMENT - 1) &
+			~(uintptr_t)(WRITE_ALIGNMENT - 1));
+
+	UNUSED_PARAMETER(settings);
+	return out;
+
+fail:
+	flv_output_destroy(out);
+	return NULL;
+}
+
+static void flv_output_stop(void *data)
+{
+	struct flv_output *out = data;
+	void *ret;
+
+	if (out->active) {
+		obs_output_end_data_capture(out->output);
+		os_event_signal(out->stop_event);
+		os_sem_post(out->write_sem);
+		pthread_join(out->write_thread, &ret);
+	}
+
+	os_event_reset(out->stop_event);
+}
+
+static inline bool get_next_packet(struct flv_output *out,
+		struct encoder_packet *packet)
+{
+	bool new_packet = false;
+
+	pthread_mutex_lock(&out->packets_mutex);
+	if (out->packets.size) {
+		circlebuf_pop_front(&out->packets, packet,
+				sizeof(struct encoder_packet));
+		new_packet = true;
+	}
+	pthread_mutex_unlock(&out->packets_mutex);
+
+	return new_packet;
+}
+
+static bool write_packet(struct flv_output *out,
+		struct encoder_packet *packet, bool is_header)
+{
+	struct flv_tag tag;
+	bool           success = true;
+
+	if (flv_packet_tag(&tag, packet, is_header))
+		success = buffer_write(out, tag.header, tag.header_size) &&
+		          buffer_write(out, tag.data, tag.size) &&
+		          buffer_write(out, tag.footer, sizeof(tag.footer));
+
+	obs_free_encoder_packet(packet);
+	return success;
+}
+
+static bool write_available_packets(struct flv_output *out)
+{
+	struct encoder_packet packet;
+
+	while (get_next_packet(out, &packet))
+		if (!write_packet(out, &packet, false))
+			return false;
+
+	return check_sync(out);
+}
+
+static void *write_thread(void *data)
+{
+	struct flv_output *out = data;
+	bool error = false;
+
+	while (os_sem_wait(out->write_sem) == 0) {
+		if (os_event_try(out->stop_event) != EAGAIN)
+			break;
+		if (!write_available_packets(out)) {
+			error = true;
+			break;
+		}
+	}
+
+	if (!error && !write_available_packets(out))
+		error = true;
+	if (!error && !flush_buffer(out, true))
+		error = true;
+
+	if (error) {
+		/* nothing is written from here on, so discard any packets
+		 * that still come in instead of queueing them */
+		pthread_mutex_lock(&out->packets_mutex);
+		out->write_failed = true;
+		pthread_mutex_unlock(&out->packets_mutex);
+
+		free_packets(out);
+	}
+
+	blog(LOG_INFO, "FLV output: wrote %"PRIu64" bytes to '%s'",
+			out->total_bytes, out->path.array);
+	close_output_file(out);
+
+	if (os_event_try(out->stop_event) == EAGAIN) {
+		pthread_detach(out->write_thread);
+		obs_output_signal_stop(out->output, OBS_OUTPUT_FAIL);
+	}
+
+	out->active = false;
+	return NULL;
+}
+
+static bool write_meta_data(struct flv_output *out)
+{
+	uint8_t *meta_data;
+	size_t  meta_data_size;
+	bool    success;
+
+	flv_meta_data(out->output, &meta_data, &meta_data_size, true);
+	success = buffer_write(out, meta_data, meta_data_size);
+	bfree(meta_data);
+
+	return success;
+}
+
+static bool write_audio_header(struct flv_output *out)
+{
+	obs_encoder_t aencoder = obs_output_get_audio_encoder(out->output);
+	uint8_t       *header;
+
+	struct encoder_packet packet   = {
+		.type         = OBS_ENCODER_AUDIO,
+		.timebase_den = 1
+	};
+
+	obs_encoder_get_extra_data(aencoder, &header, &packet.size);
+	packet.data = bmemdup(header, packet.size);
+	return write_packet(out, &packet, true);
+}
+
+static bool write_video_header(struct flv_output *out)
+{
+	obs_encoder_t vencoder = obs_output_get_video_encoder(out->output);
+	uint8_t       *header;
+	size_t        size;
+
+	struct encoder_packet packet   = {
+		.type         = OBS_ENCODER_VIDEO,
+		.timebase_den = 1,
+		.keyframe     = true
+	};
+
+	obs_encoder_get_extra_data(vencoder, &header, &size);
+	packet.size = obs_parse_avc_header(&packet.data, header, size);
+	return write_packet(out, &packet, true);
+}
+
+static inline bool write_headers(struct flv_output *out)
+{
+	return write_meta_data(out) &&
+	       write_audio_header(out) &&
+	       write_video_header(out);
+}
+
+static inline bool reset_semaphore(struct flv_output *out)
+{
+	os_sem_destroy(out->write_sem);
+	return os_sem_init(&out->write_sem, 0) == 0;
+}
+
+static bool flv_output_start(void *data)
+{
+	struct flv_output *out = data;
+	obs_data_t settings;
+
+	if (!obs_output_can_begin_data_capture(out->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(out->output, 0))
+		return false;
+
+	settings = obs_output_get_settings(out->output);
+	dstr_copy(&out->path, obs_data_getstring(settings, "path"));
+	out->direct_io = obs_data_getbool(settings, "direct_io");
+	out->sync_interval_ns =
+		(uint64_t)obs_data_getint(settings, "sync_interval") *
+		1000000000ULL;
+	obs_data_release(settings);
+
+	if (dstr_isempty(&out->path)) {
+		blog(LOG_WARNING, "FLV output: no path specified");
+		return false;
+	}
+
+	out->fd = open_file(out->path.array, out->direct_io);
+	if (out->fd == -1) {
+		blog(LOG_WARNING, "FLV output: could not open '%s'",
+				out->path.array);
+		return false;
+	}
+
+	out->buffer_size  = 0;
+	out->total_bytes  = 0;
+	out->last_sync_ns = os_gettime_ns();
+	out->write_failed = false;
+
+	if (!write_headers(out) || !reset_semaphore(out))
+		goto fail;
+	if (pthread_create(&out->write_thread, NULL, write_thread, out) != 0)
+		goto fail;
+
+	out->active = true;
+	obs_output_begin_data_capture(out->output, 0);
+	return true;
+
+fail:
+	close_output_file(out);
+	return false;
+}
+
+static void flv_output_data(void *data, struct encoder_packet *packet)
+{
+	struct flv_output     *out = data;
+	struct encoder_packet new_packet;
+	bool                  write_failed;
+
+	if (packet->type == OBS_ENCODER_VIDEO)
+		obs_parse_avc_packet(&new_packet, packet);
+	else
+		obs_duplicate_encoder_packet(&new_packet, packet);
+
+	pthread_mutex_lock(&out->packets_mutex);
+	write_failed = out->write_failed;
+	if (!write_failed)
+		circlebuf_push_back(&out->packets, &new_packet,
+				sizeof(struct encoder_packet));
+	pthread_mutex_unlock(&out->packets_mutex);
+
+	if (write_failed)
+		obs_free_encoder_packet(&new_packet);
+	else
+		os_sem_post(out->write_sem);
+}
+
+static void flv_output_defaults(obs_data_t defaults)
+{
+	obs_data_set_default_bool(defaults, "direct_io", false);
+	obs_data_set_default_int(defaults, "sync_interval", 0);
+}
+
+static obs_properties_t flv_output_properties(const char *locale)
+{
+	obs_properties_t props = obs_properties_create(locale);
+
+	/* TODO: locale */
+	obs_properties_add_text(props, "path", "File Path", OBS_TEXT_DEFAULT);
+	obs_properties_add_bool(props, "direct_io",
+			"Bypass the system file cache (direct I/O)");
+	obs_properties_add_int(props, "sync_interval",
+			"Flush to disk interval (seconds, 0=never)", 0, 60, 1);
+	return props;
+}
+
+struct obs_output_info flv_output_info = {
+	.id             = "flv_output",
+	.flags          = OBS_OUTPUT_AV |
+	                  OBS_OUTPUT_ENCODED,
+	.getname        = flv_output_getname,
+	.create         = flv_output_create,
+	.destroy        = flv_output_destroy,
+	.start          = flv_output_start,
+	.stop           = flv_output_stop,
+	.encoded_packet = flv_output_data,
+	.defaults       = flv_output_defaults,
+	.properties     = flv_output_properties
+};
@@ -0,0 +1,362 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "librtmp/rtmp_sys.h"
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+#include "rtmp-chunk.h"
+#include "flv-mux.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#if defined(IOV_MAX) && IOV_MAX < 256
+#define MAX_IOV IOV_MAX
+#else
+#define MAX_IOV 256
+#endif
+
+/* media messages go on the same chunk stream RTMP_Write uses */
+#define MEDIA_CHANNEL     0x04
+#define FMT_FULL_HEADER   (0 << 6)
+#define FMT_CONTINUATION  (3 << 6)
+#define EXT_TIMESTAMP     0xFFFFFF
+#define FLV_HEADER_SIZE   11
+
+void rtmp_chunk_writer_init(struct rtmp_chunk_writer *writer,
+		size_t chunk_size, uint32_t stream_id)
+{
+	rtmp_chunk_writer_clear(writer);
+
+	writer->chunk_size   = chunk_size;
+	writer->stream_id    = stream_id;
+	writer->total_writes = 0;
+}
+
+void rtmp_chunk_writer_clear(struct rtmp_chunk_writer *writer)
+{
+	for (size_t i = 0; i < writer->packets.num; i++)
+		obs_free_encoder_packet(writer->packets.array+i);
+
+	da_resize(writer->packets,  0);
+	da_resize(writer->segments, 0);
+	da_resize(writer->arena,    0);
+	writer->size = 0;
+}
+
+void rtmp_chunk_writer_free(struct rtmp_chunk_writer *writer)
+{
+	rtmp_chunk_writer_clear(writer);
+
+	da_free(writer->packets);
+	da_free(writer->segments);
+	da_free(writer->arena);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* copies data in to the arena, merging it with the last segment if that one
+ * also ends at the end of the arena */
+static void push_copy(struct rtmp_chunk_writer *writer, const void *data,
+		size_t size)
+{
+	struct rtmp_chunk_segment *last = da_end(writer->segments);
+	size_t offset = writer->arena.num;
+
+	da_push_back_array(writer->arena, (const uint8_t*)data, size);
+	writer->size += size;
+
+	if (last && !last->data && last->offset + last->size == offset) {
+		last->size += size;
+	} else {
+		struct rtmp_chunk_segment seg = {NULL, offset, size};
+		da_push_back(writer->segments, &seg);
+	}
+}
+
+static void push_ref(struct rtmp_chunk_writer *writer, const uint8_t *data,
+		size_t size)
+{
+	struct rtmp_chunk_segment seg = {data, 0, size};
+	da_push_back(writer->segments, &seg);
+	writer->size += size;
+}
+
+static inline uint8_t *put_be24(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)(val >> 16);
+	*(p++) = (uint8_t)(val >> 8);
+	*(p++) = (uint8_t)val;
+	return p;
+}
+
+static inline uint8_t *put_be32(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)(val >> 24);
+	return put_be24(p, val);
+}
+
+static inline uint8_t *put_le32(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)val;
+	*(p++) = (uint8_t)(val >> 8);
+	*(p++) = (uint8_t)(val >> 16);
+	*(p++) = (uint8_t)(val >> 24);
+	return p;
+}
+
+static inline uint32_t get_be24(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+struct message {
+	uint32_t timestamp;
+	size_t   chunk_left;
+};
+
+/* continuation chunks repeat the extended timestamp, like librtmp does */
+static void push_continuation(struct rtmp_chunk_writer *writer,
+		struct message *msg)
+{
+	uint8_t header[5];
+	uint8_t *p = header;
+
+	*(p++) = FMT_CONTINUATION | MEDIA_CHANNEL;
+	if (msg->timestamp >= EXT_TIMESTAMP)
+		p = put_be32(p, msg->timestamp);
+
+	push_copy(writer, header, p - header);
+	msg->chunk_left = writer->chunk_size;
+}
+
+/* splits message body data over chunks.  copied data is small (codec
+ * headers), referenced data is the packet payload */
+static void push_body(struct rtmp_chunk_writer *writer, struct message *msg,
+		const uint8_t *data, size_t size, bool copy)
+{
+	while (size) {
+		size_t num;
+
+		if (!msg->chunk_left)
+			push_continuation(writer, msg);
+
+		num = size < msg->chunk_left ? size : msg->chunk_left;
+
+		if (copy)
+			push_copy(writer, data, num);
+		else
+			push_ref(writer, data, num);
+
+		msg->chunk_left -= num;
+		data            += num;
+		size            -= num;
+	}
+}
+
+static void push_message(struct rtmp_chunk_writer *writer, uint8_t type,
+		uint32_t timestamp, const uint8_t *prefix, size_t prefix_size,
+		const uint8_t *data, size_t size)
+{
+	struct message msg = {timestamp, writer->chunk_size};
+	uint8_t header[16];
+	uint8_t *p = header;
+
+	*(p++) = FMT_FULL_HEADER | MEDIA_CHANNEL;
+	p = put_be24(p, timestamp < EXT_TIMESTAMP ? timestamp : EXT_TIMESTAMP);
+	p = put_be24(p, (uint32_t)(prefix_size + size));
+	*(p++) = type;
+	p = put_le32(p, writer->stream_id);
+	if (timestamp >= EXT_TIMESTAMP)
+		p = put_be32(p, timestamp);
+
+	push_copy(writer, header, p - header);
+	push_body(writer, &msg, prefix, prefix_size, true);
+	push_body(writer, &msg, data, size, false);
+}
+
+bool rtmp_chunk_write_packet(struct rtmp_chunk_writer *writer,
+		struct encoder_packet *packet, bool is_header)
+{
+	struct flv_tag tag;
+	uint32_t       timestamp;
+
+	if (!flv_packet_tag(&tag, packet, is_header)) {
+		obs_free_encoder_packet(packet);
+		return false;
+	}
+
+	/* the RTMP message header carries the same type and timestamp as the
+	 * FLV tag header, and the message body is the FLV tag body */
+	timestamp = get_be24(tag.header + 4) | ((uint32_t)tag.header[7] << 24);
+
+	push_message(writer, tag.header[0], timestamp,
+			tag.header + FLV_HEADER_SIZE,
+			tag.header_size - FLV_HEADER_SIZE,
+			tag.data, tag.size);
+
+	/* keeps the payload alive until it's been sent */
+	da_push_back(writer->packets, packet);
+	return true;
+}
+
+/* AMF string "@setDataFrame", which RTMP_Write also puts in front of meta
+ * data */
+static const uint8_t set_data_frame[] = {
+	0x02, 0x00, 0x0d,
+	'@', 's', 'e', 't', 'D', 'a', 't', 'a', 'F', 'r', 'a', 'm', 'e'
+};
+
+bool rtmp_chunk_write_meta(struct rtmp_chunk_writer *writer,
+		uint8_t *tag, size_t size)
+{
+	struct encoder_packet owner = {0};
+	uint32_t body_size;
+
+	if (size < FLV_HEADER_SIZE) {
+		bfree(tag);
+		return false;
+	}
+
+	body_size = get_be24(tag + 1);
+	if (FLV_HEADER_SIZE + (size_t)body_size > size) {
+		bfree(tag);
+		return false;
+	}
+
+	push_message(writer, tag[0], 0,
+			set_data_frame, sizeof(set_data_frame),
+			tag + FLV_HEADER_SIZE, body_size);
+
+	owner.data = tag;
+	owner.size = size;
+	da_push_back(writer->packets, &owner);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+typedef WSABUF chunk_iovec;
+
+static inline void set_iovec(chunk_iovec *iov, const uint8_t *data,
+		size_t size)
+{
+	iov->buf = (CHAR*)data;
+	iov->len = (ULONG)size;
+}
+
+static int send_iovecs(SOCKET sock, chunk_iovec *iov, size_t count)
+{
+	DWORD sent = 0;
+	if (WSASend(sock, iov, (DWORD)count, &sent, 0, NULL, NULL) != 0)
+		return -1;
+	return (int)sent;
+}
+#else
+typedef struct iovec chunk_iovec;
+
+static inline void set_iovec(chunk_iovec *iov, const uint8_t *data,
+		size_t size)
+{
+	iov->iov_base = (void*)data;
+	iov->iov_len  = size;
+}
+
+static int send_iovecs(SOCKET sock, chunk_iovec *iov, size_t count)
+{
+	struct msghdr msg = {0};
+	msg.msg_iov    = iov;
+	msg.msg_iovlen = count;
+	return (int)sendmsg(sock, &msg, MSG_NOSIGNAL);
+}
+#endif
+
+static inline bool interrupted_send(void)
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEINTR;
+#else
+	return errno == EINTR;
+#endif
+}
+
+static inline const uint8_t *segment_data(struct rtmp_chunk_writer *writer,
+		const struct rtmp_chunk_segment *seg)
+{
+	return seg->data ? seg->data : writer->arena.array + seg->offset;
+}
+
+bool rtmp_chunk_flush(struct rtmp_chunk_writer *writer, SOCKET sock)
+{
+	chunk_iovec iov[MAX_IOV];
+	size_t      cur    = 0;
+	size_t      offset = 0;
+	bool        success = true;
+
+	while (cur < writer->segments.num) {
+		size_t count = 0;
+		int    ret;
+
+		for (size_t i = cur;
+		     i < writer->segments.num && count < MAX_IOV;
+		     i++, count++) {
+			struct rtmp_chunk_segment *seg =
+				writer->segments.array+i;
+			const uint8_t *data = segment_data(writer, seg);
+			size_t        size  = seg->size;
+
+			/* the first segment may have been partially sent */
+			if (i == cur) {
+				data += offset;
+				size -= offset;
+			}
+
+			set_iovec(iov+count, data, size);
+		}
+
+		ret = send_iovecs(sock, iov, count);
+		writer->total_writes++;
+
+		if (ret < 0 && interrupted_send())
+			continue;
+		if (ret <= 0) {
+			blog(LOG_WARNING, "RTMP send error %d",
+					GetSockError());
+			success = false;
+			break;
+		}
+
+		while (ret > 0) {
+			size_t left = writer->segments.array[cur].size - offset;
+
+			if ((size_t)ret >= left) {
+				ret   -= (int)left;
+				offset = 0;
+				cur++;
+			} else {
+				offset += ret;
+				ret     = 0;
+			}
+		}
+	}
+
+	rtmp_chunk_writer_clear(writer);
+	return success;
+}
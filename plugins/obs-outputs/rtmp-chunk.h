@@ -0,0 +1,77 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+#include <util/darray.h>
+#include "librtmp/rtmp.h"
+
+/*
+ * Writes packets to an RTMP connection as RTMP chunks on the media channel,
+ * instead of going through RTMP_Write (which allocates and copies every
+ * packet, then sends each chunk with its own send call).
+ *
+ * Chunk headers and FLV codec headers are generated in to a small arena, and
+ * packet payloads are only referenced.  Everything queued is sent with
+ * gathered writes (sendmsg/WSASend) on flush, and the queued packets are
+ * owned by the writer until then.
+ *
+ * Every message gets a full (type 0) chunk header so no header compression
+ * state has to be shared with librtmp.  This does not go through librtmp's
+ * socket layer, so it can't be used with TLS or HTTP tunneled connections.
+ */
+
+struct rtmp_chunk_segment {
+	/* NULL if the segment is in the header arena */
+	const uint8_t                     *data;
+	size_t                            offset;
+	size_t                            size;
+};
+
+struct rtmp_chunk_writer {
+	size_t                            chunk_size;
+	uint32_t                          stream_id;
+
+	DARRAY(uint8_t)                   arena;
+	DARRAY(struct rtmp_chunk_segment) segments;
+	DARRAY(struct encoder_packet)     packets;
+	size_t                            size;
+
+	uint64_t                          total_writes;
+};
+
+extern void rtmp_chunk_writer_init(struct rtmp_chunk_writer *writer,
+		size_t chunk_size, uint32_t stream_id);
+extern void rtmp_chunk_writer_free(struct rtmp_chunk_writer *writer);
+
+/** discards everything queued */
+extern void rtmp_chunk_writer_clear(struct rtmp_chunk_writer *writer);
+
+/** queues an encoder packet as an FLV audio/video message, takes ownership */
+extern bool rtmp_chunk_write_packet(struct rtmp_chunk_writer *writer,
+		struct encoder_packet *packet, bool is_header);
+
+/**
+ * queues FLV meta data (a full FLV tag as written by flv_meta_data) as an
+ * @setDataFrame message, takes ownership of the buffer
+ */
+extern bool rtmp_chunk_write_meta(struct rtmp_chunk_writer *writer,
+		uint8_t *tag, size_t size);
+
+/** sends everything queued, returns false on socket error */
+extern bool rtmp_chunk_flush(struct rtmp_chunk_writer *writer, SOCKET sock);
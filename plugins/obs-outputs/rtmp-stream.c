@@ -19,21 +19,23 @@
 #include <obs-avc.h>
 #include <util/platform.h>
 #include <util/circlebuf.h>
+#include <util/darray.h>
 #include <util/dstr.h>
 #include <util/threading.h>
 #include <inttypes.h>
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
 #include "flv-mux.h"
+#include "rtmp-chunk.h"
+#include "send-queue.h"
 
-//#define FILE_TEST
 //#define TEST_FRAMEDROPS
 
 struct rtmp_stream {
 	obs_output_t     output;
 
 	pthread_mutex_t  packets_mutex;
-	struct circlebuf packets;
+	struct send_queue queue;
 
 	bool             connecting;
 	pthread_t        connect_thread;
@@ -47,16 +49,14 @@ struct rtmp_stream {
 	struct dstr      path, key;
 	struct dstr      username, password;
 
-	/* frame drop variables */
-	int64_t          drop_threshold_usec;
-	int64_t          min_drop_dts_usec;
-	int              min_priority;
+	/* send thread write batching */
+	struct rtmp_chunk_writer writer;
+	uint64_t         total_packets;
 
-	int64_t          last_dts_usec;
-
-#ifdef FILE_TEST
-	FILE             *test;
-#endif
+	/* the connection goes through librtmp's HTTP layer, so everything is
+	 * sent with RTMP_Write instead of the chunk writer */
+	bool             tunneled;
+	uint64_t         tunneled_writes;
 
 	RTMP             rtmp;
 };
@@ -78,11 +78,9 @@ static void log_rtmp(int level, const char *format, va_list args)
 
 static inline void free_packets(struct rtmp_stream *stream)
 {
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-		obs_free_encoder_packet(&packet);
-	}
+	pthread_mutex_lock(&stream->packets_mutex);
+	send_queue_clear(&stream->queue);
+	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
 static void rtmp_stream_stop(void *data);
@@ -103,7 +101,8 @@ static void rtmp_stream_destroy(void *data)
 		os_event_destroy(stream->stop_event);
 		os_sem_destroy(stream->send_sem);
 		pthread_mutex_destroy(&stream->packets_mutex);
-		circlebuf_free(&stream->packets);
+		send_queue_free(&stream->queue);
+		rtmp_chunk_writer_free(&stream->writer);
 		bfree(stream);
 	}
 }
@@ -136,10 +135,6 @@ static void rtmp_stream_stop(void *data)
 	struct rtmp_stream *stream = data;
 	void *ret;
 
-#ifdef FILE_TEST
-	fclose(stream->test);
-#endif
-
 	os_event_signal(stream->stop_event);
 
 	if (stream->connecting)
@@ -175,59 +170,160 @@ static inline bool get_next_packet(struct rtmp_stream *stream,
 	bool new_packet = false;
 
 	pthread_mutex_lock(&stream->packets_mutex);
-	if (stream->packets.size) {
-		circlebuf_pop_front(&stream->packets, packet,
-				sizeof(struct encoder_packet));
-		new_packet = true;
-	}
+	new_packet = send_queue_pop(&stream->queue, packet);
 	pthread_mutex_unlock(&stream->packets_mutex);
 
 	return new_packet;
 }
 
-static int send_packet(struct rtmp_stream *stream,
-		struct encoder_packet *packet, bool is_header)
+static inline void update_send_rate(struct rtmp_stream *stream, size_t size,
+		uint64_t start_ns)
 {
-	uint8_t *data;
-	size_t  size;
-	int     ret = 0;
+	pthread_mutex_lock(&stream->packets_mutex);
+	send_queue_update_rate(&stream->queue, size, start_ns,
+			os_gettime_ns());
+	pthread_mutex_unlock(&stream->packets_mutex);
+}
 
-	flv_packet_mux(packet, &data, &size, is_header);
-#ifdef FILE_TEST
-	fwrite(data, 1, size, stream->test);
-#else
-	ret = RTMP_Write(&stream->rtmp, (char*)data, (int)size);
-#endif
-	bfree(data);
+/* sends everything queued in the chunk writer, which is also where the
+ * send rate is measured */
+static bool flush_writer(struct rtmp_stream *stream)
+{
+	size_t   size = stream->writer.size;
+	uint64_t start_ns;
+
+	if (!size)
+		return true;
+
+	start_ns = os_gettime_ns();
 
+	if (!rtmp_chunk_flush(&stream->writer, stream->rtmp.m_sb.sb_socket))
+		return false;
+
+	update_send_rate(stream, size, start_ns);
+	return true;
+}
+
+/* sends a full FLV tag (header, data and previous tag size) through
+ * librtmp, which is the only way to reach an HTTP tunneled server */
+static bool write_tunneled(struct rtmp_stream *stream, const uint8_t *data,
+		size_t size)
+{
+	stream->tunneled_writes++;
+	return RTMP_Write(&stream->rtmp, (const char*)data, (int)size) > 0;
+}
+
+static bool send_tunneled(struct rtmp_stream *stream,
+		struct encoder_packet *packet, bool is_header, size_t *size)
+{
+	struct flv_tag tag;
+	uint8_t        *data;
+	bool           success;
+
+	*size = 0;
+
+	if (!flv_packet_tag(&tag, packet, is_header)) {
+		obs_free_encoder_packet(packet);
+		return true;
+	}
+
+	*size = tag.header_size + tag.size + sizeof(tag.footer);
+	data  = bmalloc(*size);
+	memcpy(data, tag.header, tag.header_size);
+	memcpy(data + tag.header_size, tag.data, tag.size);
+	memcpy(data + tag.header_size + tag.size, tag.footer,
+			sizeof(tag.footer));
+
+	success = write_tunneled(stream, data, *size);
+
+	bfree(data);
 	obs_free_encoder_packet(packet);
-	return ret;
+	return success;
 }
 
-static bool send_remaining_packets(struct rtmp_stream *stream)
+/* queues a packet in the chunk writer, or sends it right away when
+ * tunneled.  takes ownership of the packet */
+static bool write_packet(struct rtmp_stream *stream,
+		struct encoder_packet *packet, bool is_header)
 {
-	struct encoder_packet packet;
+	size_t size;
 
-	while (get_next_packet(stream, &packet))
-		if (send_packet(stream, &packet, false) < 0)
-			return false;
+	if (stream->tunneled)
+		return send_tunneled(stream, packet, is_header, &size);
 
+	rtmp_chunk_write_packet(&stream->writer, packet, is_header);
 	return true;
 }
 
+#define MAX_SEND_BATCH_SIZE (256 * 1024)
+
+/* sends all currently available packets (up to the batch size) with as few
+ * socket writes as possible.  returns the number of packets sent, or -1 if
+ * disconnected */
+static int send_tunneled_batch(struct rtmp_stream *stream)
+{
+	struct encoder_packet packet;
+	uint64_t start_ns = os_gettime_ns();
+	size_t   total    = 0;
+	int      count    = 0;
+
+	while (total < MAX_SEND_BATCH_SIZE && get_next_packet(stream, &packet)) {
+		size_t size;
+
+		stream->total_packets++;
+		if (!send_tunneled(stream, &packet, false, &size))
+			return -1;
+
+		total += size;
+		count++;
+	}
+
+	if (total)
+		update_send_rate(stream, total, start_ns);
+
+	return count;
+}
+
+static int send_packet_batch(struct rtmp_stream *stream)
+{
+	struct encoder_packet packet;
+	int count = 0;
+
+	if (stream->tunneled)
+		return send_tunneled_batch(stream);
+
+	while (stream->writer.size < MAX_SEND_BATCH_SIZE &&
+	       get_next_packet(stream, &packet)) {
+		rtmp_chunk_write_packet(&stream->writer, &packet, false);
+		count++;
+	}
+
+	stream->total_packets += count;
+
+	if (!flush_writer(stream))
+		return -1;
+
+	return count;
+}
+
+static bool send_remaining_packets(struct rtmp_stream *stream)
+{
+	int count;
+
+	while ((count = send_packet_batch(stream)) > 0);
+	return count == 0;
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
-	bool disconnected = false;
+	bool     disconnected = false;
+	uint64_t dropped_frames;
 
 	while (os_sem_wait(stream->send_sem) == 0) {
-		struct encoder_packet packet;
-
 		if (os_event_try(stream->stop_event) != EAGAIN)
 			break;
-		if (!get_next_packet(stream, &packet))
-			continue;
-		if (send_packet(stream, &packet, false) < 0) {
+		if (send_packet_batch(stream) < 0) {
 			disconnected = true;
 			break;
 		}
@@ -236,9 +332,24 @@ static void *send_thread(void *data)
 	if (!disconnected && !send_remaining_packets(stream))
 		disconnected = true;
 
+	pthread_mutex_lock(&stream->packets_mutex);
+	dropped_frames = stream->queue.dropped_frames;
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	blog(LOG_INFO, "Sent %"PRIu64" packets with %"PRIu64" %s, "
+			"dropped %"PRIu64" video frames",
+			stream->total_packets,
+			stream->tunneled ?
+				stream->tunneled_writes :
+				stream->writer.total_writes,
+			stream->tunneled ? "HTTP tunneled writes" :
+				"socket writes",
+			dropped_frames);
+
 	if (disconnected) {
 		blog(LOG_INFO, "Disconnected from %s", stream->path.array);
 		free_packets(stream);
+		rtmp_chunk_writer_clear(&stream->writer);
 	}
 
 	if (os_event_try(stream->stop_event) == EAGAIN) {
@@ -250,21 +361,24 @@ static void *send_thread(void *data)
 	return NULL;
 }
 
-static void send_meta_data(struct rtmp_stream *stream)
+static bool send_meta_data(struct rtmp_stream *stream)
 {
 	uint8_t *meta_data;
 	size_t  meta_data_size;
+	bool    success;
 
-	flv_meta_data(stream->output, &meta_data, &meta_data_size);
-#ifdef FILE_TEST
-	fwrite(meta_data, 1, meta_data_size, stream->test);
-#else
-	RTMP_Write(&stream->rtmp, (char*)meta_data, (int)meta_data_size);
-#endif
+	flv_meta_data(stream->output, &meta_data, &meta_data_size, false);
+
+	if (!stream->tunneled)
+		return rtmp_chunk_write_meta(&stream->writer, meta_data,
+				meta_data_size);
+
+	success = write_tunneled(stream, meta_data, meta_data_size);
 	bfree(meta_data);
+	return success;
 }
 
-static void send_audio_header(struct rtmp_stream *stream)
+static bool send_audio_header(struct rtmp_stream *stream)
 {
 	obs_output_t  context  = stream->output;
 	obs_encoder_t aencoder = obs_output_get_audio_encoder(context);
@@ -277,10 +391,10 @@ static void send_audio_header(struct rtmp_stream *stream)
 
 	obs_encoder_get_extra_data(aencoder, &header, &packet.size);
 	packet.data = bmemdup(header, packet.size);
-	send_packet(stream, &packet, true);
+	return write_packet(stream, &packet, true);
 }
 
-static void send_video_header(struct rtmp_stream *stream)
+static bool send_video_header(struct rtmp_stream *stream)
 {
 	obs_output_t  context  = stream->output;
 	obs_encoder_t vencoder = obs_output_get_video_encoder(context);
@@ -295,17 +409,19 @@ static void send_video_header(struct rtmp_stream *stream)
 
 	obs_encoder_get_extra_data(vencoder, &header, &size);
 	packet.size = obs_parse_avc_header(&packet.data, header, size);
-	send_packet(stream, &packet, true);
+	return write_packet(stream, &packet, true);
 }
 
-static void send_headers(struct rtmp_stream *stream)
+static bool send_headers(struct rtmp_stream *stream)
 {
-#ifdef FILE_TEST
-	stream->test = os_fopen("D:\\bla.flv", "wb");
-#endif
-	send_meta_data(stream);
-	send_audio_header(stream);
-	send_video_header(stream);
+	if (!send_meta_data(stream))
+		return false;
+	if (!send_audio_header(stream))
+		return false;
+	if (!send_video_header(stream))
+		return false;
+
+	return flush_writer(stream);
 }
 
 static inline bool reset_semaphore(struct rtmp_stream *stream)
@@ -343,12 +459,39 @@ static int init_send(struct rtmp_stream *stream)
 {
 	int ret;
 
-#if defined(_WIN32) && !defined(FILE_TEST)
+	/* TEST_FRAMEDROPS throttles the socket to a tiny send buffer so the
+	 * congestion handling can be exercised against a local server */
+#if defined(_WIN32) || defined(TEST_FRAMEDROPS)
 	adjust_sndbuf_size(stream, MIN_SENDBUF_SIZE);
 #endif
 
 	reset_semaphore(stream);
 
+	stream->total_packets   = 0;
+	stream->tunneled_writes = 0;
+	send_queue_reset(&stream->queue);
+	rtmp_chunk_writer_init(&stream->writer, stream->rtmp.m_outChunkSize,
+			(uint32_t)stream->rtmp.m_stream_id);
+
+	/* the chunk writer writes to the socket directly, which HTTP
+	 * tunneled (and encrypted) connections can't take */
+	stream->tunneled = (stream->rtmp.Link.protocol &
+			(RTMP_FEATURE_HTTP | RTMP_FEATURE_SSL |
+			 RTMP_FEATURE_ENC)) != 0;
+	if (stream->tunneled)
+		blog(LOG_INFO, "Sending through librtmp, the connection is "
+				"tunneled or encrypted");
+
+	/* sent before the send thread exists, nothing else uses the writer
+	 * yet */
+	if (!send_headers(stream)) {
+		blog(LOG_WARNING, "Failed to send stream headers to %s",
+				stream->path.array);
+		rtmp_chunk_writer_clear(&stream->writer);
+		RTMP_Close(&stream->rtmp);
+		return OBS_OUTPUT_DISCONNECTED;
+	}
+
 	ret = pthread_create(&stream->send_thread, NULL, send_thread, stream);
 	if (ret != 0) {
 		RTMP_Close(&stream->rtmp);
@@ -356,7 +499,6 @@ static int init_send(struct rtmp_stream *stream)
 	}
 
 	stream->active = true;
-	send_headers(stream);
 	obs_output_begin_data_capture(stream->output, 0);
 
 	return OBS_OUTPUT_SUCCESS;
@@ -364,7 +506,6 @@ static int init_send(struct rtmp_stream *stream)
 
 static int try_connect(struct rtmp_stream *stream)
 {
-#ifndef FILE_TEST
 	blog(LOG_INFO, "Connecting to RTMP URL %s...", stream->path.array);
 
 	if (!RTMP_SetupURL2(&stream->rtmp, stream->path.array,
@@ -389,7 +530,6 @@ static int try_connect(struct rtmp_stream *stream)
 		return OBS_OUTPUT_INVALID_STREAM;
 
 	blog(LOG_INFO, "Connection to %s successful", stream->path.array);
-#endif
 
 	return init_send(stream);
 }
@@ -412,118 +552,83 @@ static void *connect_thread(void *data)
 	return NULL;
 }
 
-static bool rtmp_stream_start(void *data)
+static inline int64_t get_encoder_bitrate(obs_encoder_t encoder)
 {
-	struct rtmp_stream *stream = data;
-	obs_service_t service = obs_output_get_service(stream->output);
-	obs_data_t settings;
-
-	if (!obs_output_can_begin_data_capture(stream->output, 0))
-		return false;
-	if (!obs_output_initialize_encoders(stream->output, 0))
-		return false;
+	obs_data_t settings = obs_encoder_get_settings(encoder);
+	int64_t    bitrate  = obs_data_getint(settings, "bitrate");
 
-	settings = obs_output_get_settings(stream->output);
-	dstr_copy(&stream->path,     obs_service_get_url(service));
-	dstr_copy(&stream->key,      obs_service_get_key(service));
-	dstr_copy(&stream->username, obs_service_get_username(service));
-	dstr_copy(&stream->password, obs_service_get_password(service));
-	stream->drop_threshold_usec =
-		(int64_t)obs_data_getint(settings, "drop_threshold");
 	obs_data_release(settings);
-
-	return pthread_create(&stream->connect_thread, NULL, connect_thread,
-			stream) == 0;
+	return bitrate;
 }
 
-static inline bool add_packet(struct rtmp_stream *stream,
-		struct encoder_packet *packet)
+static bool set_video_bitrate(void *param, int64_t bitrate)
 {
-	circlebuf_push_back(&stream->packets, packet,
-			sizeof(struct encoder_packet));
-	stream->last_dts_usec = packet->dts_usec;
-	return true;
-}
+	struct rtmp_stream *stream = param;
+	obs_encoder_t vencoder = obs_output_get_video_encoder(stream->output);
 
-static inline size_t num_buffered_packets(struct rtmp_stream *stream)
-{
-	return stream->packets.size / sizeof(struct encoder_packet);
+	return obs_encoder_request_bitrate(vencoder, (uint32_t)bitrate);
 }
 
-static void drop_frames(struct rtmp_stream *stream)
+/* the encoder may be running at a lowered bitrate if it's shared with another
+ * output, and its settings can be changed while streaming */
+static void get_video_bitrate(void *param, int64_t *cur_bitrate,
+		int64_t *max_bitrate)
 {
-	struct circlebuf new_buf            = {0};
-	int              drop_priority      = 0;
-	uint64_t         last_drop_dts_usec = 0;
-
-	blog(LOG_DEBUG, "Previous packet count: %d",
-			(int)num_buffered_packets(stream));
-
-	circlebuf_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
-
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-
-		last_drop_dts_usec = packet.dts_usec;
+	struct rtmp_stream *stream = param;
+	obs_encoder_t vencoder = obs_output_get_video_encoder(stream->output);
 
-		if (packet.type == OBS_ENCODER_AUDIO) {
-			circlebuf_push_back(&new_buf, &packet, sizeof(packet));
-
-		} else {
-			if (drop_priority < packet.drop_priority)
-				drop_priority = packet.drop_priority;
-
-			obs_free_encoder_packet(&packet);
-		}
-	}
-
-	circlebuf_free(&stream->packets);
-	stream->packets           = new_buf;
-	stream->min_priority      = drop_priority;
-	stream->min_drop_dts_usec = last_drop_dts_usec;
-
-	blog(LOG_DEBUG, "New packet count: %d",
-			(int)num_buffered_packets(stream));
+	*cur_bitrate = (int64_t)obs_encoder_get_bitrate(vencoder);
+	*max_bitrate = get_encoder_bitrate(vencoder);
 }
 
-static void check_to_drop_frames(struct rtmp_stream *stream)
+static void init_dynamic_bitrate(struct rtmp_stream *stream)
 {
-	struct encoder_packet first;
-	int64_t buffer_duration_usec;
-
-	if (num_buffered_packets(stream) < 5)
-		return;
-
-	circlebuf_peek_front(&stream->packets, &first, sizeof(first));
-
-	/* do not drop frames if frames were just dropped within this time */
-	if (first.dts_usec < stream->min_drop_dts_usec)
-		return;
-
-	/* if the amount of time stored in the buffered packets waiting to be
-	 * sent is higher than threshold, drop frames */
-	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
-	if (buffer_duration_usec > stream->drop_threshold_usec) {
-		drop_frames(stream);
-		blog(LOG_INFO, "dropping %" PRId64 " worth of frames",
-				buffer_duration_usec);
+	struct send_queue *sq = &stream->queue;
+	obs_encoder_t aencoder = obs_output_get_audio_encoder(stream->output);
+
+	sq->audio_bitrate = get_encoder_bitrate(aencoder);
+	sq->set_bitrate   = set_video_bitrate;
+	sq->get_bitrate   = get_video_bitrate;
+	sq->param         = stream;
+
+	get_video_bitrate(stream, &sq->cur_bitrate, &sq->max_bitrate);
+	if (!sq->cur_bitrate)
+		sq->cur_bitrate = sq->max_bitrate;
+
+	if (sq->dynamic_bitrate && !sq->max_bitrate) {
+		blog(LOG_WARNING, "Dynamic bitrate: video encoder has no "
+				"bitrate setting, disabling");
+		sq->dynamic_bitrate = false;
 	}
 }
 
-static bool add_video_packet(struct rtmp_stream *stream,
-		struct encoder_packet *packet)
+static bool rtmp_stream_start(void *data)
 {
-	check_to_drop_frames(stream);
+	struct rtmp_stream *stream = data;
+	obs_service_t service = obs_output_get_service(stream->output);
+	obs_data_t settings;
 
-	/* if currently dropping frames, drop packets until it reaches the
-	 * desired priority */
-	if (packet->priority < stream->min_priority)
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
 		return false;
-	else
-		stream->min_priority = 0;
 
-	return add_packet(stream, packet);
+	settings = obs_output_get_settings(stream->output);
+	dstr_copy(&stream->path,     obs_service_get_url(service));
+	dstr_copy(&stream->key,      obs_service_get_key(service));
+	dstr_copy(&stream->username, obs_service_get_username(service));
+	dstr_copy(&stream->password, obs_service_get_password(service));
+	stream->queue.drop_threshold_usec =
+		(int64_t)obs_data_getint(settings, "drop_threshold");
+
+	stream->queue.dynamic_bitrate =
+		obs_data_getbool(settings, "dynamic_bitrate");
+	obs_data_release(settings);
+
+	init_dynamic_bitrate(stream);
+
+	return pthread_create(&stream->connect_thread, NULL, connect_thread,
+			stream) == 0;
 }
 
 static void rtmp_stream_data(void *data, struct encoder_packet *packet)
@@ -538,11 +643,7 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 		obs_duplicate_encoder_packet(&new_packet, packet);
 
 	pthread_mutex_lock(&stream->packets_mutex);
-
-	added_packet = (packet->type == OBS_ENCODER_VIDEO) ?
-		add_video_packet(stream, &new_packet) :
-		add_packet(stream, &new_packet);
-
+	added_packet = send_queue_push(&stream->queue, &new_packet);
 	pthread_mutex_unlock(&stream->packets_mutex);
 
 	if (added_packet)
@@ -554,6 +655,7 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 static void rtmp_stream_defaults(obs_data_t defaults)
 {
 	obs_data_set_default_int(defaults, "drop_threshold", 600000);
+	obs_data_set_default_bool(defaults, "dynamic_bitrate", false);
 }
 
 static obs_properties_t rtmp_stream_properties(const char *locale)
@@ -567,6 +669,8 @@ static obs_properties_t rtmp_stream_properties(const char *locale)
 			OBS_TEXT_DEFAULT);
 	obs_properties_add_text(props, "password", "Password",
 			OBS_TEXT_PASSWORD);
+	obs_properties_add_bool(props, "dynamic_bitrate",
+			"Dynamically adjust bitrate to network conditions");
 	return props;
 }
 
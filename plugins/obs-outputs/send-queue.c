@@ -0,0 +1,376 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-avc.h>
+#include <inttypes.h>
+#include "send-queue.h"
+
+void send_queue_clear(struct send_queue *sq)
+{
+	while (sq->packets.size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&sq->packets, &packet, sizeof(packet));
+		obs_free_encoder_packet(&packet);
+	}
+
+	sq->buffered_bytes = 0;
+}
+
+void send_queue_free(struct send_queue *sq)
+{
+	send_queue_clear(sq);
+	circlebuf_free(&sq->packets);
+}
+
+void send_queue_reset(struct send_queue *sq)
+{
+	sq->window_start_ns          = 0;
+	sq->window_write_ns          = 0;
+	sq->window_bytes             = 0;
+	sq->send_kbps                = 0;
+	sq->min_drop_dts_usec        = 0;
+	sq->min_priority             = 0;
+	sq->dropped_frames           = 0;
+	sq->next_bitrate_check_usec  = 0;
+	sq->last_check_duration_usec = 0;
+	sq->stable_bitrate_checks    = 0;
+}
+
+bool send_queue_pop(struct send_queue *sq, struct encoder_packet *packet)
+{
+	if (!sq->packets.size)
+		return false;
+
+	circlebuf_pop_front(&sq->packets, packet, sizeof(*packet));
+	sq->buffered_bytes -= packet->size;
+	return true;
+}
+
+#define SEND_RATE_WINDOW_NS 1000000000ULL
+
+/* measures how fast data actually leaves through the socket.  time spent
+ * blocking in the write is what matters here:  if the network keeps up, the
+ * write returns almost immediately and the measured rate is very high */
+void send_queue_update_rate(struct send_queue *sq, size_t size,
+		uint64_t start_ns, uint64_t end_ns)
+{
+	int64_t kbps;
+
+	if (!sq->window_start_ns)
+		sq->window_start_ns = start_ns;
+
+	sq->window_write_ns += end_ns - start_ns;
+	sq->window_bytes    += size;
+
+	if (end_ns - sq->window_start_ns < SEND_RATE_WINDOW_NS)
+		return;
+
+	if (sq->window_write_ns) {
+		kbps = (int64_t)((uint64_t)sq->window_bytes * 8000000ULL /
+				sq->window_write_ns);
+
+		sq->send_kbps = sq->send_kbps ? (sq->send_kbps + kbps) / 2 :
+			kbps;
+	}
+
+	sq->window_start_ns = 0;
+	sq->window_write_ns = 0;
+	sq->window_bytes    = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* frame dropping */
+
+static inline void add_packet(struct send_queue *sq,
+		struct encoder_packet *packet)
+{
+	circlebuf_push_back(&sq->packets, packet,
+			sizeof(struct encoder_packet));
+	sq->last_dts_usec   = packet->dts_usec;
+	sq->buffered_bytes += packet->size;
+}
+
+/* estimated time required to send everything currently buffered at the
+ * measured send rate */
+static inline int64_t buffer_send_time_usec(struct send_queue *sq)
+{
+	if (!sq->send_kbps)
+		return 0;
+
+	return (int64_t)sq->buffered_bytes * 8000 / sq->send_kbps;
+}
+
+static inline void drop_video_packet(struct send_queue *sq,
+		struct encoder_packet *packet)
+{
+	sq->buffered_bytes -= packet->size;
+	sq->dropped_frames++;
+	obs_free_encoder_packet(packet);
+}
+
+/* drops non-reference frames (generally b-frames).  nothing references them,
+ * so the rest of the buffer stays decodable */
+static size_t drop_disposable_frames(struct send_queue *sq)
+{
+	size_t num_packets = send_queue_count(sq);
+	size_t dropped     = 0;
+
+	for (size_t i = 0; i < num_packets; i++) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&sq->packets, &packet, sizeof(packet));
+
+		if (packet.type == OBS_ENCODER_VIDEO &&
+		    packet.priority == OBS_NAL_PRIORITY_DISPOSABLE) {
+			drop_video_packet(sq, &packet);
+			dropped++;
+		} else {
+			circlebuf_push_back(&sq->packets, &packet,
+					sizeof(packet));
+		}
+	}
+
+	return dropped;
+}
+
+/* drops all video up to the next buffered keyframe.  if there is no keyframe
+ * in the buffer, incoming packets are dropped until they reach the required
+ * priority again */
+static size_t drop_frames(struct send_queue *sq)
+{
+	size_t num_packets    = send_queue_count(sq);
+	size_t dropped        = 0;
+	int    drop_priority  = 0;
+	bool   found_keyframe = false;
+
+	for (size_t i = 0; i < num_packets; i++) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&sq->packets, &packet, sizeof(packet));
+
+		if (packet.type == OBS_ENCODER_VIDEO && !found_keyframe) {
+			if (packet.keyframe) {
+				found_keyframe = true;
+			} else {
+				if (drop_priority < packet.drop_priority)
+					drop_priority = packet.drop_priority;
+
+				drop_video_packet(sq, &packet);
+				dropped++;
+				continue;
+			}
+		}
+
+		circlebuf_push_back(&sq->packets, &packet, sizeof(packet));
+	}
+
+	if (!found_keyframe && drop_priority > sq->min_priority)
+		sq->min_priority = drop_priority;
+
+	return dropped;
+}
+
+/* ------------------------------------------------------------------------- */
+/* dynamic bitrate */
+
+#define MIN_DYNAMIC_BITRATE       200
+#define BITRATE_CHECK_INTERVAL    500000
+#define BITRATE_STABLE_CHECKS     4
+
+/* picks up bitrate changes made outside of the queue, so the queue never
+ * works from a stale bitrate after the encoder settings are updated */
+static void sync_bitrate(struct send_queue *sq)
+{
+	int64_t cur_bitrate = 0;
+	int64_t max_bitrate = 0;
+
+	if (!sq->get_bitrate)
+		return;
+
+	sq->get_bitrate(sq->param, &cur_bitrate, &max_bitrate);
+
+	if (max_bitrate > 0)
+		sq->max_bitrate = max_bitrate;
+	sq->cur_bitrate = cur_bitrate > 0 ? cur_bitrate : sq->max_bitrate;
+}
+
+static void set_dynamic_bitrate(struct send_queue *sq, int64_t bitrate)
+{
+	if (bitrate < MIN_DYNAMIC_BITRATE)
+		bitrate = MIN_DYNAMIC_BITRATE;
+	if (bitrate > sq->max_bitrate)
+		bitrate = sq->max_bitrate;
+	if (bitrate == sq->cur_bitrate)
+		return;
+
+	if (!sq->set_bitrate || !sq->set_bitrate(sq->param, bitrate)) {
+		blog(LOG_WARNING, "Dynamic bitrate: video encoder does not "
+				"support runtime bitrate changes, disabling");
+		sq->dynamic_bitrate = false;
+		return;
+	}
+
+	blog(bitrate < sq->cur_bitrate ? LOG_INFO : LOG_DEBUG,
+			"Dynamic bitrate: %"PRId64" -> %"PRId64" kbps",
+			sq->cur_bitrate, bitrate);
+	sq->cur_bitrate = bitrate;
+}
+
+/* bitrate the connection can currently sustain for video, or 0 if not yet
+ * known */
+static inline int64_t sustainable_bitrate(struct send_queue *sq)
+{
+	int64_t bitrate = sq->send_kbps * 9 / 10 - sq->audio_bitrate;
+	return (sq->send_kbps && bitrate > 0) ? bitrate : 0;
+}
+
+/* backs the encoder off while data starts piling up in the send buffer, and
+ * slowly ramps it back up once the buffer stays drained.  this is meant to
+ * keep the buffer well below the frame drop threshold */
+static void check_bitrate(struct send_queue *sq)
+{
+	int64_t buffer_duration_usec;
+	int64_t last_duration_usec;
+	int64_t high_usec = sq->drop_threshold_usec / 4;
+	int64_t low_usec  = sq->drop_threshold_usec / 20;
+
+	if (!sq->dynamic_bitrate)
+		return;
+	if (sq->last_dts_usec < sq->next_bitrate_check_usec)
+		return;
+
+	sq->next_bitrate_check_usec =
+		sq->last_dts_usec + BITRATE_CHECK_INTERVAL;
+
+	sync_bitrate(sq);
+	buffer_duration_usec = send_queue_duration(sq);
+	last_duration_usec   = sq->last_check_duration_usec;
+	sq->last_check_duration_usec = buffer_duration_usec;
+
+	if (buffer_duration_usec > high_usec) {
+		int64_t bitrate     = sq->cur_bitrate * 4 / 5;
+		int64_t sustainable = sustainable_bitrate(sq);
+
+		sq->stable_bitrate_checks = 0;
+
+		/* a buffer that is already shrinking is still draining data
+		 * encoded before the last change, so only back off while it
+		 * keeps growing */
+		if (buffer_duration_usec < last_duration_usec)
+			return;
+
+		if (sustainable && sustainable < bitrate)
+			bitrate = sustainable;
+
+		set_dynamic_bitrate(sq, bitrate);
+
+	} else if (buffer_duration_usec < low_usec) {
+		if (sq->cur_bitrate >= sq->max_bitrate)
+			return;
+		if (++sq->stable_bitrate_checks < BITRATE_STABLE_CHECKS)
+			return;
+
+		sq->stable_bitrate_checks = 0;
+		set_dynamic_bitrate(sq, sq->cur_bitrate + sq->max_bitrate / 20);
+
+	} else {
+		sq->stable_bitrate_checks = 0;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void check_to_drop_frames(struct send_queue *sq)
+{
+	struct encoder_packet first;
+	int64_t buffer_duration_usec;
+	int64_t send_time_usec;
+	size_t  dropped;
+
+	if (send_queue_count(sq) < 5)
+		return;
+
+	circlebuf_peek_front(&sq->packets, &first, sizeof(first));
+
+	/* do not drop frames if frames were just dropped within this time */
+	if (first.dts_usec < sq->min_drop_dts_usec)
+		return;
+
+	/* if the amount of time stored in the buffered packets waiting to be
+	 * sent (or the time it would take to send them at the currently
+	 * measured rate) is higher than threshold, drop frames */
+	buffer_duration_usec = sq->last_dts_usec - first.dts_usec;
+	send_time_usec       = buffer_send_time_usec(sq);
+
+	if (buffer_duration_usec <= sq->drop_threshold_usec &&
+	    send_time_usec       <= sq->drop_threshold_usec)
+		return;
+
+	sq->min_drop_dts_usec = sq->last_dts_usec;
+
+	/* try to get away with dropping only disposable frames first, and only
+	 * drop referenced frames if the remaining data still can't be sent
+	 * in time */
+	dropped = drop_disposable_frames(sq);
+	send_time_usec = buffer_send_time_usec(sq);
+
+	if (!send_time_usec || send_time_usec > sq->drop_threshold_usec)
+		dropped += drop_frames(sq);
+
+	blog(LOG_INFO, "Congestion: dropped %d video packets (%"PRId64" usec "
+			"buffered, send rate %"PRId64" kbps)",
+			(int)dropped, buffer_duration_usec, sq->send_kbps);
+
+	/* frames had to be dropped, so the connection clearly can't keep up
+	 * with the current bitrate.  the measured rate can overestimate what
+	 * the connection sustains (socket buffers absorb bursts), so this
+	 * never raises the bitrate */
+	if (sq->dynamic_bitrate) {
+		int64_t sustainable = sustainable_bitrate(sq);
+
+		sync_bitrate(sq);
+		sq->stable_bitrate_checks = 0;
+		set_dynamic_bitrate(sq,
+				(sustainable && sustainable < sq->cur_bitrate) ?
+				sustainable : sq->cur_bitrate / 2);
+	}
+}
+
+static bool push_video_packet(struct send_queue *sq,
+		struct encoder_packet *packet)
+{
+	check_bitrate(sq);
+	check_to_drop_frames(sq);
+
+	/* if currently dropping frames, drop packets until it reaches the
+	 * desired priority */
+	if (packet->priority < sq->min_priority) {
+		sq->dropped_frames++;
+		return false;
+	}
+
+	sq->min_priority = 0;
+	add_packet(sq, packet);
+	return true;
+}
+
+bool send_queue_push(struct send_queue *sq, struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO)
+		return push_video_packet(sq, packet);
+
+	add_packet(sq, packet);
+	return true;
+}
@@ -0,0 +1,112 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+#include <util/circlebuf.h>
+
+/*
+ * Queue of encoded packets waiting to be sent over a network connection,
+ * along with the congestion handling for it:  the send rate is measured from
+ * the time spent in socket writes, video frames are dropped selectively when
+ * the queue can't be sent in time, and (optionally) the video encoder bitrate
+ * is adjusted to what the connection can sustain.
+ *
+ * The queue itself does no locking.
+ */
+
+typedef bool (*send_queue_set_bitrate_cb)(void *param, int64_t bitrate);
+typedef void (*send_queue_get_bitrate_cb)(void *param, int64_t *cur_bitrate,
+		int64_t *max_bitrate);
+
+struct send_queue {
+	struct circlebuf          packets;
+	size_t                    buffered_bytes;
+	int64_t                   last_dts_usec;
+
+	/* frame drop variables */
+	int64_t                   drop_threshold_usec;
+	int64_t                   min_drop_dts_usec;
+	int                       min_priority;
+	uint64_t                  dropped_frames;
+
+	/* measured send throughput */
+	uint64_t                  window_start_ns;
+	uint64_t                  window_write_ns;
+	size_t                    window_bytes;
+	int64_t                   send_kbps;
+
+	/* dynamic bitrate variables (kbps) */
+	bool                      dynamic_bitrate;
+	int64_t                   max_bitrate;
+	int64_t                   cur_bitrate;
+	int64_t                   audio_bitrate;
+	int64_t                   next_bitrate_check_usec;
+	int64_t                   last_check_duration_usec;
+	int                       stable_bitrate_checks;
+
+	/* changes the video encoder bitrate, returns false if unsupported */
+	send_queue_set_bitrate_cb set_bitrate;
+
+	/* gets the current and configured video encoder bitrates, which can
+	 * change behind the queue's back (for example when the encoder
+	 * settings are updated).  a current bitrate of 0 means the
+	 * configured one */
+	send_queue_get_bitrate_cb get_bitrate;
+	void                      *param;
+};
+
+extern void send_queue_free(struct send_queue *sq);
+
+/** frees all queued packets */
+extern void send_queue_clear(struct send_queue *sq);
+
+/** resets the drop and send rate state for a new connection */
+extern void send_queue_reset(struct send_queue *sq);
+
+/**
+ * Queues a packet.  Queueing video may drop frames already in the queue.
+ * Returns false if the packet itself must be dropped, in which case the caller
+ * still owns it.
+ */
+extern bool send_queue_push(struct send_queue *sq,
+		struct encoder_packet *packet);
+
+extern bool send_queue_pop(struct send_queue *sq,
+		struct encoder_packet *packet);
+
+/** reports a socket write of size bytes that took from start_ns to end_ns */
+extern void send_queue_update_rate(struct send_queue *sq, size_t size,
+		uint64_t start_ns, uint64_t end_ns);
+
+static inline size_t send_queue_count(const struct send_queue *sq)
+{
+	return sq->packets.size / sizeof(struct encoder_packet);
+}
+
+/** duration of the queued data (first to last dts) in microseconds */
+static inline int64_t send_queue_duration(struct send_queue *sq)
+{
+	struct encoder_packet first;
+
+	if (!sq->packets.size)
+		return 0;
+
+	circlebuf_peek_front(&sq->packets, &first, sizeof(first));
+	return sq->last_dts_usec - first.dts_usec;
+}
@@ -214,6 +214,12 @@ static void log_x264(void *param, int level, const char *format, va_list args)
 	UNUSED_PARAMETER(level);
 }
 
+/* H.264 VUI color description values */
+static inline int get_x264_cs_val(enum video_colorspace cs)
+{
+	return cs == VIDEO_CS_709 ? 1 /* bt709 */ : 6 /* smpte170m */;
+}
+
 static void update_params(struct obs_x264 *obsx264, obs_data_t settings,
 		char **params)
 {
@@ -264,6 +270,11 @@ static void update_params(struct obs_x264 *obsx264, obs_data_t settings,
 	else
 		obsx264->params.i_csp = X264_CSP_NV12;
 
+	obsx264->params.vui.b_fullrange = voi->range == VIDEO_RANGE_FULL;
+	obsx264->params.vui.i_colorprim = get_x264_cs_val(voi->colorspace);
+	obsx264->params.vui.i_transfer  = get_x264_cs_val(voi->colorspace);
+	obsx264->params.vui.i_colmatrix = get_x264_cs_val(voi->colorspace);
+
 	while (*params)
 		set_param(obsx264, *(params++));
 }
@@ -319,6 +330,21 @@ static bool obs_x264_update(void *data, obs_data_t settings)
 	return false;
 }
 
+static bool obs_x264_update_bitrate(void *data, uint32_t bitrate)
+{
+	struct obs_x264 *obsx264 = data;
+	int ret;
+
+	obsx264->params.rc.i_vbv_max_bitrate = (int)bitrate;
+	obsx264->params.rc.i_bitrate         = (int)bitrate;
+
+	ret = x264_encoder_reconfig(obsx264->context, &obsx264->params);
+	if (ret != 0)
+		blog(LOG_WARNING, "Failed to change x264 bitrate: %d", ret);
+
+	return ret == 0;
+}
+
 static void load_headers(struct obs_x264 *obsx264)
 {
 	x264_nal_t      *nals;
@@ -495,5 +521,7 @@ struct obs_encoder_info obs_x264_encoder = {
 	.update     = obs_x264_update,
 	.extra_data = obs_x264_extra_data,
 	.sei_data   = obs_x264_sei,
-	.video_info = obs_x264_video_info
+	.video_info = obs_x264_video_info,
+
+	.update_bitrate = obs_x264_update_bitrate
 };
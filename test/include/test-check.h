@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdio.h>
+#include <util/c99defs.h>
+
+/*
+ * Failure counting shared by the tests.  check() prints a FAIL line for each
+ * condition that doesn't hold, and test_result() prints the verdict and
+ * returns the exit code for main.
+ */
+
+static int failures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("FAIL: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while (false)
+
+static inline int test_result(void)
+{
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
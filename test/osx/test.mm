@@ -41,7 +41,7 @@ static void CreateOBS(NSView *view)
 	if (!obs_startup())
 		throw "Couldn't create OBS";
 
-	struct obs_video_info ovi;
+	struct obs_video_info ovi = {};
 	ovi.adapter         = 0;
 	ovi.fps_num         = 30000;
 	ovi.fps_den         = 1001;
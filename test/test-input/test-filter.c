@@ -60,7 +60,7 @@ static void filter_render(void *data, effect_t effect)
 struct obs_source_info test_filter = {
 	.id           = "test_filter",
 	.type         = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CACHEABLE,
 	.getname      = filter_getname,
 	.create       = filter_create,
 	.destroy      = filter_destroy,
@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <obs.h>
+#include <obs-avc.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/array-serializer.h>
+#include <test-check.h>
+
+/*
+ * Checks the AVC start code search and packet conversion against the
+ * original (FFmpeg-derived, serializer based) implementation, then compares
+ * their speed.
+ */
+
+#define NUM_PACKETS   64
+#define PACKET_SIZE   (32 * 1024)
+#define TIMING_ROUNDS 200
+#define RANDOM_TESTS  2000
+
+/* ------------------------------------------------------------------------- */
+/* reference implementation */
+
+static const uint8_t *ref_find_startcode_internal(const uint8_t *p,
+		const uint8_t *end)
+{
+	const uint8_t *a = p + 4 - ((intptr_t)p & 3);
+
+	for (end -= 3; p < a && p < end; p++) {
+		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+			return p;
+	}
+
+	for (end -= 3; p < end; p += 4) {
+		uint32_t x;
+		memcpy(&x, p, sizeof(x));
+
+		if ((x - 0x01010101) & (~x) & 0x80808080) {
+			if (p[1] == 0) {
+				if (p[0] == 0 && p[2] == 1)
+					return p;
+				if (p[2] == 0 && p[3] == 1)
+					return p+1;
+			}
+
+			if (p[3] == 0) {
+				if (p[2] == 0 && p[4] == 1)
+					return p+2;
+				if (p[4] == 0 && p[5] == 1)
+					return p+3;
+			}
+		}
+	}
+
+	for (end += 3; p < end; p++) {
+		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+			return p;
+	}
+
+	return end + 3;
+}
+
+static const uint8_t *ref_find_startcode(const uint8_t *p, const uint8_t *end)
+{
+	const uint8_t *out = ref_find_startcode_internal(p, end);
+	if (p < out && out < end && !out[-1]) out--;
+	return out;
+}
+
+static void ref_parse_avc_packet(struct encoder_packet *avc_packet,
+		const struct encoder_packet *src)
+{
+	struct array_output_data output;
+	struct serializer s;
+	const uint8_t *nal_start, *nal_end;
+	const uint8_t *end = src->data + src->size;
+
+	array_output_serializer_init(&s, &output);
+	*avc_packet = *src;
+
+	nal_start = ref_find_startcode(src->data, end);
+	while (true) {
+		while (nal_start < end && !*(nal_start++));
+
+		if (nal_start == end)
+			break;
+
+		nal_end = ref_find_startcode(nal_start, end);
+		s_wb32(&s, (uint32_t)(nal_end - nal_start));
+		s_write(&s, nal_start, nal_end - nal_start);
+		nal_start = nal_end;
+	}
+
+	avc_packet->data = output.bytes.array;
+	avc_packet->size = output.bytes.num;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint32_t rand_state = 1;
+
+static inline uint32_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+/* writes a NAL unit with emulation prevention, like an encoder would, so
+ * start codes only occur at NAL boundaries */
+static uint8_t *write_nal(uint8_t *p, uint8_t header, size_t size,
+		bool long_start_code)
+{
+	int zeros = 0;
+
+	if (long_start_code)
+		*(p++) = 0;
+	*(p++) = 0;
+	*(p++) = 0;
+	*(p++) = 1;
+	*(p++) = header;
+
+	for (size_t i = 0; i < size; i++) {
+		/* slice data has plenty of zero bytes */
+		uint8_t val = (next_rand() % 8) ? (uint8_t)next_rand() : 0;
+
+		if (zeros == 2 && val <= 3) {
+			*(p++) = 3;
+			zeros  = 0;
+		}
+
+		*(p++) = val;
+		zeros  = val ? 0 : zeros + 1;
+	}
+
+	return p;
+}
+
+/* SEI + slice, with the occasional IDR frame */
+static void make_frame(struct encoder_packet *packet, size_t index)
+{
+	uint8_t *p;
+	bool    idr = (index % 30) == 0;
+
+	memset(packet, 0, sizeof(*packet));
+	packet->type = OBS_ENCODER_VIDEO;
+	packet->data = bmalloc(PACKET_SIZE * 2);
+
+	p = write_nal(packet->data, 0x06, 20, true);
+	p = write_nal(p, idr ? 0x65 : 0x41, PACKET_SIZE, false);
+	packet->size = p - packet->data;
+}
+
+/* buffers of only 0, 1 and 2 give start codes (and near misses) at every
+ * possible alignment */
+static void check_find_startcode(void)
+{
+	uint8_t buf[96];
+
+	for (int test = 0; test < RANDOM_TESTS; test++) {
+		size_t size = next_rand() % sizeof(buf);
+
+		for (size_t i = 0; i < size; i++)
+			buf[i] = (uint8_t)(next_rand() % 3);
+
+		for (size_t start = 0; start <= size; start++) {
+			const uint8_t *p   = buf + start;
+			const uint8_t *end = buf + size;
+
+			bool match = obs_avc_find_startcode(p, end) ==
+				ref_find_startcode(p, end);
+
+			check(match, "start code mismatch (size %d, "
+					"offset %d)", (int)size, (int)start);
+			if (!match)
+				return;
+		}
+	}
+}
+
+static void check_packets(struct encoder_packet *packets)
+{
+	for (size_t i = 0; i < NUM_PACKETS; i++) {
+		struct encoder_packet out, ref;
+
+		obs_parse_avc_packet(&out, packets+i);
+		ref_parse_avc_packet(&ref, packets+i);
+
+		check(out.size == ref.size &&
+		      memcmp(out.data, ref.data, out.size) == 0,
+				"converted packet %d differs", (int)i);
+		check(out.keyframe == ((i % 30) == 0),
+				"packet %d keyframe flag wrong", (int)i);
+
+		bfree(out.data);
+		bfree(ref.data);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static size_t total_size(struct encoder_packet *packets)
+{
+	size_t size = 0;
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+		size += packets[i].size;
+	return size;
+}
+
+static double time_scan(struct encoder_packet *packets,
+		const uint8_t *(*find)(const uint8_t *p, const uint8_t *end),
+		size_t *found)
+{
+	uint64_t start_ns = os_gettime_ns();
+
+	*found = 0;
+
+	for (int round = 0; round < TIMING_ROUNDS; round++) {
+		for (size_t i = 0; i < NUM_PACKETS; i++) {
+			const uint8_t *p   = packets[i].data;
+			const uint8_t *end = p + packets[i].size;
+
+			while ((p = find(p, end)) < end) {
+				(*found)++;
+				p += 3;
+			}
+		}
+	}
+
+	return (double)(os_gettime_ns() - start_ns) / 1000000000.0;
+}
+
+static double time_parse(struct encoder_packet *packets,
+		void (*parse)(struct encoder_packet *avc_packet,
+			const struct encoder_packet *src))
+{
+	uint64_t start_ns = os_gettime_ns();
+
+	for (int round = 0; round < TIMING_ROUNDS; round++) {
+		for (size_t i = 0; i < NUM_PACKETS; i++) {
+			struct encoder_packet out;
+			parse(&out, packets+i);
+			bfree(out.data);
+		}
+	}
+
+	return (double)(os_gettime_ns() - start_ns) / 1000000000.0;
+}
+
+static inline double mb_per_sec(size_t size, double secs)
+{
+	return (double)size * TIMING_ROUNDS / secs / (1024.0 * 1024.0);
+}
+
+int main(void)
+{
+	struct encoder_packet packets[NUM_PACKETS];
+	size_t size, found, ref_found;
+	double secs, ref_secs;
+
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+		make_frame(packets+i, i);
+	size = total_size(packets);
+
+	check_find_startcode();
+	check_packets(packets);
+
+	secs     = time_scan(packets, obs_avc_find_startcode, &found);
+	ref_secs = time_scan(packets, ref_find_startcode, &ref_found);
+
+	printf("start code search:  %8.1f MB/s (reference %8.1f MB/s, "
+			"%.2fx)\n", mb_per_sec(size, secs),
+			mb_per_sec(size, ref_secs), ref_secs / secs);
+
+	check(found == ref_found, "found %d start codes, reference found %d",
+			(int)found, (int)ref_found);
+
+	secs     = time_parse(packets, obs_parse_avc_packet);
+	ref_secs = time_parse(packets, ref_parse_avc_packet);
+
+	printf("packet conversion:  %8.1f MB/s (reference %8.1f MB/s, "
+			"%.2fx)\n", mb_per_sec(size, secs),
+			mb_per_sec(size, ref_secs), ref_secs / secs);
+
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+		bfree(packets[i].data);
+
+	return test_result();
+}
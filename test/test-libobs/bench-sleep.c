@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+/*
+ * Measures how late a timing thread wakes up when it sleeps to a 2ms period,
+ * with the old relative sleep, with os_sleepto_ns, and with the timer slack
+ * and spin controls the video and audio threads can use.  Fails if
+ * os_sleepto_ns ever wakes up before its deadline.
+ */
+
+#define PERIOD_NS   2000000ULL
+#define NUM_WAKEUPS 500
+
+enum sleep_mode {
+	SLEEP_RELATIVE,
+	SLEEP_ABSOLUTE
+};
+
+struct sleep_test {
+	const char      *name;
+	enum sleep_mode mode;
+	uint64_t        slack_ns;
+	uint32_t        spin_us;
+
+	int64_t         lateness[NUM_WAKEUPS];
+	bool            slack_set;
+};
+
+#ifndef _WIN32
+/* os_sleepto_ns before it slept to absolute deadlines */
+static void sleepto_relative(uint64_t time_target)
+{
+	uint64_t current = os_gettime_ns();
+	struct timespec req, remain;
+
+	if (time_target < current)
+		return;
+
+	time_target -= current;
+
+	memset(&req, 0, sizeof(req));
+	memset(&remain, 0, sizeof(remain));
+	req.tv_sec  = time_target / 1000000000;
+	req.tv_nsec = time_target % 1000000000;
+
+	while (nanosleep(&req, &remain)) {
+		req = remain;
+		memset(&remain, 0, sizeof(remain));
+	}
+}
+#endif
+
+static void *sleep_thread(void *data)
+{
+	struct sleep_test *test = data;
+	uint64_t next;
+
+	if (test->slack_ns)
+		test->slack_set = os_set_thread_timer_slack(test->slack_ns);
+	os_set_thread_sleep_spin(test->spin_us);
+
+	next = os_gettime_ns();
+
+	for (size_t i = 0; i < NUM_WAKEUPS; i++) {
+		next += PERIOD_NS;
+
+#ifndef _WIN32
+		if (test->mode == SLEEP_RELATIVE)
+			sleepto_relative(next);
+		else
+#endif
+			os_sleepto_ns(next);
+
+		test->lateness[i] = (int64_t)(os_gettime_ns() - next);
+	}
+
+	return NULL;
+}
+
+static int compare_int64(const void *a, const void *b)
+{
+	int64_t val_a = *(const int64_t*)a;
+	int64_t val_b = *(const int64_t*)b;
+	return (val_a > val_b) - (val_a < val_b);
+}
+
+static bool run(struct sleep_test *test)
+{
+	pthread_t thread;
+	int64_t   *sorted = test->lateness;
+
+	if (pthread_create(&thread, NULL, sleep_thread, test) != 0) {
+		printf("could not create thread\n");
+		return false;
+	}
+	pthread_join(thread, NULL);
+
+	qsort(sorted, NUM_WAKEUPS, sizeof(int64_t), compare_int64);
+
+	printf("%-36s median %6.1f us, p99 %7.1f us, max %7.1f us%s\n",
+			test->name,
+			(double)sorted[NUM_WAKEUPS / 2] / 1000.0,
+			(double)sorted[NUM_WAKEUPS * 99 / 100] / 1000.0,
+			(double)sorted[NUM_WAKEUPS - 1] / 1000.0,
+			test->slack_ns && !test->slack_set ?
+				" (timer slack not supported)" : "");
+
+	if (test->mode == SLEEP_ABSOLUTE && sorted[0] < 0) {
+		printf("FAIL: %s woke up %.1f us early\n", test->name,
+				(double)-sorted[0] / 1000.0);
+		return false;
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	static struct sleep_test tests[] = {
+#ifndef _WIN32
+		{"relative sleep (old):",          SLEEP_RELATIVE, 0, 0},
+#endif
+		{"os_sleepto_ns:",                 SLEEP_ABSOLUTE, 0, 0},
+		{"os_sleepto_ns, minimal slack:",  SLEEP_ABSOLUTE, 1, 0},
+		{"os_sleepto_ns, 100us spin:",     SLEEP_ABSOLUTE, 1, 100}
+	};
+	bool success = true;
+
+	printf("wakeup lateness over %d periods of %.1f ms\n", NUM_WAKEUPS,
+			(double)PERIOD_NS / 1000000.0);
+
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		if (!run(tests+i))
+			success = false;
+	}
+
+	return success ? 0 : 1;
+}
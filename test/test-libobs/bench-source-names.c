@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+/*
+ * Looks up every one of 5,000 sources by name, the way loading a scene
+ * collection does for each scene item, using the name index
+ * (obs_get_source_by_name) and using a linear search of the source list (how
+ * obs_get_source_by_name used to work).  Also checks which context is
+ * returned when names collide, and that renaming doesn't change it.
+ */
+
+#define NUM_SOURCES 5000
+#define NAME_SIZE   32
+
+static const char *bench_getname(const char *locale)
+{
+	UNUSED_PARAMETER(locale);
+	return "bench";
+}
+
+static void *bench_create(obs_data_t settings, void *context)
+{
+	UNUSED_PARAMETER(settings);
+	return context;
+}
+
+static void bench_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool bench_start(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return false;
+}
+
+static void bench_stop(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static void bench_raw_video(void *data, struct video_data *frame)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(frame);
+}
+
+static void register_types(void)
+{
+	struct obs_source_info source_info = {0};
+	struct obs_output_info output_info = {0};
+
+	source_info.id           = "bench_source";
+	source_info.type         = OBS_SOURCE_TYPE_INPUT;
+	source_info.getname      = bench_getname;
+	source_info.create       = (void*)bench_create;
+	source_info.destroy      = bench_destroy;
+	obs_register_source(&source_info);
+
+	output_info.id           = "bench_output";
+	output_info.flags        = OBS_OUTPUT_VIDEO;
+	output_info.getname      = bench_getname;
+	output_info.create       = (void*)bench_create;
+	output_info.destroy      = bench_destroy;
+	output_info.start        = bench_start;
+	output_info.stop         = bench_stop;
+	output_info.raw_video    = bench_raw_video;
+	obs_register_output(&output_info);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct linear_search {
+	const char   *name;
+	obs_source_t source;
+};
+
+static bool find_source(void *param, obs_source_t source)
+{
+	struct linear_search *search = param;
+
+	if (strcmp(obs_source_getname(source), search->name) == 0) {
+		search->source = source;
+		obs_source_addref(source);
+		return false;
+	}
+
+	return true;
+}
+
+static obs_source_t get_source_linear(const char *name)
+{
+	struct linear_search search = {name, NULL};
+	obs_enum_sources(find_source, &search);
+	return search.source;
+}
+
+static bool lookup_all(char (*names)[NAME_SIZE], obs_source_t *sources,
+		bool linear, uint64_t *time_ns)
+{
+	uint64_t start = os_gettime_ns();
+	bool     success = true;
+
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		obs_source_t source = linear ?
+			get_source_linear(names[i]) :
+			obs_get_source_by_name(names[i]);
+
+		if (source != sources[i])
+			success = false;
+		obs_source_release(source);
+	}
+
+	*time_ns = os_gettime_ns() - start;
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool check(bool condition, const char *description)
+{
+	if (!condition)
+		printf("FAIL: %s\n", description);
+	return condition;
+}
+
+static bool check_collisions(void)
+{
+	obs_source_t source1, source2, found;
+	obs_output_t output1, output2;
+	bool success = true;
+
+	/* sources: the first one added, as when the user source list was
+	 * searched from the start.  the newer source is added first to make
+	 * sure it's the add order that counts, not the creation order */
+	source1 = obs_source_create(OBS_SOURCE_TYPE_INPUT, "bench_source",
+			"dup source", NULL);
+	source2 = obs_source_create(OBS_SOURCE_TYPE_INPUT, "bench_source",
+			"dup source", NULL);
+	obs_add_source(source2);
+	obs_add_source(source1);
+
+	found = obs_get_source_by_name("dup source");
+	success &= check(found == source2, "first added source returned");
+	obs_source_release(found);
+
+	obs_source_setname(source2, "renamed source");
+	obs_source_setname(source2, "dup source");
+	found = obs_get_source_by_name("dup source");
+	success &= check(found == source2, "first added source returned "
+			"after rename");
+	obs_source_release(found);
+
+	obs_source_remove(source1);
+	obs_source_remove(source2);
+	obs_source_release(source1);
+	obs_source_release(source2);
+
+	/* outputs: the newest one, as when the output list was searched */
+	output1 = obs_output_create("bench_output", "dup output", NULL);
+	output2 = obs_output_create("bench_output", "dup output", NULL);
+	success &= check(output1 && output2, "outputs created");
+
+	success &= check(obs_get_output_by_name("dup output") == output2,
+			"newest output returned");
+
+	obs_output_destroy(output2);
+	success &= check(obs_get_output_by_name("dup output") == output1,
+			"older output returned once the newest is gone");
+
+	obs_output_destroy(output1);
+	success &= check(obs_get_output_by_name("dup output") == NULL,
+			"no output returned once both are gone");
+
+	return success;
+}
+
+int main(void)
+{
+	char         (*names)[NAME_SIZE];
+	obs_source_t *sources;
+	uint64_t     index_ns, linear_ns;
+	bool         success = true;
+
+	if (!obs_startup()) {
+		printf("FAIL: obs_startup\n");
+		return 1;
+	}
+
+	register_types();
+
+	names   = bmalloc(NUM_SOURCES * NAME_SIZE);
+	sources = bmalloc(NUM_SOURCES * sizeof(obs_source_t));
+
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		snprintf(names[i], NAME_SIZE, "Source %d", (int)i);
+		sources[i] = obs_source_create(OBS_SOURCE_TYPE_INPUT,
+				"bench_source", names[i], NULL);
+		if (!sources[i]) {
+			printf("FAIL: could not create source\n");
+			return 1;
+		}
+		obs_add_source(sources[i]);
+	}
+
+	success &= check(lookup_all(names, sources, false, &index_ns),
+			"name index found every source");
+	success &= check(lookup_all(names, sources, true, &linear_ns),
+			"linear search found every source");
+
+	printf("looking up %d sources by name:\n"
+			"  linear search: %8.2f ms\n"
+			"  name index:    %8.2f ms (%.0fx faster)\n",
+			NUM_SOURCES,
+			(double)linear_ns / 1000000.0,
+			(double)index_ns  / 1000000.0,
+			(double)linear_ns / (double)index_ns);
+
+	success &= check_collisions();
+
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		obs_source_remove(sources[i]);
+		obs_source_release(sources[i]);
+	}
+
+	bfree(names);
+	bfree(sources);
+	obs_shutdown();
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/job-pool.h>
+#include <media-io/format-conversion.h>
+
+/*
+ * Unpacks 1080p I420, NV12, YUY2 and UYVY frames to packed 444 (YUVX) the way
+ * unpack_video does for sources that can't be converted on the GPU: on one
+ * thread, and split in to even row ranges over a job pool like
+ * unpack_video does.  Checks every output pixel (including the 0xFF alpha
+ * byte) against a plain C reference, at a width that only uses the SSE loops
+ * and at one that also goes through the scalar tail loops, and at heights
+ * that don't split evenly in to the number of slices.
+ */
+
+#define NUM_FRAMES  60
+#define MAX_THREADS 4
+
+enum unpack_type {
+	UNPACK_420,
+	UNPACK_NV12,
+	UNPACK_422_Y,
+	UNPACK_422_U
+};
+
+struct frame {
+	enum unpack_type type;
+	uint32_t         width;
+	uint32_t         height;
+	uint8_t          *data[3];
+	uint32_t         linesize[3];
+	uint8_t          *output;
+	uint32_t         out_linesize;
+};
+
+static uint32_t rand_state = 1;
+
+static inline uint8_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (uint8_t)(rand_state >> 16);
+}
+
+static void fill_plane(struct frame *frame, int plane, uint32_t linesize,
+		uint32_t height)
+{
+	frame->linesize[plane] = linesize;
+	frame->data[plane]     = bmalloc(linesize * height);
+
+	for (uint32_t i = 0; i < linesize * height; i++)
+		frame->data[plane][i] = next_rand();
+}
+
+static void frame_init(struct frame *frame, enum unpack_type type,
+		uint32_t width, uint32_t height)
+{
+	memset(frame, 0, sizeof(struct frame));
+	frame->type   = type;
+	frame->width  = width;
+	frame->height = height;
+
+	switch (type) {
+	case UNPACK_420:
+		fill_plane(frame, 0, width,     height);
+		fill_plane(frame, 1, width / 2, height / 2);
+		fill_plane(frame, 2, width / 2, height / 2);
+		break;
+	case UNPACK_NV12:
+		fill_plane(frame, 0, width,     height);
+		fill_plane(frame, 1, width,     height / 2);
+		break;
+	case UNPACK_422_Y:
+	case UNPACK_422_U:
+		fill_plane(frame, 0, width * 2, height);
+		break;
+	}
+
+	frame->out_linesize = width * 4;
+	frame->output       = bmalloc(frame->out_linesize * height);
+}
+
+static void frame_free(struct frame *frame)
+{
+	for (size_t i = 0; i < 3; i++)
+		bfree(frame->data[i]);
+	bfree(frame->output);
+}
+
+static void unpack_rows(struct frame *frame, uint32_t start_y, uint32_t end_y)
+{
+	const uint8_t *const *input = (const uint8_t *const*)frame->data;
+
+	switch (frame->type) {
+	case UNPACK_420:
+		decompress_420(input, frame->linesize, start_y, end_y,
+				frame->output, frame->out_linesize);
+		break;
+	case UNPACK_NV12:
+		decompress_nv12(input, frame->linesize, start_y, end_y,
+				frame->output, frame->out_linesize);
+		break;
+	case UNPACK_422_Y:
+		decompress_422(frame->data[0], frame->linesize[0],
+				start_y, end_y, frame->output,
+				frame->out_linesize, true);
+		break;
+	case UNPACK_422_U:
+		decompress_422(frame->data[0], frame->linesize[0],
+				start_y, end_y, frame->output,
+				frame->out_linesize, false);
+		break;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void reference_pixel(const struct frame *frame, uint32_t x, uint32_t y,
+		uint8_t *yuvx)
+{
+	const uint8_t *packed;
+
+	switch (frame->type) {
+	case UNPACK_420:
+		yuvx[0] = frame->data[0][y * frame->linesize[0] + x];
+		yuvx[1] = frame->data[1][y/2 * frame->linesize[1] + x/2];
+		yuvx[2] = frame->data[2][y/2 * frame->linesize[2] + x/2];
+		break;
+	case UNPACK_NV12:
+		yuvx[0] = frame->data[0][y * frame->linesize[0] + x];
+		yuvx[1] = frame->data[1][y/2 * frame->linesize[1] + x/2*2];
+		yuvx[2] = frame->data[1][y/2 * frame->linesize[1] + x/2*2 + 1];
+		break;
+	case UNPACK_422_Y:
+		packed  = frame->data[0] + y * frame->linesize[0] + x/2*4;
+		yuvx[0] = packed[(x & 1) * 2];
+		yuvx[1] = packed[1];
+		yuvx[2] = packed[3];
+		break;
+	case UNPACK_422_U:
+		packed  = frame->data[0] + y * frame->linesize[0] + x/2*4;
+		yuvx[0] = packed[1 + (x & 1) * 2];
+		yuvx[1] = packed[0];
+		yuvx[2] = packed[2];
+		break;
+	}
+
+	yuvx[3] = 0xFF;
+}
+
+static bool check_output(const struct frame *frame, const char *name)
+{
+	for (uint32_t y = 0; y < frame->height; y++) {
+		for (uint32_t x = 0; x < frame->width; x++) {
+			const uint8_t *out = frame->output +
+				y * frame->out_linesize + x * 4;
+			uint8_t ref[4];
+
+			reference_pixel(frame, x, y, ref);
+
+			if (memcmp(out, ref, 4) != 0) {
+				printf("FAIL: %s %ux%u pixel (%u, %u) is "
+						"%02x%02x%02x%02x, expected "
+						"%02x%02x%02x%02x\n",
+						name, frame->width,
+						frame->height, x, y,
+						out[0], out[1], out[2], out[3],
+						ref[0], ref[1], ref[2], ref[3]);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct slice_job {
+	struct frame *frame;
+	uint32_t     num_slices;
+};
+
+static void unpack_slice(void *param, size_t idx)
+{
+	struct slice_job *job = param;
+	uint32_t start_y, end_y;
+
+	get_decompress_slice(job->frame->height, job->num_slices,
+			(uint32_t)idx, &start_y, &end_y);
+	if (start_y < end_y)
+		unpack_rows(job->frame, start_y, end_y);
+}
+
+/* same split as unpack_video: one even-height slice per pool thread, with
+ * the calling thread doing one of them */
+static void unpack_sliced(struct frame *frame, job_pool_t pool,
+		uint32_t num_slices)
+{
+	struct slice_job job = {frame, num_slices};
+	job_pool_run(pool, num_slices, unpack_slice, &job);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char *type_names[] = {
+	"I420", "NV12", "YUY2", "UYVY"
+};
+
+/* heights and slice counts where the rows don't split evenly, so every row
+ * is only unpacked if the last slice picks up the remainder */
+static const struct {
+	uint32_t height;
+	uint32_t num_slices;
+} slice_cases[] = {
+	{1024, 5},
+	{482,  5},
+	{1084, 3},
+	{1080, 4},
+	{64,   3}
+};
+
+#define NUM_SLICE_CASES (sizeof(slice_cases) / sizeof(slice_cases[0]))
+
+static bool test_slices(enum unpack_type type, job_pool_t pool)
+{
+	const char   *name = type_names[type];
+	struct frame frame;
+	bool         success = true;
+
+	for (size_t i = 0; i < NUM_SLICE_CASES; i++) {
+		frame_init(&frame, type, 64, slice_cases[i].height);
+		memset(frame.output, 0, frame.out_linesize * frame.height);
+		unpack_sliced(&frame, pool, slice_cases[i].num_slices);
+		success &= check_output(&frame, name);
+		frame_free(&frame);
+	}
+
+	return success;
+}
+
+static bool test_type(enum unpack_type type, job_pool_t pool,
+		uint32_t num_slices)
+{
+	const char   *name = type_names[type];
+	struct frame frame;
+	uint64_t     start, single_ns, sliced_ns;
+	bool         success = true;
+
+	/* 1930 wide: 965 chroma pairs per row, so the scalar tail loops run */
+	frame_init(&frame, type, 1930, 64);
+	unpack_rows(&frame, 0, frame.height);
+	success &= check_output(&frame, name);
+	memset(frame.output, 0, frame.out_linesize * frame.height);
+	unpack_sliced(&frame, pool, 3);
+	success &= check_output(&frame, name);
+	frame_free(&frame);
+
+	success &= test_slices(type, pool);
+
+	frame_init(&frame, type, 1920, 1080);
+
+	start = os_gettime_ns();
+	for (int i = 0; i < NUM_FRAMES; i++)
+		unpack_rows(&frame, 0, frame.height);
+	single_ns = os_gettime_ns() - start;
+	success &= check_output(&frame, name);
+
+	memset(frame.output, 0, frame.out_linesize * frame.height);
+
+	start = os_gettime_ns();
+	for (int i = 0; i < NUM_FRAMES; i++)
+		unpack_sliced(&frame, pool, num_slices);
+	sliced_ns = os_gettime_ns() - start;
+	success &= check_output(&frame, name);
+
+	printf("%s 1920x1080: 1 thread %6.2f ms/frame, "
+			"%d threads %6.2f ms/frame (%.1fx)\n", name,
+			(double)single_ns / NUM_FRAMES / 1000000.0,
+			(int)num_slices,
+			(double)sliced_ns / NUM_FRAMES / 1000000.0,
+			(double)single_ns / (double)sliced_ns);
+
+	frame_free(&frame);
+	return success;
+}
+
+int main(void)
+{
+	int        num_threads = os_get_logical_cores();
+	job_pool_t pool;
+	bool       success = true;
+
+	if (num_threads > MAX_THREADS)
+		num_threads = MAX_THREADS;
+	if (num_threads < 2)
+		num_threads = 2;
+
+	pool = job_pool_create((size_t)num_threads - 1);
+	if (!pool) {
+		printf("FAIL: job_pool_create\n");
+		return 1;
+	}
+
+	for (int type = UNPACK_420; type <= UNPACK_422_U; type++)
+		success &= test_type((enum unpack_type)type, pool,
+				(uint32_t)num_threads);
+
+	job_pool_destroy(pool);
+	return success ? 0 : 1;
+}
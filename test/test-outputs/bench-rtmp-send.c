@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/darray.h>
+#include "rtmp-chunk.h"
+#include "flv-mux.h"
+#include "test-net.h"
+
+/*
+ * Sends the same packets over loopback as RTMP chunks two ways:
+ *
+ *  - the way RTMP_Write does it:  every packet is copied in to a newly
+ *    allocated message body, then each chunk is sent with its own call
+ *  - with rtmp_chunk_writer:  payloads are referenced, and a batch of packets
+ *    is sent with gathered writes
+ *
+ * Both produce byte-identical streams (checked on the receiving end).  The
+ * receiving end limits the throughput on loopback, so the sending thread's
+ * CPU time and number of send calls are what's compared.
+ */
+
+#define NUM_PACKETS 2000
+#define BATCH_SIZE  8
+#define CHUNK_SIZE  4096
+#define STREAM_ID   1
+
+struct receiver {
+	DARRAY(uint8_t) stream;
+};
+
+static void receive_data(void *param, const uint8_t *data, size_t size)
+{
+	struct receiver *recv = param;
+	da_push_back_array(recv->stream, data, size);
+}
+
+static uint32_t rand_state = 1;
+
+static inline uint32_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+/* mixes small audio-sized packets with larger video frames, and goes past
+ * the 24 bit timestamp limit part way through */
+static void make_packets(struct encoder_packet *packets)
+{
+	rand_state = 1;
+
+	for (size_t i = 0; i < NUM_PACKETS; i++) {
+		struct encoder_packet *packet = packets+i;
+		bool video = (i % 3) != 0;
+		size_t size = video ? 2000 + next_rand() % 40000 :
+			200 + next_rand() % 200;
+
+		memset(packet, 0, sizeof(*packet));
+		packet->type         = video ?
+			OBS_ENCODER_VIDEO : OBS_ENCODER_AUDIO;
+		packet->timebase_num = 1;
+		packet->timebase_den = 1000;
+		packet->dts          = (int64_t)(0xFFFFFF - NUM_PACKETS / 2 + i);
+		packet->pts          = packet->dts;
+		packet->keyframe     = video && (i % 60) == 1;
+		packet->size         = size;
+		packet->data         = bmalloc(size);
+
+		for (size_t j = 0; j < size; j++)
+			packet->data[j] = (uint8_t)next_rand();
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline uint8_t *put_be24(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)(val >> 16);
+	*(p++) = (uint8_t)(val >> 8);
+	*(p++) = (uint8_t)val;
+	return p;
+}
+
+static inline uint8_t *put_be32(uint8_t *p, uint32_t val)
+{
+	*(p++) = (uint8_t)(val >> 24);
+	return put_be24(p, val);
+}
+
+static bool send_chunk(int sock, const uint8_t *header, size_t header_size,
+		const uint8_t *data, size_t size, uint64_t *calls)
+{
+	struct iovec  iov[2] = {
+		{(void*)header, header_size},
+		{(void*)data,   size}
+	};
+	struct msghdr msg = {0};
+	size_t        total = header_size + size;
+
+	msg.msg_iov    = iov;
+	msg.msg_iovlen = 2;
+
+	/* librtmp writes the chunk header in front of the chunk data inside
+	 * the message body, so it's one send call per chunk */
+	while (total) {
+		ssize_t ret = sendmsg(sock, &msg, MSG_NOSIGNAL);
+		(*calls)++;
+
+		if (ret <= 0)
+			return false;
+
+		total -= (size_t)ret;
+		while (ret > 0 && msg.msg_iovlen) {
+			if ((size_t)ret >= msg.msg_iov->iov_len) {
+				ret -= (ssize_t)msg.msg_iov->iov_len;
+				msg.msg_iov++;
+				msg.msg_iovlen--;
+			} else {
+				msg.msg_iov->iov_base =
+					(uint8_t*)msg.msg_iov->iov_base + ret;
+				msg.msg_iov->iov_len -= (size_t)ret;
+				ret = 0;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool send_copied(int sock, struct encoder_packet *packet,
+		uint64_t *calls)
+{
+	struct flv_tag tag;
+	uint8_t  header[16];
+	uint8_t  *p = header;
+	uint8_t  *body;
+	size_t   prefix_size, body_size;
+	uint32_t ts;
+	bool     success = true;
+
+	flv_packet_tag(&tag, packet, false);
+	prefix_size = tag.header_size - 11;
+	body_size   = prefix_size + tag.size;
+	ts = ((uint32_t)tag.header[4] << 16) | ((uint32_t)tag.header[5] << 8) |
+		tag.header[6] | ((uint32_t)tag.header[7] << 24);
+
+	/* RTMP_Write: allocate the message body and copy the tag in to it */
+	body = bmalloc(body_size);
+	memcpy(body, tag.header + 11, prefix_size);
+	memcpy(body + prefix_size, tag.data, tag.size);
+
+	*(p++) = 0x04;
+	p = put_be24(p, ts < 0xFFFFFF ? ts : 0xFFFFFF);
+	p = put_be24(p, (uint32_t)body_size);
+	*(p++) = tag.header[0];
+	*(p++) = STREAM_ID; *(p++) = 0; *(p++) = 0; *(p++) = 0;
+	if (ts >= 0xFFFFFF)
+		p = put_be32(p, ts);
+
+	for (size_t pos = 0; pos < body_size && success; pos += CHUNK_SIZE) {
+		size_t size = body_size - pos;
+		if (size > CHUNK_SIZE)
+			size = CHUNK_SIZE;
+
+		success = send_chunk(sock, header, p - header, body + pos, size,
+				calls);
+
+		p = header;
+		*(p++) = 0xC4;
+		if (ts >= 0xFFFFFF)
+			p = put_be32(p, ts);
+	}
+
+	bfree(body);
+	obs_free_encoder_packet(packet);
+	return success;
+}
+
+static bool send_gathered(int sock, struct rtmp_chunk_writer *writer,
+		struct encoder_packet *packet, size_t index)
+{
+	rtmp_chunk_write_packet(writer, packet, false);
+
+	if ((index + 1) % BATCH_SIZE == 0 || index + 1 == NUM_PACKETS)
+		return rtmp_chunk_flush(writer, sock);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+struct bench_result {
+	struct receiver recv;
+	uint64_t        payload_bytes;
+	uint64_t        calls;
+	uint64_t        time_ns;
+	uint64_t        cpu_ns;
+};
+
+static bool run(bool gathered, struct bench_result *result)
+{
+	struct encoder_packet    *packets;
+	struct rtmp_chunk_writer writer = {0};
+	struct net_server        *server;
+	uint64_t                 start_ns, start_cpu_ns;
+	int                      sock;
+	bool                     success = true;
+
+	memset(result, 0, sizeof(*result));
+
+	packets = bmalloc(NUM_PACKETS * sizeof(struct encoder_packet));
+	make_packets(packets);
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+		result->payload_bytes += packets[i].size;
+
+	server = net_server_create(0, receive_data, &result->recv);
+	sock   = server ? net_connect(net_server_port(server), 0) : -1;
+	if (sock == -1) {
+		printf("could not set up loopback connection\n");
+		return false;
+	}
+
+	rtmp_chunk_writer_init(&writer, CHUNK_SIZE, STREAM_ID);
+	start_ns     = os_gettime_ns();
+	start_cpu_ns = thread_cpu_ns();
+
+	for (size_t i = 0; i < NUM_PACKETS && success; i++)
+		success = gathered ?
+			send_gathered(sock, &writer, packets+i, i) :
+			send_copied(sock, packets+i, &result->calls);
+
+	result->cpu_ns  = thread_cpu_ns() - start_cpu_ns;
+	result->time_ns = os_gettime_ns() - start_ns;
+	if (gathered)
+		result->calls = writer.total_writes;
+
+	net_close(sock);
+	net_server_destroy(server);
+	rtmp_chunk_writer_free(&writer);
+	bfree(packets);
+	return success;
+}
+
+static void print_result(const char *name, const struct bench_result *r)
+{
+	double secs     = (double)r->time_ns / 1000000000.0;
+	double cpu_secs = (double)r->cpu_ns  / 1000000000.0;
+
+	printf("%s\n"
+			"  wall: %7.1f ms (%.1f MB/s)\n"
+			"  send thread cpu: %7.1f ms (%.0f packets per cpu "
+			"second)\n"
+			"  send calls: %"PRIu64" (%.2f per packet)\n",
+			name, secs * 1000.0,
+			(double)r->payload_bytes / secs / (1024.0 * 1024.0),
+			cpu_secs * 1000.0, NUM_PACKETS / cpu_secs,
+			r->calls, (double)r->calls / NUM_PACKETS);
+}
+
+int main(void)
+{
+	struct bench_result copied, gathered;
+
+	if (!run(false, &copied) || !run(true, &gathered)) {
+		printf("FAIL: send error\n");
+		return 1;
+	}
+
+	print_result("copy + send per chunk (RTMP_Write):", &copied);
+	print_result("referenced + gathered (rtmp_chunk_writer):", &gathered);
+
+	if (copied.recv.stream.num != gathered.recv.stream.num ||
+	    memcmp(copied.recv.stream.array, gathered.recv.stream.array,
+		    copied.recv.stream.num) != 0) {
+		printf("FAIL: streams differ (%zu vs %zu bytes)\n",
+				copied.recv.stream.num,
+				gathered.recv.stream.num);
+		return 1;
+	}
+
+	printf("streams identical (%zu bytes)\n", gathered.recv.stream.num);
+
+	da_free(copied.recv.stream);
+	da_free(gathered.recv.stream);
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <test-check.h>
+#include "test-stream.h"
+
+/*
+ * Streams the same over-budget video over a throttled link with and without
+ * dynamic bitrate.  With it, the encoder bitrate has to settle below the link
+ * rate and fewer frames have to be dropped.  Halfway through the encoder
+ * settings are changed, which discards the lowered bitrate; the queue has to
+ * pick up the new configured bitrate rather than keep using its stale one.
+ */
+
+#define VIDEO_KBPS   4000
+#define LINK_KBPS    1500
+#define UPDATED_KBPS 3000
+
+int main(void)
+{
+	struct test_stream_params params = {
+		.video_kbps        = VIDEO_KBPS,
+		.link_kbps         = LINK_KBPS,
+		.drop_threshold_ms = 500,
+		.duration_sec      = 12,
+		.updated_kbps      = UPDATED_KBPS
+	};
+	struct test_stream_result fixed;
+	struct test_stream_result dynamic;
+
+	if (!test_stream_run(&params, &fixed))
+		return 1;
+	test_stream_print("fixed bitrate", &fixed);
+
+	params.dynamic_bitrate = true;
+	if (!test_stream_run(&params, &dynamic))
+		return 1;
+	test_stream_print("dynamic bitrate", &dynamic);
+	printf("  highest request after settings update: %"PRIu32" kbps\n",
+			dynamic.max_requested_after_update);
+
+	check(dynamic.frames_dropped < fixed.frames_dropped,
+			"dynamic bitrate did not reduce dropped frames "
+			"(%"PRIu64" vs %"PRIu64")",
+			dynamic.frames_dropped, fixed.frames_dropped);
+	check(dynamic.end_kbps < LINK_KBPS,
+			"bitrate did not settle below the link rate "
+			"(%"PRIu32" kbps)", dynamic.end_kbps);
+	check(dynamic.max_requested_after_update <= UPDATED_KBPS,
+			"requested %"PRIu32" kbps after the settings changed "
+			"to %d kbps", dynamic.max_requested_after_update,
+			UPDATED_KBPS);
+	check(dynamic.audio_received == dynamic.audio_produced,
+			"%"PRIu32" audio packets lost",
+			dynamic.audio_produced - dynamic.audio_received);
+	check(dynamic.broken_refs == 0,
+			"%"PRIu32" frames were sent without their reference",
+			dynamic.broken_refs);
+
+	return test_result();
+}
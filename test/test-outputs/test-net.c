@@ -0,0 +1,199 @@
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "test-net.h"
+
+#define READ_SIZE   65536
+#define RCVBUF_SIZE 16384
+
+struct net_server {
+	int          listen_sock;
+	int          port;
+	pthread_t    thread;
+
+	net_data_cb  callback;
+	void         *param;
+
+	volatile long rate_kbps;
+	volatile long long total_bytes;
+};
+
+static inline void set_bufsize(int sock, int opt, int size)
+{
+	setsockopt(sock, SOL_SOCKET, opt, &size, sizeof(size));
+}
+
+/* reads in small pieces and sleeps between them so that on average no more
+ * than rate_kbps is consumed */
+static void *server_thread(void *data)
+{
+	struct net_server *server = data;
+	uint8_t  *buf = bmalloc(READ_SIZE);
+	uint64_t start_ns = os_gettime_ns();
+	uint64_t rate_bytes = 0;
+	long     cur_rate = -1;
+	int      sock;
+
+	sock = accept(server->listen_sock, NULL, NULL);
+	if (sock == -1) {
+		bfree(buf);
+		return NULL;
+	}
+
+	set_bufsize(sock, SO_RCVBUF, RCVBUF_SIZE);
+
+	for (;;) {
+		long    rate = os_atomic_load_long(&server->rate_kbps);
+		ssize_t ret;
+
+		/* restart the budget when the rate changes */
+		if (rate != cur_rate) {
+			cur_rate   = rate;
+			start_ns   = os_gettime_ns();
+			rate_bytes = 0;
+		}
+
+		ret = recv(sock, buf, rate ? 1024 : READ_SIZE, 0);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+
+		server->callback(server->param, buf, (size_t)ret);
+		server->total_bytes += ret;
+
+		if (rate) {
+			rate_bytes += (uint64_t)ret;
+			os_sleepto_ns(start_ns +
+					rate_bytes * 8000000ULL / (uint64_t)rate);
+		}
+	}
+
+	close(sock);
+	bfree(buf);
+	return NULL;
+}
+
+struct net_server *net_server_create(uint32_t rate_kbps,
+		net_data_cb callback, void *param)
+{
+	struct net_server  *server = bzalloc(sizeof(struct net_server));
+	struct sockaddr_in addr    = {0};
+	socklen_t          len     = sizeof(addr);
+
+	server->callback  = callback;
+	server->param     = param;
+	server->rate_kbps = (long)rate_kbps;
+
+	server->listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (server->listen_sock == -1)
+		goto fail;
+
+	/* must be set before listening to affect the accepted socket's
+	 * window */
+	set_bufsize(server->listen_sock, SO_RCVBUF, RCVBUF_SIZE);
+
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port        = 0;
+
+	if (bind(server->listen_sock, (struct sockaddr*)&addr, len) != 0)
+		goto fail;
+	if (listen(server->listen_sock, 1) != 0)
+		goto fail;
+	if (getsockname(server->listen_sock, (struct sockaddr*)&addr,
+				&len) != 0)
+		goto fail;
+
+	server->port = ntohs(addr.sin_port);
+
+	if (pthread_create(&server->thread, NULL, server_thread, server) != 0)
+		goto fail;
+
+	return server;
+
+fail:
+	if (server->listen_sock != -1)
+		close(server->listen_sock);
+	bfree(server);
+	return NULL;
+}
+
+void net_server_destroy(struct net_server *server)
+{
+	if (server) {
+		pthread_join(server->thread, NULL);
+		close(server->listen_sock);
+		bfree(server);
+	}
+}
+
+int net_server_port(struct net_server *server)
+{
+	return server->port;
+}
+
+uint64_t net_server_bytes(struct net_server *server)
+{
+	return (uint64_t)server->total_bytes;
+}
+
+void net_server_set_rate(struct net_server *server, uint32_t rate_kbps)
+{
+	os_atomic_set_long(&server->rate_kbps, (long)rate_kbps);
+}
+
+int net_connect(int port, int sndbuf)
+{
+	struct sockaddr_in addr = {0};
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+	int one  = 1;
+
+	if (sock == -1)
+		return -1;
+
+	if (sndbuf)
+		set_bufsize(sock, SO_SNDBUF, sndbuf);
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port        = htons((uint16_t)port);
+
+	if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+bool net_send_all(int sock, const uint8_t *data, size_t size)
+{
+	while (size) {
+		ssize_t ret = send(sock, data, size, MSG_NOSIGNAL);
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+
+		data += ret;
+		size -= (size_t)ret;
+	}
+
+	return true;
+}
+
+void net_close(int sock)
+{
+	if (sock != -1)
+		close(sock);
+}
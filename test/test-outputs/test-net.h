@@ -0,0 +1,35 @@
+#pragma once
+
+#include <util/c99defs.h>
+
+/*
+ * Loopback TCP helpers for the output tests.  The server reads whatever it
+ * receives no faster than the given rate, which throttles the sender the
+ * same way a slow uplink would (the socket buffers fill and send blocks).
+ */
+
+typedef void (*net_data_cb)(void *param, const uint8_t *data, size_t size);
+
+struct net_server;
+
+/** rate_kbps of 0 reads as fast as possible */
+extern struct net_server *net_server_create(uint32_t rate_kbps,
+		net_data_cb callback, void *param);
+
+/** waits for the client to disconnect, then frees the server */
+extern void net_server_destroy(struct net_server *server);
+
+extern int net_server_port(struct net_server *server);
+extern uint64_t net_server_bytes(struct net_server *server);
+
+/** changes the read rate while running */
+extern void net_server_set_rate(struct net_server *server,
+		uint32_t rate_kbps);
+
+/** connects to a local port, with a small send buffer if sndbuf is set */
+extern int net_connect(int port, int sndbuf);
+
+/** sends everything, returns false on error */
+extern bool net_send_all(int sock, const uint8_t *data, size_t size);
+
+extern void net_close(int sock);
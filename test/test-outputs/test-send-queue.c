@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <test-check.h>
+#include "test-stream.h"
+
+/*
+ * Checks that congestion is handled the way a viewer needs it to be:  frames
+ * get dropped, no audio is lost, no frame arrives without the frame it
+ * references, video recovers on a keyframe, and the queue stays bounded.
+ */
+
+#define DROP_THRESHOLD_MS 500
+
+int main(void)
+{
+	struct test_stream_params params = {
+		.video_kbps        = 3000,
+		.link_kbps         = 1500,
+		.drop_threshold_ms = DROP_THRESHOLD_MS,
+		.duration_sec      = 6
+	};
+	struct test_stream_result result;
+
+	if (!test_stream_run(&params, &result))
+		return 1;
+
+	test_stream_print("throttled stream", &result);
+
+	check(result.frames_dropped > 0,
+			"no frames were dropped on a congested link");
+	check(result.frames_received + result.frames_dropped ==
+			result.frames_produced,
+			"frames went missing without being counted as dropped");
+	check(result.audio_received == result.audio_produced,
+			"%"PRIu32" audio packets lost",
+			result.audio_produced - result.audio_received);
+	check(result.broken_refs == 0,
+			"%"PRIu32" frames were sent without their reference",
+			result.broken_refs);
+	check(result.dropped && result.recovered,
+			"video did not recover on a keyframe after dropping");
+	check(result.max_queue_usec <= DROP_THRESHOLD_MS * 1000 * 3,
+			"queue grew to %"PRId64" ms",
+			result.max_queue_usec / 1000);
+
+	return test_result();
+}
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <obs-avc.h>
+#include "send-queue.h"
+#include "test-net.h"
+#include "test-stream.h"
+
+#define FPS               30
+#define FRAME_USEC        (1000000 / FPS)
+#define KEYFRAME_INTERVAL (FPS * 2)
+#define AUDIO_PER_SEC     48
+#define AUDIO_SIZE        200
+#define AUDIO_KBPS        (AUDIO_PER_SEC * AUDIO_SIZE * 8 / 1000)
+#define SNDBUF_SIZE       16384
+
+enum frame_kind {
+	FRAME_AUDIO,
+	FRAME_I,
+	FRAME_P,
+	FRAME_B
+};
+
+/* written at the start of every packet so the receiver can identify it */
+#pragma pack(push, 1)
+struct record {
+	uint32_t size;
+	uint8_t  kind;
+	uint32_t index;
+	uint32_t ref;
+};
+#pragma pack(pop)
+
+struct test_stream {
+	const struct test_stream_params *params;
+	struct test_stream_result       *result;
+
+	struct send_queue queue;
+	pthread_mutex_t   mutex;
+	os_sem_t          send_sem;
+	volatile bool     producing;
+	int               sock;
+	uint32_t          num_frames;
+
+	/* simulated encoder.  the queue callbacks are only called from
+	 * send_queue_push, on the producing thread */
+	int64_t           settings_kbps;
+	int64_t           requested_kbps;
+	bool              settings_updated;
+
+	/* receiver state */
+	uint8_t           header[sizeof(struct record)];
+	size_t            header_pos;
+	size_t            skip;
+	bool              *received;
+	uint32_t          next_index;
+	int64_t           first_gap;
+};
+
+static void receive_record(struct test_stream *ts, const struct record *rec)
+{
+	struct test_stream_result *result = ts->result;
+
+	if (rec->kind == FRAME_AUDIO) {
+		result->audio_received++;
+		return;
+	}
+
+	if (rec->index >= ts->num_frames)
+		return;
+
+	ts->received[rec->index] = true;
+	result->frames_received++;
+
+	if (rec->index != ts->next_index && ts->first_gap < 0) {
+		ts->first_gap   = ts->next_index;
+		result->dropped = true;
+	}
+	ts->next_index = rec->index + 1;
+
+	if (rec->kind == FRAME_I && ts->first_gap >= 0 &&
+	    rec->index > (uint32_t)ts->first_gap)
+		result->recovered = true;
+
+	if (rec->kind != FRAME_I && !ts->received[rec->ref])
+		result->broken_refs++;
+}
+
+static void receive_data(void *param, const uint8_t *data, size_t size)
+{
+	struct test_stream *ts = param;
+
+	while (size) {
+		if (ts->skip) {
+			size_t n = size < ts->skip ? size : ts->skip;
+			ts->skip -= n;
+			data     += n;
+			size     -= n;
+			continue;
+		}
+
+		while (size && ts->header_pos < sizeof(struct record)) {
+			ts->header[ts->header_pos++] = *(data++);
+			size--;
+		}
+
+		if (ts->header_pos == sizeof(struct record)) {
+			struct record rec;
+			memcpy(&rec, ts->header, sizeof(rec));
+			receive_record(ts, &rec);
+
+			ts->header_pos = 0;
+			ts->skip       = rec.size - sizeof(struct record);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool set_bitrate(void *param, int64_t bitrate)
+{
+	struct test_stream *ts = param;
+
+	ts->requested_kbps = bitrate;
+
+	if (ts->settings_updated &&
+	    bitrate > ts->result->max_requested_after_update)
+		ts->result->max_requested_after_update = (uint32_t)bitrate;
+	return true;
+}
+
+static void get_bitrate(void *param, int64_t *cur_bitrate,
+		int64_t *max_bitrate)
+{
+	struct test_stream *ts = param;
+
+	*cur_bitrate = ts->requested_kbps;
+	*max_bitrate = ts->settings_kbps;
+}
+
+static inline int64_t encoder_kbps(struct test_stream *ts)
+{
+	return ts->requested_kbps ? ts->requested_kbps : ts->settings_kbps;
+}
+
+static void make_packet(struct encoder_packet *packet, enum frame_kind kind,
+		uint32_t index, uint32_t ref, size_t size, int64_t dts_usec)
+{
+	struct record rec = {(uint32_t)size, (uint8_t)kind, index, ref};
+
+	memset(packet, 0, sizeof(*packet));
+	packet->data     = bzalloc(size);
+	packet->size     = size;
+	packet->dts_usec = dts_usec;
+	packet->type     = kind == FRAME_AUDIO ?
+		OBS_ENCODER_AUDIO : OBS_ENCODER_VIDEO;
+	packet->keyframe = kind == FRAME_I;
+
+	/* same priorities obs_parse_avc_packet gives x264 output */
+	if (kind == FRAME_I || kind == FRAME_P) {
+		packet->priority      = kind == FRAME_I ?
+			OBS_NAL_PRIORITY_HIGHEST : OBS_NAL_PRIORITY_HIGH;
+		packet->drop_priority = OBS_NAL_PRIORITY_HIGHEST;
+	} else if (kind == FRAME_B) {
+		packet->priority      = OBS_NAL_PRIORITY_DISPOSABLE;
+		packet->drop_priority = OBS_NAL_PRIORITY_DISPOSABLE;
+	}
+
+	memcpy(packet->data, &rec, sizeof(rec));
+}
+
+static void queue_packet(struct test_stream *ts, struct encoder_packet *packet)
+{
+	int64_t duration;
+	bool    queued;
+
+	pthread_mutex_lock(&ts->mutex);
+	queued   = send_queue_push(&ts->queue, packet);
+	duration = send_queue_duration(&ts->queue);
+	if (duration > ts->result->max_queue_usec)
+		ts->result->max_queue_usec = duration;
+	pthread_mutex_unlock(&ts->mutex);
+
+	if (queued)
+		os_sem_post(ts->send_sem);
+	else
+		obs_free_encoder_packet(packet);
+}
+
+/* I P B B P B B ...  b-frames reference nothing that follows them */
+static inline enum frame_kind frame_kind(uint32_t index)
+{
+	uint32_t pos = index % KEYFRAME_INTERVAL;
+	if (pos == 0)
+		return FRAME_I;
+	return (pos % 3 == 1) ? FRAME_P : FRAME_B;
+}
+
+/* sizes average out to the bitrate over one pattern of I/P/B frames */
+static inline size_t frame_size(enum frame_kind kind, int64_t kbps)
+{
+	size_t avg = (size_t)kbps * 1000 / 8 / FPS;
+	size_t size;
+
+	if (kind == FRAME_I)
+		size = avg * 3;
+	else if (kind == FRAME_P)
+		size = avg * 3 / 2;
+	else
+		size = avg * 3 / 4;
+
+	return size < sizeof(struct record) ? sizeof(struct record) : size;
+}
+
+static void produce(struct test_stream *ts)
+{
+	const struct test_stream_params *params = ts->params;
+	struct test_stream_result       *result = ts->result;
+	uint64_t start_ns      = os_gettime_ns();
+	uint32_t last_ref      = 0;
+	uint64_t audio_next    = 0;
+	uint32_t end_start     = ts->num_frames * 2 / 3;
+	uint64_t end_bytes     = 0;
+
+	for (uint32_t i = 0; i < ts->num_frames; i++) {
+		struct encoder_packet packet;
+		enum frame_kind kind = frame_kind(i);
+		int64_t dts_usec = (int64_t)i * FRAME_USEC;
+		size_t  size;
+
+		os_sleepto_ns(start_ns + (uint64_t)dts_usec * 1000);
+
+		if (params->updated_kbps && i == ts->num_frames / 2) {
+			ts->settings_kbps    = params->updated_kbps;
+			ts->requested_kbps   = 0;
+			ts->settings_updated = true;
+		}
+
+		while (audio_next * 1000000 / AUDIO_PER_SEC <=
+				(uint64_t)dts_usec) {
+			make_packet(&packet, FRAME_AUDIO,
+					result->audio_produced++, 0,
+					AUDIO_SIZE, (int64_t)(audio_next *
+					1000000 / AUDIO_PER_SEC));
+			queue_packet(ts, &packet);
+			audio_next++;
+		}
+
+		size = frame_size(kind, encoder_kbps(ts));
+		if (i >= end_start)
+			end_bytes += size;
+
+		make_packet(&packet, kind, i, last_ref, size, dts_usec);
+		queue_packet(ts, &packet);
+
+		if (kind != FRAME_B)
+			last_ref = i;
+		result->frames_produced++;
+	}
+
+	result->end_kbps = (uint32_t)(end_bytes * 8 * FPS / 1000 /
+			(ts->num_frames - end_start));
+}
+
+static void *send_thread(void *data)
+{
+	struct test_stream *ts = data;
+
+	while (os_sem_wait(ts->send_sem) == 0) {
+		struct encoder_packet packet;
+		uint64_t start_ns, end_ns;
+		bool     have_packet;
+
+		pthread_mutex_lock(&ts->mutex);
+		have_packet = send_queue_pop(&ts->queue, &packet);
+		pthread_mutex_unlock(&ts->mutex);
+
+		if (!have_packet) {
+			if (!ts->producing)
+				break;
+			continue;
+		}
+
+		start_ns = os_gettime_ns();
+		net_send_all(ts->sock, packet.data, packet.size);
+		end_ns = os_gettime_ns();
+
+		pthread_mutex_lock(&ts->mutex);
+		send_queue_update_rate(&ts->queue, packet.size, start_ns, end_ns);
+		pthread_mutex_unlock(&ts->mutex);
+
+		obs_free_encoder_packet(&packet);
+	}
+
+	return NULL;
+}
+
+bool test_stream_run(const struct test_stream_params *params,
+		struct test_stream_result *result)
+{
+	struct test_stream ts = {0};
+	struct net_server  *server;
+	pthread_t          thread;
+	bool               success = false;
+
+	memset(result, 0, sizeof(*result));
+
+	ts.params        = params;
+	ts.result        = result;
+	ts.first_gap     = -1;
+	ts.producing     = true;
+	ts.num_frames    = params->duration_sec * FPS;
+	ts.received      = bzalloc(ts.num_frames * sizeof(bool));
+	ts.settings_kbps = params->video_kbps;
+
+	ts.queue.drop_threshold_usec = params->drop_threshold_ms * 1000;
+	ts.queue.dynamic_bitrate     = params->dynamic_bitrate;
+	ts.queue.max_bitrate         = params->video_kbps;
+	ts.queue.cur_bitrate         = params->video_kbps;
+	ts.queue.audio_bitrate       = AUDIO_KBPS;
+	ts.queue.set_bitrate         = set_bitrate;
+	ts.queue.get_bitrate         = get_bitrate;
+	ts.queue.param               = &ts;
+
+	pthread_mutex_init(&ts.mutex, NULL);
+	os_sem_init(&ts.send_sem, 0);
+
+	server = net_server_create(params->link_kbps, receive_data, &ts);
+	if (!server) {
+		printf("could not create server\n");
+		goto fail;
+	}
+
+	ts.sock = net_connect(net_server_port(server), SNDBUF_SIZE);
+	if (ts.sock == -1) {
+		printf("could not connect\n");
+		net_server_destroy(server);
+		goto fail;
+	}
+
+	send_queue_reset(&ts.queue);
+	pthread_create(&thread, NULL, send_thread, &ts);
+
+	produce(&ts);
+
+	/* let the sender drain what is left, then disconnect */
+	ts.producing = false;
+	os_sem_post(ts.send_sem);
+	pthread_join(thread, NULL);
+	net_close(ts.sock);
+	net_server_destroy(server);
+
+	result->frames_dropped = ts.queue.dropped_frames;
+	success = true;
+
+fail:
+	send_queue_free(&ts.queue);
+	os_sem_destroy(ts.send_sem);
+	pthread_mutex_destroy(&ts.mutex);
+	bfree(ts.received);
+	return success;
+}
+
+void test_stream_print(const char *name,
+		const struct test_stream_result *result)
+{
+	printf("%s:\n", name);
+	printf("  frames: %"PRIu32" produced, %"PRIu32" received, "
+			"%"PRIu64" dropped\n",
+			result->frames_produced, result->frames_received,
+			result->frames_dropped);
+	printf("  audio: %"PRIu32" produced, %"PRIu32" received\n",
+			result->audio_produced, result->audio_received);
+	printf("  max queue duration: %"PRId64" ms, ending bitrate: "
+			"%"PRIu32" kbps\n",
+			result->max_queue_usec / 1000, result->end_kbps);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <util/c99defs.h>
+
+/*
+ * Streams synthetic 30 fps I/P/B video (with the packet priorities x264
+ * output gets) and audio through a send queue to a loopback server that reads
+ * at a capped rate, and records what arrives on the other end.
+ *
+ * The simulated video encoder follows the bitrate requested by the queue,
+ * applied at the next frame like a real encoder does.
+ */
+
+struct test_stream_params {
+	uint32_t video_kbps;
+	uint32_t link_kbps;
+	uint32_t drop_threshold_ms;
+	uint32_t duration_sec;
+	bool     dynamic_bitrate;
+
+	/* if set, the encoder settings are changed to this bitrate halfway
+	 * through, which also discards any requested bitrate */
+	uint32_t updated_kbps;
+};
+
+struct test_stream_result {
+	uint32_t frames_produced;
+	uint32_t frames_received;
+	uint64_t frames_dropped;
+	uint32_t audio_produced;
+	uint32_t audio_received;
+
+	/* frames received without the frame they reference */
+	uint32_t broken_refs;
+
+	/* a keyframe arrived after the first missing frame */
+	bool     dropped;
+	bool     recovered;
+
+	int64_t  max_queue_usec;
+
+	/* average video bitrate produced over the last third of the run */
+	uint32_t end_kbps;
+
+	/* highest bitrate requested after the settings update */
+	uint32_t max_requested_after_update;
+};
+
+extern bool test_stream_run(const struct test_stream_params *params,
+		struct test_stream_result *result);
+
+extern void test_stream_print(const char *name,
+		const struct test_stream_result *result);
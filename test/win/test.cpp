@@ -74,7 +74,7 @@ static void CreateOBS(HWND hwnd)
 	if (!obs_startup())
 		throw "Couldn't create OBS";
 
-	struct obs_video_info ovi;
+	struct obs_video_info ovi = {};
 	ovi.adapter         = 0;
 	ovi.base_width      = rc.right;
 	ovi.base_height     = rc.bottom;